@@ -1,210 +1,1650 @@
 #include "Adios2StManColumn.h"
 #include <casacore/casa/Containers/Record.h>
 
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 namespace casacore
 {
 
-bool Adios2StMan::itsUsingMpi;
-std::string Adios2StMan::itsAdiosEngineType;
-adios2::Params Adios2StMan::itsAdiosEngineParams;
-std::vector<adios2::Params> Adios2StMan::itsAdiosTransportParamsVec;
+bool Adios2StMan::itsUsingMpi;
+std::string Adios2StMan::itsAdiosEngineType;
+adios2::Params Adios2StMan::itsAdiosEngineParams;
+std::vector<adios2::Params> Adios2StMan::itsAdiosTransportParamsVec;
+std::map<std::string, Adios2StMan::InlineChannel>
+    Adios2StMan::itsInlineChannels;
+std::map<std::string, Adios2StMan::SharedContainer>
+    Adios2StMan::itsSharedContainers;
+std::vector<Adios2StMan::PooledAdios> Adios2StMan::itsAdiosPool;
+uint64_t Adios2StMan::itsIOCount = 0;
+size_t Adios2StMan::itsLiveIOCount = 0;
+std::recursive_mutex Adios2StMan::itsRegistryMutex;
+
+// codecs tried in the automatic compression mode, in order of preference
+static const char *const itsCodecs[] = {"none", "blosc-zstd", "blosc-lz4",
+                                        "bzip2"};
+
+#ifdef HAVE_MPI
+//#warning "Adios2StMan compiled with MPI"
+
+MPI_Comm Adios2StMan::itsMpiComm = MPI_COMM_WORLD;
+
+Adios2StMan::Adios2StMan(MPI_Comm mpiComm) : DataManager()
+{
+    itsUsingMpi = true;
+    itsMpiComm = mpiComm;
+    std::string engineType;
+    adios2::Params engineParams;
+    std::vector<adios2::Params> transportParams;
+    Adios2StManCommon(engineType, engineParams, transportParams);
+}
+
+Adios2StMan::Adios2StMan(
+    MPI_Comm mpiComm, std::string engineType,
+    std::map<std::string, std::string> engineParams,
+    std::vector<std::map<std::string, std::string>> transportParams)
+: DataManager()
+{
+    itsUsingMpi = true;
+    itsMpiComm = mpiComm;
+    Adios2StManCommon(engineType, engineParams, transportParams);
+}
+#else
+//#warning "Adios2StMan compiled without MPI"
+#endif
+
+Adios2StMan::Adios2StMan() : DataManager()
+{
+    itsUsingMpi = false;
+    std::string engineType;
+    adios2::Params engineParams;
+    std::vector<adios2::Params> transportParams;
+    Adios2StManCommon(engineType, engineParams, transportParams);
+}
+
+Adios2StMan::Adios2StMan(
+    std::string engineType, std::map<std::string, std::string> engineParams,
+    std::vector<std::map<std::string, std::string>> transportParams)
+: DataManager()
+{
+    itsUsingMpi = false;
+    Adios2StManCommon(engineType, engineParams, transportParams);
+}
+
+Adios2StMan::~Adios2StMan()
+{
+    Adios2StManTraceScope trace(itsTracer.get(), "Close");
+    for (int i = 0; i < ncolumn(); ++i)
+    {
+        itsColumnPtrBlk[i]->setAccessHint(Adios2StManAccessHint());
+    }
+    itsPrefetcher.reset();
+    for (auto &worker : itsReadWorkers)
+    {
+        worker.thread.reset();
+        if (itsOpenedNrSteps == 1)
+        {
+            worker.engine->EndStep();
+        }
+        worker.engine->Close();
+        removeIO(worker.io);
+    }
+    // the IOs of shared containers and Inline channels are removed with
+    // their last user
+    bool sharedIO = !itsContainerKey.empty();
+    if (!itsContainerKey.empty())
+    {
+        endStep();
+        closeContainer();
+    }
+    else if (itsAdiosEngine)
+    {
+        endStep();
+        itsAdiosEngine->Close();
+    }
+    if (itsAdiosAppendEngine)
+    {
+        itsAdiosAppendEngine->Close();
+    }
+    removeIO(itsAdiosAppendIO);
+    std::lock_guard<std::recursive_mutex> lock(itsRegistryMutex);
+    auto it = itsInlineChannels.find(itsInlineKey);
+    if (it != itsInlineChannels.end())
+    {
+        sharedIO = true;
+        if (it->second.writer == this)
+        {
+            it->second.writer = nullptr;
+        }
+        if (it->second.reader == this)
+        {
+            it->second.reader = nullptr;
+        }
+        if (!it->second.writer && !it->second.reader)
+        {
+            removeIO(*it->second.adios, it->second.io);
+            itsInlineChannels.erase(it);
+        }
+    }
+    if (!sharedIO)
+    {
+        removeIO(itsAdiosIO);
+    }
+}
+
+void Adios2StMan::Adios2StManCommon(
+    const std::string &engineType,
+    const std::map<std::string, std::string> &engineParams,
+    const std::vector<std::map<std::string, std::string>> &transportParams)
+{
+
+    itsAdiosEngineType = engineType;
+    itsAdiosEngineParams = engineParams;
+    itsAdiosTransportParamsVec = transportParams;
+
+    std::string engineTypeLower = engineType;
+    std::transform(engineTypeLower.begin(), engineTypeLower.end(),
+                   engineTypeLower.begin(), ::tolower);
+    itsInline = (engineTypeLower == "inline");
+
+    itsAdios = acquireAdios(Adios2StMan::itsUsingMpi);
+    itsAdiosIO = declareIO(*itsAdios, "Adios2StMan");
+    configureIO(*itsAdiosIO);
+}
+
+std::shared_ptr<adios2::ADIOS> Adios2StMan::acquireAdios(bool aUsingMpi)
+{
+#ifndef HAVE_MPI
+    if (aUsingMpi)
+    {
+        throw(std::runtime_error("Adios2StMan using MPI but HAVE_MPI is not "
+                                 "defined. This should never happen"));
+    }
+#endif
+    std::lock_guard<std::recursive_mutex> lock(itsRegistryMutex);
+    std::shared_ptr<adios2::ADIOS> adios;
+    for (auto it = itsAdiosPool.begin(); it != itsAdiosPool.end();)
+    {
+        std::shared_ptr<adios2::ADIOS> pooled = it->adios.lock();
+        if (!pooled)
+        {
+            it = itsAdiosPool.erase(it);
+            continue;
+        }
+#ifdef HAVE_MPI
+        if (it->mpi == aUsingMpi && (!aUsingMpi || it->comm == itsMpiComm))
+#else
+        if (!it->mpi)
+#endif
+        {
+            adios = pooled;
+        }
+        ++it;
+    }
+    if (adios)
+    {
+        return adios;
+    }
+    PooledAdios pooled;
+    pooled.mpi = aUsingMpi;
+#ifdef HAVE_MPI
+    pooled.comm = itsMpiComm;
+    adios = aUsingMpi ? std::make_shared<adios2::ADIOS>(itsMpiComm, true)
+                      : std::make_shared<adios2::ADIOS>(true);
+#else
+    adios = std::make_shared<adios2::ADIOS>(true);
+#endif
+    pooled.adios = adios;
+    itsAdiosPool.push_back(pooled);
+    return adios;
+}
+
+size_t Adios2StMan::getAdiosInstanceCount()
+{
+    std::lock_guard<std::recursive_mutex> lock(itsRegistryMutex);
+    size_t count = 0;
+    for (auto &pooled : itsAdiosPool)
+    {
+        count += pooled.adios.expired() ? 0 : 1;
+    }
+    return count;
+}
+
+size_t Adios2StMan::getIOCount()
+{
+    std::lock_guard<std::recursive_mutex> lock(itsRegistryMutex);
+    return itsLiveIOCount;
+}
+
+std::shared_ptr<adios2::IO> Adios2StMan::declareIO(adios2::ADIOS &aAdios,
+                                                   const std::string &aPrefix)
+{
+    std::lock_guard<std::recursive_mutex> lock(itsRegistryMutex);
+    ++itsLiveIOCount;
+    return std::make_shared<adios2::IO>(
+        aAdios.DeclareIO(aPrefix + std::to_string(++itsIOCount)));
+}
+
+void Adios2StMan::removeIO(std::shared_ptr<adios2::IO> &aIO)
+{
+    if (aIO)
+    {
+        removeIO(*itsAdios, aIO);
+    }
+}
+
+void Adios2StMan::removeIO(adios2::ADIOS &aAdios,
+                           std::shared_ptr<adios2::IO> &aIO)
+{
+    std::lock_guard<std::recursive_mutex> lock(itsRegistryMutex);
+    aAdios.RemoveIO(aIO->Name());
+    aIO.reset();
+    --itsLiveIOCount;
+}
+
+void Adios2StMan::configureIO(adios2::IO &aIO)
+{
+    if (itsAdiosEngineType.empty() == false)
+    {
+        aIO.SetEngine(itsAdiosEngineType);
+    }
+    if (itsAdiosEngineParams.empty() == false)
+    {
+        aIO.SetParameters(itsAdiosEngineParams);
+    }
+    for (size_t i = 0; i < itsAdiosTransportParamsVec.size(); ++i)
+    {
+        std::string transportName = std::to_string(i);
+        auto j = itsAdiosTransportParamsVec[i].find("Name");
+        if (j != itsAdiosTransportParamsVec[i].end())
+        {
+            transportName = j->second;
+        }
+        aIO.AddTransport(transportName, itsAdiosTransportParamsVec[i]);
+    }
+}
+
+DataManager *Adios2StMan::makeObject(const String &aDataManType,
+                                     const Record &spec)
+{
+    Adios2StMan *stMan;
+    if (Adios2StMan::itsUsingMpi)
+    {
+#ifdef HAVE_MPI
+        stMan = new Adios2StMan(itsMpiComm, itsAdiosEngineType,
+                                itsAdiosEngineParams,
+                                itsAdiosTransportParamsVec);
+#else
+        throw(std::runtime_error("Adios2StMan using MPI but HAVE_MPI is not "
+                                 "defined. This should never happen"));
+        stMan = new Adios2StMan(itsAdiosEngineType, itsAdiosEngineParams,
+                                itsAdiosTransportParamsVec);
+#endif
+    }
+    else
+    {
+        stMan = new Adios2StMan(itsAdiosEngineType, itsAdiosEngineParams,
+                                itsAdiosTransportParamsVec);
+    }
+
+    if (spec.isDefined("TRACE"))
+    {
+        stMan->setTrace(spec.asString("TRACE"));
+    }
+    if (spec.isDefined("ACCESSLOG"))
+    {
+        stMan->setAccessLog(spec.asString("ACCESSLOG"));
+    }
+    if (spec.isDefined("COMPRESSION"))
+    {
+        stMan->setCompression(spec.asString("COMPRESSION"));
+    }
+    if (spec.isDefined("COMPRESSIONTARGET"))
+    {
+        stMan->setCompressionTarget(spec.asDouble("COMPRESSIONTARGET"));
+    }
+    if (spec.isDefined("COMPRESSIONS"))
+    {
+        const Record &compressions = spec.subRecord("COMPRESSIONS");
+        for (uInt i = 0; i < compressions.nfields(); ++i)
+        {
+            stMan->setColumnCompression(compressions.name(Int(i)),
+                                        compressions.asString(Int(i)));
+        }
+    }
+    if (spec.isDefined("RESIDENT"))
+    {
+        const Record &resident = spec.subRecord("RESIDENT");
+        for (uInt i = 0; i < resident.nfields(); ++i)
+        {
+            stMan->setColumnResident(resident.name(Int(i)));
+        }
+    }
+    if (spec.isDefined("RESIDENTBYTES"))
+    {
+        stMan->setResidentBytes(
+            std::max<Int64>(spec.asInt64("RESIDENTBYTES"), 0));
+    }
+    if (spec.isDefined("CONTAINER"))
+    {
+        stMan->setContainer(spec.asString("CONTAINER"));
+    }
+    if (spec.isDefined("MEMORYBUDGET"))
+    {
+        stMan->setMemoryBudget(
+            std::max<Int64>(spec.asInt64("MEMORYBUDGET"), 0));
+    }
+    if (spec.isDefined("READTHREADS"))
+    {
+        stMan->setReadThreads(std::max(spec.asInt("READTHREADS"), 0));
+    }
+    if (spec.isDefined("HUGEPAGES"))
+    {
+        stMan->setHugePages(spec.asBool("HUGEPAGES"));
+    }
+    if (spec.isDefined("ENCODINGS"))
+    {
+        const Record &encodings = spec.subRecord("ENCODINGS");
+        for (uInt i = 0; i < encodings.nfields(); ++i)
+        {
+            stMan->setColumnEncoding(encodings.name(Int(i)),
+                                     encodings.asString(Int(i)));
+        }
+    }
+    if (spec.isDefined("INLINECHANNEL"))
+    {
+        stMan->setInlineChannel(spec.asString("INLINECHANNEL"));
+    }
+    return stMan;
+}
+
+DataManager *Adios2StMan::clone() const
+{
+    return makeObject(itsDataManName, dataManagerSpec());
+}
+
+Record Adios2StMan::dataManagerSpec() const
+{
+    Record spec;
+    Record encodings;
+    for (auto &i : itsColumnEncodings)
+    {
+        encodings.define(i.first, i.second);
+    }
+    spec.defineRecord("ENCODINGS", encodings);
+    if (!itsInlineChannel.empty())
+    {
+        spec.define("INLINECHANNEL", itsInlineChannel);
+    }
+    spec.define("READTHREADS", Int(itsReadThreads));
+    spec.define("HUGEPAGES", Bool(itsBufferPool.getHugePages()));
+    spec.define("MEMORYBUDGET", Int64(itsMemoryBudget));
+    spec.define("CONTAINER", String(itsContainer));
+    Record resident;
+    for (auto &i : itsResidentColumns)
+    {
+        resident.define(i, True);
+    }
+    spec.defineRecord("RESIDENT", resident);
+    spec.define("RESIDENTBYTES", Int64(itsResidentBytes));
+    spec.define("TRACE", String(itsTrace));
+    spec.define("ACCESSLOG", String(itsAccessLog));
+    spec.define("ROWORDERKEYS", String(itsRowOrderKeys));
+    spec.define("COMPRESSION", String(itsCompression));
+    spec.define("COMPRESSIONTARGET", itsCompressionTarget);
+    Record compressions;
+    for (auto &i : itsColumnCompressions)
+    {
+        compressions.define(i.first, i.second);
+    }
+    spec.defineRecord("COMPRESSIONS", compressions);
+    return spec;
+}
+
+void Adios2StMan::setColumnEncoding(const String &aColName,
+                                    const String &aEncoding)
+{
+    if (aEncoding != "plain" && aEncoding != "rle" && aEncoding != "delta" &&
+        aEncoding != "delta2")
+    {
+        throw(std::runtime_error("Adios2StMan: unknown encoding " +
+                                 aEncoding + " for column " + aColName));
+    }
+    itsColumnEncodings[aColName] = aEncoding;
+}
+
+String Adios2StMan::getColumnEncoding(const String &aColName) const
+{
+    auto i = itsColumnEncodings.find(aColName);
+    if (i == itsColumnEncodings.end())
+    {
+        return "plain";
+    }
+    return i->second;
+}
+
+void Adios2StMan::setColumnResident(const String &aColName, Bool aResident)
+{
+    if (aResident)
+    {
+        itsResidentColumns.insert(aColName);
+    }
+    else
+    {
+        itsResidentColumns.erase(aColName);
+    }
+    for (int i = 0; i < ncolumn(); ++i)
+    {
+        itsColumnPtrBlk[i]->updateResident();
+    }
+}
+
+void Adios2StMan::setResidentBytes(uint64_t aBytes)
+{
+    itsResidentBytes = aBytes;
+    for (int i = 0; i < ncolumn(); ++i)
+    {
+        itsColumnPtrBlk[i]->updateResident();
+    }
+}
+
+uint64_t Adios2StMan::getResidentBytes() const { return itsResidentBytes; }
+
+bool Adios2StMan::isResident(const String &aColName, uint64_t aBytes) const
+{
+    return itsResidentColumns.count(aColName) > 0 ||
+           (itsResidentBytes > 0 && aBytes <= itsResidentBytes);
+}
+
+void Adios2StMan::setCompression(const String &aMode)
+{
+    if (aMode != "none" && aMode != "auto")
+    {
+        throw(std::runtime_error("Adios2StMan: unknown compression mode " +
+                                 aMode));
+    }
+    itsCompression = aMode;
+}
+
+String Adios2StMan::getCompression() const { return itsCompression; }
+
+void Adios2StMan::setCompressionTarget(double aMBPerSecond)
+{
+    itsCompressionTarget = aMBPerSecond;
+}
+
+double Adios2StMan::getCompressionTarget() const
+{
+    return itsCompressionTarget;
+}
+
+void Adios2StMan::setColumnCompression(const String &aColName,
+                                       const String &aCodec)
+{
+    if (std::find(std::begin(itsCodecs), std::end(itsCodecs), aCodec) ==
+        std::end(itsCodecs))
+    {
+        throw(std::runtime_error("Adios2StMan: unknown codec " + aCodec +
+                                 " for column " + aColName));
+    }
+    itsColumnCompressions[aColName] = aCodec;
+}
+
+String Adios2StMan::getColumnCompression(const String &aColName) const
+{
+    auto i = itsColumnCompressions.find(aColName);
+    if (i == itsColumnCompressions.end())
+    {
+        return String();
+    }
+    return i->second;
+}
+
+adios2::Operator Adios2StMan::getOperator(const std::string &aCodec)
+{
+    return defineOperator(*itsAdios, aCodec);
+}
+
+adios2::Operator Adios2StMan::defineOperator(adios2::ADIOS &aAdios,
+                                             const std::string &aCodec)
+{
+    std::string name = "Adios2StMan:" + aCodec;
+    adios2::Operator op = aAdios.InquireOperator(name);
+    if (op)
+    {
+        return op;
+    }
+    // blosc codecs are named after the blosc compressor they use
+    size_t dash = aCodec.find('-');
+    adios2::Params params;
+    if (dash != std::string::npos)
+    {
+        params["compressor"] = aCodec.substr(dash + 1);
+        params["doshuffle"] = "BLOSC_SHUFFLE";
+    }
+    return aAdios.DefineOperator(name, aCodec.substr(0, dash), params);
+}
+
+std::string Adios2StMan::selectCodec(
+    uint64_t aBytes,
+    const std::function<void(adios2::IO &, adios2::Engine &,
+                             adios2::Operator *)> &aPutSample)
+{
+    std::string codec = "none";
+    std::string path = std::string(fileName()) + ".codec";
+#ifdef HAVE_MPI
+    if (itsUsingMpi)
+    {
+        int rank;
+        MPI_Comm_rank(itsMpiComm, &rank);
+        path += "." + std::to_string(rank);
+    }
+#endif
+    path += ".bp";
+    if (aBytes > 0)
+    {
+        // the trials run on the serial ADIOS instance, so that they are
+        // neither collective nor part of the container of the table
+        std::shared_ptr<adios2::ADIOS> trial = acquireAdios(false);
+        double noneSeconds = 0;
+        uint64_t best = 0;
+        for (const char *candidate : itsCodecs)
+        {
+            bool none = (std::string(candidate) == "none");
+            std::shared_ptr<adios2::IO> io =
+                declareIO(*trial, "Adios2StManTrial");
+            io->SetEngine("BP4");
+            auto start = std::chrono::steady_clock::now();
+            try
+            {
+                adios2::Operator op;
+                if (!none)
+                {
+                    op = defineOperator(*trial, candidate);
+                }
+                adios2::Engine engine = io->Open(path, adios2::Mode::Write);
+                aPutSample(*io, engine, none ? nullptr : &op);
+                engine.Close();
+            }
+            catch (std::exception &)
+            {
+                // not built into this ADIOS, which some versions only
+                // report once the operator is used
+                removeIO(*trial, io);
+                removeScratch(path);
+                continue;
+            }
+            removeIO(*trial, io);
+            double seconds = std::chrono::duration<double>(
+                                 std::chrono::steady_clock::now() - start)
+                                 .count();
+            uint64_t bytes = removeScratch(path);
+            if (none)
+            {
+                noneSeconds = seconds;
+                best = bytes - bytes / 10;
+                continue;
+            }
+            double throughput =
+                aBytes / 1e6 / std::max(seconds - noneSeconds, 1e-6);
+            if (throughput >= itsCompressionTarget && bytes < best)
+            {
+                best = bytes;
+                codec = candidate;
+            }
+        }
+    }
+    return codec;
+}
+
+uint64_t Adios2StMan::removeScratch(const std::string &aPath)
+{
+    uint64_t bytes = 0;
+    struct stat info;
+    if (stat(aPath.c_str(), &info) != 0)
+    {
+        return 0;
+    }
+    if (S_ISDIR(info.st_mode))
+    {
+        DIR *dir = opendir(aPath.c_str());
+        if (dir)
+        {
+            while (struct dirent *entry = readdir(dir))
+            {
+                std::string name = entry->d_name;
+                if (name != "." && name != "..")
+                {
+                    bytes += removeScratch(aPath + "/" + name);
+                }
+            }
+            closedir(dir);
+        }
+        rmdir(aPath.c_str());
+        return bytes;
+    }
+    unlink(aPath.c_str());
+    return info.st_size;
+}
+
+void Adios2StMan::setTrace(const String &aPrefix)
+{
+    itsTrace = aPrefix;
+    itsTracer.reset();
+    if (itsTrace.empty())
+    {
+        return;
+    }
+    int rank = 0;
+#ifdef HAVE_MPI
+    if (itsUsingMpi)
+    {
+        MPI_Comm_rank(itsMpiComm, &rank);
+    }
+#endif
+    itsTracer = Adios2StManTracer::open(
+        itsTrace + "." + std::to_string(rank) + ".json", rank);
+}
+
+String Adios2StMan::getTrace() const { return itsTrace; }
+
+Adios2StManTracer *Adios2StMan::getTracer() const { return itsTracer.get(); }
+
+void Adios2StMan::setAccessLog(const String &aPrefix)
+{
+    itsAccessLog = aPrefix;
+    itsAccessLogger.reset();
+    if (itsAccessLog.empty())
+    {
+        return;
+    }
+    int rank = 0;
+#ifdef HAVE_MPI
+    if (itsUsingMpi)
+    {
+        MPI_Comm_rank(itsMpiComm, &rank);
+    }
+#endif
+    itsAccessLogger = Adios2StManAccessLog::open(
+        itsAccessLog + "." + std::to_string(rank) + ".log");
+}
+
+String Adios2StMan::getAccessLog() const { return itsAccessLog; }
+
+Adios2StManAccessLog *Adios2StMan::getAccessLogger() const
+{
+    return itsAccessLogger.get();
+}
+
+const std::string &Adios2StMan::getAccessLogTable() const
+{
+    return itsAccessLogTable;
+}
+
+Adios2StManBufferPool &Adios2StMan::getBufferPool() { return itsBufferPool; }
+
+void Adios2StMan::setHugePages(Bool aHugePages)
+{
+    itsBufferPool.setHugePages(aHugePages);
+}
+
+Bool Adios2StMan::getHugePages() const { return itsBufferPool.getHugePages(); }
+
+void Adios2StMan::setRowOrder(const std::vector<rownr_t> &aOrder,
+                              const String &aKeys)
+{
+    if (itsOpenMode == 'n')
+    {
+        throw(std::runtime_error(
+            "Adios2StMan: the row order can only be set once the table has "
+            "been created"));
+    }
+    if (itsOpenMode != 'w' || itsInline)
+    {
+        throw(std::runtime_error(
+            "Adios2StMan: the row order can only be set on a new table "
+            "written to a file engine"));
+    }
+    if (itsHighWaterMark > 0)
+    {
+        throw(std::runtime_error(
+            "Adios2StMan: the row order has to be set before rows are put"));
+    }
+    std::vector<uint64_t> targets(aOrder.size(), aOrder.size());
+    for (size_t i = 0; i < aOrder.size(); ++i)
+    {
+        if (aOrder[i] >= aOrder.size() || targets[aOrder[i]] != aOrder.size())
+        {
+            throw(std::runtime_error(
+                "Adios2StMan: the row order is not a permutation of rows 0 to " +
+                std::to_string(aOrder.size())));
+        }
+        targets[aOrder[i]] = i;
+    }
+    itsRowMap.build(targets);
+    itsRowOrderKeys = itsRowMap.empty() ? std::string() : std::string(aKeys);
+}
+
+String Adios2StMan::getRowOrderKeys() const { return itsRowOrderKeys; }
+
+const Adios2StManRowMap *Adios2StMan::getRowMap() const
+{
+    return itsRowMap.empty() ? 0 : &itsRowMap;
+}
+
+std::vector<rownr_t>
+Adios2StMan::sortedRowOrder(const std::vector<std::vector<Int64>> &aKeys)
+{
+    std::vector<rownr_t> order(aKeys.empty() ? 0 : aKeys[0].size());
+    for (size_t i = 0; i < order.size(); ++i)
+    {
+        order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(),
+                     [&aKeys](rownr_t a, rownr_t b) {
+                         for (auto &key : aKeys)
+                         {
+                             if (key[a] != key[b])
+                             {
+                                 return key[a] < key[b];
+                             }
+                         }
+                         return false;
+                     });
+    return order;
+}
+
+void Adios2StMan::selectCompression()
+{
+    for (int i = 0; i < ncolumn(); ++i)
+    {
+        itsColumnPtrBlk[i]->selectCompression();
+    }
+}
+
+String Adios2StMan::dataManagerType() const { return itsDataManName; }
+
+Bool Adios2StMan::canAddRow() const { return !itsInline; }
+
+void Adios2StMan::addRow64(rownr_t aNrRows)
+{
+    itsNrRows += aNrRows;
+    if (itsOpenMode == 'w' && itsNrSteps == 1)
+    {
+        // rows added while the first step is open are part of the table as
+        // created
+        itsBaseNrRows = itsNrRows;
+    }
+    for (int i = 0; i < ncolumn(); ++i)
+    {
+        itsColumnPtrBlk[i]->setNrRows(itsNrRows);
+    }
+}
+
+void Adios2StMan::create64(rownr_t aNrRows)
+{
+    Adios2StManTraceScope trace(itsTracer.get(), "Create");
+    itsOpenMode = 'w';
+    itsAccessLogTable = dirName(absolutePath(fileName()));
+    itsNrRows = aNrRows;
+    itsNrSteps = 1;
+    itsBaseNrRows = aNrRows;
+    itsReversedAxes = true;
+    if (itsInline)
+    {
+        openInline();
+    }
+    else if (itsContainer.empty())
+    {
+        itsAdiosEngine = std::make_shared<adios2::Engine>(
+            itsAdiosIO->Open(fileName(), adios2::Mode::Write));
+    }
+    else
+    {
+        itsContainerPath = absolutePath(itsContainer);
+        itsNamespace = relativePath(absolutePath(fileName()),
+                                    dirName(itsContainerPath));
+        openContainer(adios2::Mode::Write);
+    }
+    for (int i = 0; i < ncolumn(); ++i)
+    {
+        itsColumnPtrBlk[i]->create(aNrRows, itsAdiosEngine, itsOpenMode);
+    }
+    if (!itsInline)
+    {
+        beginStep();
+    }
+}
+
+rownr_t Adios2StMan::open64(rownr_t aNrRows, AipsIO &ios)
+{
+    Adios2StManTraceScope trace(itsTracer.get(), "OpenTable");
+    uInt version = ios.getstart(itsDataManName);
+    ios >> itsDataManName;
+    ios >> itsStManColumnType;
+    if (version >= 3)
+    {
+        uInt nrEncodings;
+        ios >> nrEncodings;
+        for (uInt i = 0; i < nrEncodings; ++i)
+        {
+            String colName, encoding;
+            ios >> colName;
+            ios >> encoding;
+            itsColumnEncodings[colName] = encoding;
+        }
+    }
+    itsNrSteps = 1;
+    itsBaseNrRows = aNrRows;
+    if (version >= 4)
+    {
+        // the number of rows is stored as 64 bits from version 9 on
+        uInt64 nrSteps, baseNrRows;
+        uInt baseNrRows32;
+        ios >> nrSteps;
+        if (version >= 9)
+        {
+            ios >> baseNrRows;
+        }
+        else
+        {
+            ios >> baseNrRows32;
+            baseNrRows = baseNrRows32;
+        }
+        itsNrSteps = nrSteps;
+        itsBaseNrRows = baseNrRows;
+    }
+    // containers written before version 5 declare cell axes in casacore
+    // order, so only whole cells can be selected from them correctly
+    itsReversedAxes = false;
+    if (version >= 5)
+    {
+        ios >> itsReversedAxes;
+    }
+    std::vector<uint64_t> starts, lengths, steps;
+    itsContainer.clear();
+    if (version >= 6)
+    {
+        String container, nameSpace;
+        ios >> container;
+        ios >> nameSpace;
+        if (!container.empty())
+        {
+            itsContainerPath = absolutePath(
+                dirName(absolutePath(fileName())) + "/" + container);
+            itsContainer = itsContainerPath;
+            itsNamespace = nameSpace;
+        }
+    }
+    // column layout, so that no ADIOS metadata has to be read on open
+    if (version >= 7)
+    {
+        uInt nrColumns;
+        ios >> nrColumns;
+        for (uInt i = 0; i < nrColumns; ++i)
+        {
+            String colName, adiosName;
+            Int dataType, columnType;
+            IPosition shape;
+            Bool layoutKnown;
+            ios >> colName >> adiosName >> dataType >> columnType >> shape;
+            ios >> layoutKnown;
+            if (layoutKnown)
+            {
+                uInt64 nrRuns;
+                ios >> nrRuns;
+                starts.resize(nrRuns);
+                lengths.resize(nrRuns);
+                steps.resize(nrRuns);
+                for (uInt64 j = 0; j < nrRuns; ++j)
+                {
+                    uInt64 start, length, step;
+                    ios >> start >> length >> step;
+                    starts[j] = start;
+                    lengths[j] = length;
+                    steps[j] = step;
+                }
+            }
+            for (int j = 0; j < ncolumn(); ++j)
+            {
+                Adios2StManColumn *column = itsColumnPtrBlk[j];
+                if (column->getColumnName() != colName)
+                {
+                    continue;
+                }
+                if (column->getDataType() != dataType ||
+                    column->getColumnType() != char(columnType))
+                {
+                    throw(std::runtime_error(
+                        "Adios2StMan: column " + colName +
+                        " does not match its stored description"));
+                }
+                column->setAdiosName(adiosName);
+                if (column->shape(0).size() == 0 && shape.size() > 0)
+                {
+                    column->setShapeColumn(shape);
+                }
+                if (layoutKnown)
+                {
+                    column->setLayout(starts, lengths, steps);
+                }
+            }
+        }
+    }
+    if (version >= 8)
+    {
+        uInt nrCompressions;
+        ios >> nrCompressions;
+        for (uInt i = 0; i < nrCompressions; ++i)
+        {
+            String colName, codec;
+            ios >> colName;
+            ios >> codec;
+            itsColumnCompressions[colName] = codec;
+        }
+    }
+    itsRowMap.clear();
+    if (version >= 10)
+    {
+        String keys;
+        uInt64 nrRuns;
+        ios >> keys;
+        ios >> nrRuns;
+        itsRowOrderKeys = keys;
+        for (uInt64 i = 0; i < nrRuns; ++i)
+        {
+            uInt64 start, length, target, stride;
+            ios >> start >> length >> target >> stride;
+            itsRowMap.add({start, length, target, stride});
+        }
+    }
+    ios.getend();
+
+    itsOpenMode = 'r';
+    itsAccessLogTable = dirName(absolutePath(fileName()));
+    itsNrRows = aNrRows;
+    itsOpenedNrSteps = itsNrSteps;
+    if (itsInline)
+    {
+        openInline();
+    }
+    for (int i = 0; i < ncolumn(); ++i)
+    {
+        itsColumnPtrBlk[i]->create(aNrRows, itsAdiosEngine, itsOpenMode);
+    }
+    return aNrRows;
+}
+
+std::shared_ptr<adios2::Engine> Adios2StMan::getReadEngine()
+{
+    if (!itsAdiosEngine)
+    {
+        Adios2StManTraceScope trace(itsTracer.get(), "Open");
+        if (itsContainer.empty())
+        {
+            itsAdiosEngine = std::make_shared<adios2::Engine>(
+                itsAdiosIO->Open(fileName(), getReadMode()));
+        }
+        else
+        {
+            openContainer(getReadMode());
+        }
+        if (itsOpenedNrSteps == 1)
+        {
+            beginStep();
+        }
+    }
+    return itsAdiosEngine;
+}
+
+void Adios2StMan::openInline()
+{
+    itsInlineKey = itsInlineChannel.empty() ? std::string(fileName())
+                                            : itsInlineChannel;
+    std::lock_guard<std::recursive_mutex> lock(itsRegistryMutex);
+    auto it = itsInlineChannels.find(itsInlineKey);
+    if (itsOpenMode == 'w' &&
+        (it == itsInlineChannels.end() || !it->second.writer))
+    {
+        InlineChannel &channel = itsInlineChannels[itsInlineKey];
+        channel.adios = itsAdios;
+        channel.io = itsAdiosIO;
+        channel.writer = this;
+        channel.reader = nullptr;
+        itsAdiosEngine = std::make_shared<adios2::Engine>(
+            itsAdiosIO->Open(fileName(), adios2::Mode::Write));
+        return;
+    }
+
+    // the Inline reader must be opened on the writer's IO, under an engine
+    // name of its own
+    if (it == itsInlineChannels.end() || !it->second.writer)
+    {
+        throw(std::runtime_error("Adios2StMan: no Inline writer found on "
+                                 "channel " + itsInlineKey));
+    }
+    if (it->second.reader)
+    {
+        throw(std::runtime_error("Adios2StMan: Inline channel " +
+                                 itsInlineKey + " already has a reader"));
+    }
+    itsOpenMode = 'r';
+    removeIO(itsAdiosIO);
+    itsAdios = it->second.adios;
+    itsAdiosIO = it->second.io;
+    it->second.reader = this;
+    for (int i = 0; i < ncolumn(); ++i)
+    {
+        itsColumnPtrBlk[i]->setAdiosIO(itsAdiosIO);
+    }
+    itsAdiosEngine = std::make_shared<adios2::Engine>(
+        itsAdiosIO->Open(itsInlineKey + ".reader", adios2::Mode::Read));
+}
+
+void Adios2StMan::setInlineChannel(const String &aChannel)
+{
+    itsInlineChannel = aChannel;
+}
+
+String Adios2StMan::getInlineChannel() const { return itsInlineChannel; }
+
+adios2::Mode Adios2StMan::getReadMode() const
+{
+    // a container that has been updated holds one step per update session,
+    // and cells are resolved to their newest step, which needs random access
+    if (itsOpenedNrSteps > 1)
+    {
+#if ADIOS2_VERSION_MAJOR * 100 + ADIOS2_VERSION_MINOR >= 209
+        return adios2::Mode::ReadRandomAccess;
+#endif
+    }
+    return adios2::Mode::Read;
+}
+
+std::shared_ptr<adios2::Engine> Adios2StMan::getWriteEngine()
+{
+    if (itsOpenMode == 'w')
+    {
+        return itsAdiosEngine;
+    }
+    if (itsInline)
+    {
+        throw(std::runtime_error("Adios2StMan: the Inline reader of " +
+                                 itsInlineKey + " cannot write"));
+    }
+    if (!itsContainer.empty())
+    {
+        throw(std::runtime_error("Adios2StMan: " + fileName() +
+                                 " is stored in shared container " +
+                                 itsContainerPath + " and cannot be updated"));
+    }
+    if (!itsAdiosAppendEngine)
+    {
+        Adios2StManTraceScope trace(itsTracer.get(), "OpenAppend");
+        // cells written after reopening go into a new step of the container;
+        // the IO is kept when syncWrites() closes the engine, as the columns
+        // hold the variables defined on it
+        if (!itsAdiosAppendIO)
+        {
+            itsAdiosAppendIO = declareIO(*itsAdios, "Adios2StManAppend");
+            configureIO(*itsAdiosAppendIO);
+        }
+        itsAdiosAppendEngine = std::make_shared<adios2::Engine>(
+            itsAdiosAppendIO->Open(fileName(), adios2::Mode::Append));
+    }
+    if (!itsInAppendStep)
+    {
+        Adios2StManTraceScope trace(itsTracer.get(), "BeginStep");
+        itsAdiosAppendEngine->BeginStep();
+        itsInAppendStep = true;
+        ++itsNrSteps;
+    }
+    return itsAdiosAppendEngine;
+}
+
+void Adios2StMan::syncWrites()
+{
+    if (itsOpenMode != 'r' || itsNrSteps == itsOpenedNrSteps)
+    {
+        return;
+    }
+    Adios2StManTraceScope trace(itsTracer.get(), "SyncWrites");
+    if (itsPrefetcher)
+    {
+        // the read-ahead requests run in order, so this waits for all
+        itsPrefetcher->submit([]() {}).wait();
+    }
+    endStep();
+    if (itsAdiosAppendEngine)
+    {
+        itsAdiosAppendEngine->Close();
+        itsAdiosAppendEngine.reset();
+    }
+    std::lock_guard<std::mutex> lock(itsEngineMutex);
+    for (auto &worker : itsReadWorkers)
+    {
+        worker.thread.reset();
+        if (itsOpenedNrSteps == 1)
+        {
+            worker.engine->EndStep();
+        }
+        worker.engine->Close();
+        removeIO(worker.io);
+    }
+    itsReadWorkers.clear();
+    itsReadWorkersOpened = false;
+    if (itsAdiosEngine)
+    {
+        itsAdiosEngine->Close();
+        itsAdiosEngine.reset();
+    }
+    // a fresh IO, as the variables of the old one describe fewer steps
+    removeIO(itsAdiosIO);
+    itsAdiosIO = declareIO(*itsAdios, "Adios2StMan");
+    configureIO(*itsAdiosIO);
+    itsOpenedNrSteps = itsNrSteps;
+    for (int i = 0; i < ncolumn(); ++i)
+    {
+        itsColumnPtrBlk[i]->setAdiosIO(itsAdiosIO);
+        itsColumnPtrBlk[i]->syncWrites(itsNrSteps);
+    }
+}
+
+std::shared_ptr<adios2::IO> Adios2StMan::getWriteIO()
+{
+    getWriteEngine();
+    return (itsOpenMode == 'w') ? itsAdiosIO : itsAdiosAppendIO;
+}
+
+uint64_t Adios2StMan::getNrSteps() const { return itsNrSteps; }
 
-#ifdef HAVE_MPI
-//#warning "Adios2StMan compiled with MPI"
+rownr_t Adios2StMan::getBaseNrRows() const { return itsBaseNrRows; }
 
-MPI_Comm Adios2StMan::itsMpiComm = MPI_COMM_WORLD;
+Bool Adios2StMan::hasReversedAxes() const { return itsReversedAxes; }
 
-Adios2StMan::Adios2StMan(MPI_Comm mpiComm) : DataManager()
+void Adios2StMan::setSequentialHint(const String &aColName, uInt aWindow,
+                                    uInt aDepth, const Slicer *aSlicer)
 {
-    itsUsingMpi = true;
-    itsMpiComm = mpiComm;
-    std::string engineType;
-    adios2::Params engineParams;
-    std::vector<adios2::Params> transportParams;
-    Adios2StManCommon(engineType, engineParams, transportParams);
+    Adios2StManAccessHint hint;
+    hint.kind = 's';
+    hint.window = std::max<uInt>(aWindow, 1);
+    hint.depth = std::max<uInt>(aDepth, 1);
+    setAccessHint(aColName, hint, aSlicer);
 }
 
-Adios2StMan::Adios2StMan(
-    MPI_Comm mpiComm, std::string engineType,
-    std::map<std::string, std::string> engineParams,
-    std::vector<std::map<std::string, std::string>> transportParams)
-: DataManager()
+void Adios2StMan::setRowRangesHint(
+    const String &aColName,
+    const std::vector<std::pair<rownr_t, rownr_t>> &aRanges, uInt aWindow,
+    uInt aDepth, const Slicer *aSlicer)
 {
-    itsUsingMpi = true;
-    itsMpiComm = mpiComm;
-    Adios2StManCommon(engineType, engineParams, transportParams);
+    Adios2StManAccessHint hint;
+    hint.kind = 'l';
+    hint.window = aWindow;
+    hint.depth = std::max<uInt>(aDepth, 1);
+    for (auto &range : aRanges)
+    {
+        if (range.second > 0)
+        {
+            hint.ranges.emplace_back(range.first, range.second);
+        }
+    }
+    setAccessHint(aColName, hint, aSlicer);
 }
-#else
-//#warning "Adios2StMan compiled without MPI"
-#endif
 
-Adios2StMan::Adios2StMan() : DataManager()
+void Adios2StMan::clearAccessHint(const String &aColName)
 {
-    itsUsingMpi = false;
-    std::string engineType;
-    adios2::Params engineParams;
-    std::vector<adios2::Params> transportParams;
-    Adios2StManCommon(engineType, engineParams, transportParams);
+    Adios2StManAccessHint hint;
+    setAccessHint(aColName, hint, 0);
 }
 
-Adios2StMan::Adios2StMan(
-    std::string engineType, std::map<std::string, std::string> engineParams,
-    std::vector<std::map<std::string, std::string>> transportParams)
-: DataManager()
+void Adios2StMan::setAccessHint(const String &aColName,
+                                Adios2StManAccessHint &aHint,
+                                const Slicer *aSlicer)
 {
-    itsUsingMpi = false;
-    Adios2StManCommon(engineType, engineParams, transportParams);
+    if (aSlicer)
+    {
+        aHint.sliced = true;
+        aHint.slicer = *aSlicer;
+    }
+    for (int i = 0; i < ncolumn(); ++i)
+    {
+        if (itsColumnPtrBlk[i]->getColumnName() == aColName)
+        {
+            itsColumnPtrBlk[i]->setAccessHint(aHint);
+            return;
+        }
+    }
+    throw(std::runtime_error("Adios2StMan: no column " + aColName));
 }
 
-Adios2StMan::~Adios2StMan()
+std::shared_future<void> Adios2StMan::prefetch(std::function<void()> aTask)
 {
-    if (itsAdiosEngine)
+    if (!itsPrefetcher)
     {
-        itsAdiosEngine->EndStep();
-        itsAdiosEngine->Close();
+        itsPrefetcher.reset(new Adios2StManPrefetcher());
     }
+    return itsPrefetcher->submit(std::move(aTask));
 }
 
-void Adios2StMan::Adios2StManCommon(
-    const std::string &engineType,
-    const std::map<std::string, std::string> &engineParams,
-    const std::vector<std::map<std::string, std::string>> &transportParams)
+std::mutex &Adios2StMan::getEngineMutex() { return itsEngineMutex; }
+
+void Adios2StMan::setContainer(const String &aPath)
 {
+    if (!aPath.empty() && itsInline)
+    {
+        throw(std::runtime_error(
+            "Adios2StMan: the Inline engine cannot use a shared container"));
+    }
+    itsContainer = aPath;
+}
 
-    itsAdiosEngineType = engineType;
-    itsAdiosEngineParams = engineParams;
-    itsAdiosTransportParamsVec = transportParams;
+String Adios2StMan::getContainer() const { return itsContainer; }
 
-    if (Adios2StMan::itsUsingMpi)
+std::string Adios2StMan::containerName() const
+{
+    return itsContainer.empty() ? std::string(fileName()) : itsContainerPath;
+}
+
+void Adios2StMan::openContainer(adios2::Mode aMode)
+{
+    itsContainerKey =
+        (aMode == adios2::Mode::Write ? "w:" : "r:") + itsContainerPath;
+    std::lock_guard<std::recursive_mutex> lock(itsRegistryMutex);
+    auto it = itsSharedContainers.find(itsContainerKey);
+    if (aMode != adios2::Mode::Write &&
+        itsSharedContainers.count("w:" + itsContainerPath) > 0)
+    {
+        itsContainerKey.clear();
+        throw(std::runtime_error(
+            "Adios2StMan: container " + itsContainerPath +
+            " is still being written, its tables can be read once all of "
+            "them have been closed"));
+    }
+    if (it == itsSharedContainers.end() && aMode == adios2::Mode::Write &&
+        containerExists())
+    {
+        // a container is written as a single step, which cannot be
+        // reopened for writing without overwriting the tables in it
+        itsContainerKey.clear();
+        throw(std::runtime_error(
+            "Adios2StMan: container " + itsContainerPath +
+            " has already been written and closed, new tables cannot be "
+            "added to it"));
+    }
+    if (it == itsSharedContainers.end())
+    {
+        Adios2StManTraceScope trace(itsTracer.get(), "OpenContainer");
+        SharedContainer container;
+        container.adios = itsAdios;
+        container.io = declareIO(*itsAdios, "Adios2StManContainer");
+        configureIO(*container.io);
+        container.engine = std::make_shared<adios2::Engine>(
+            container.io->Open(itsContainerPath, aMode));
+        // containers are written and read as a single step
+        container.engine->BeginStep();
+        container.users = 0;
+        it = itsSharedContainers.emplace(itsContainerKey, container).first;
+    }
+    ++it->second.users;
+    removeIO(itsAdiosIO);
+    itsAdios = it->second.adios;
+    itsAdiosIO = it->second.io;
+    itsAdiosEngine = it->second.engine;
+    for (int i = 0; i < ncolumn(); ++i)
     {
+        itsColumnPtrBlk[i]->setAdiosIO(itsAdiosIO);
+        itsColumnPtrBlk[i]->setAdiosNamespace(itsNamespace);
+    }
+}
+
+bool Adios2StMan::containerExists() const
+{
+    int exists = 0;
+    int rank = 0;
 #ifdef HAVE_MPI
-        itsAdios =
-            std::make_shared<adios2::ADIOS>(Adios2StMan::itsMpiComm, true);
-#else
-        throw(std::runtime_error("Adios2StMan using MPI but HAVE_MPI is not "
-                                 "defined. This should never happen"));
-        itsAdios = std::make_shared<adios2::ADIOS>(true);
+    if (itsUsingMpi)
+    {
+        MPI_Comm_rank(itsMpiComm, &rank);
+    }
 #endif
+    if (rank == 0)
+    {
+        struct stat info;
+        exists = (stat(itsContainerPath.c_str(), &info) == 0) ? 1 : 0;
     }
-    else
+#ifdef HAVE_MPI
+    if (itsUsingMpi)
     {
-        itsAdios = std::make_shared<adios2::ADIOS>(true);
+        // rank 0 decides, as other ranks may already see the container
+        // being created by the open that follows
+        MPI_Bcast(&exists, 1, MPI_INT, 0, itsMpiComm);
     }
+#endif
+    return exists != 0;
+}
 
-    itsAdiosIO =
-        std::make_shared<adios2::IO>(itsAdios->DeclareIO("Adios2StMan"));
-
-    if (itsAdiosEngineType.empty() == false)
+void Adios2StMan::closeContainer()
+{
+    std::lock_guard<std::recursive_mutex> lock(itsRegistryMutex);
+    auto it = itsSharedContainers.find(itsContainerKey);
+    if (it != itsSharedContainers.end() && --it->second.users == 0)
     {
-        itsAdiosIO->SetEngine(itsAdiosEngineType);
+        Adios2StManTraceScope trace(itsTracer.get(), "CloseContainer");
+        it->second.engine->EndStep();
+        it->second.engine->Close();
+        removeIO(*it->second.adios, it->second.io);
+        itsSharedContainers.erase(it);
     }
-    if (itsAdiosEngineParams.empty() == false)
+    itsContainerKey.clear();
+}
+
+std::string Adios2StMan::absolutePath(const std::string &aPath)
+{
+    std::string path = aPath;
+    if (path.empty() || path[0] != '/')
     {
-        itsAdiosIO->SetParameters(itsAdiosEngineParams);
+        char cwd[4096];
+        if (getcwd(cwd, sizeof(cwd)) == nullptr)
+        {
+            throw(std::runtime_error(
+                "Adios2StMan: cannot get the working directory"));
+        }
+        path = std::string(cwd) + "/" + path;
     }
-    for (size_t i = 0; i < itsAdiosTransportParamsVec.size(); ++i)
+    std::vector<std::string> parts;
+    size_t start = 0;
+    while (start <= path.size())
     {
-        std::string transportName = std::to_string(i);
-        auto j = itsAdiosTransportParamsVec[i].find("Name");
-        if (j != itsAdiosTransportParamsVec[i].end())
+        size_t end = path.find('/', start);
+        if (end == std::string::npos)
         {
-            transportName = j->second;
+            end = path.size();
+        }
+        std::string part = path.substr(start, end - start);
+        if (part == "..")
+        {
+            if (!parts.empty())
+            {
+                parts.pop_back();
+            }
         }
-        itsAdiosIO->AddTransport(transportName, itsAdiosTransportParamsVec[i]);
+        else if (!part.empty() && part != ".")
+        {
+            parts.push_back(part);
+        }
+        start = end + 1;
+    }
+    std::string result;
+    for (auto &part : parts)
+    {
+        result += "/" + part;
     }
+    return result.empty() ? "/" : result;
 }
 
-DataManager *Adios2StMan::makeObject(const String &aDataManType,
-                                     const Record &spec)
+std::string Adios2StMan::relativePath(const std::string &aPath,
+                                      const std::string &aDir)
 {
-    if (Adios2StMan::itsUsingMpi)
+    // both absolute and normalised
+    if (aPath == aDir)
     {
-#ifdef HAVE_MPI
-        return new Adios2StMan(itsMpiComm, itsAdiosEngineType,
-                               itsAdiosEngineParams,
-                               itsAdiosTransportParamsVec);
-#else
-        throw(std::runtime_error("Adios2StMan using MPI but HAVE_MPI is not "
-                                 "defined. This should never happen"));
-        return new Adios2StMan(itsAdiosEngineType, itsAdiosEngineParams,
-                               itsAdiosTransportParamsVec);
-#endif
+        return ".";
     }
-    else
+    std::string dir = (aDir == "/") ? aDir : aDir + "/";
+    std::string up;
+    while (aPath.compare(0, dir.size(), dir) != 0)
     {
-        return new Adios2StMan(itsAdiosEngineType, itsAdiosEngineParams,
-                               itsAdiosTransportParamsVec);
+        dir = dirName(dir.substr(0, dir.size() - 1));
+        if (dir != "/")
+        {
+            dir += "/";
+        }
+        up += "../";
     }
+    return up + aPath.substr(dir.size());
 }
 
-DataManager *Adios2StMan::clone() const
+std::string Adios2StMan::dirName(const std::string &aPath)
 {
-    Record tmp;
-    return makeObject(itsDataManName, tmp);
+    size_t slash = aPath.find_last_of('/');
+    if (slash == std::string::npos)
+    {
+        return ".";
+    }
+    return slash == 0 ? "/" : aPath.substr(0, slash);
 }
 
-String Adios2StMan::dataManagerType() const { return itsDataManName; }
+void Adios2StMan::setReadThreads(uInt aNrThreads)
+{
+    itsReadThreads = aNrThreads;
+}
+
+uInt Adios2StMan::getReadThreads() const { return itsReadThreads; }
 
-void Adios2StMan::addRow(uInt aNrRows) {}
+void Adios2StMan::setMemoryBudget(uint64_t aBytes) { itsMemoryBudget = aBytes; }
 
-void Adios2StMan::create(uInt aNrRows)
+uint64_t Adios2StMan::getMemoryBudget() const { return itsMemoryBudget; }
+
+void Adios2StMan::notePut(uint64_t aBytes)
 {
-    itsOpenMode = 'w';
-    itsNrRows = aNrRows;
-    itsAdiosEngine = std::make_shared<adios2::Engine>(
-        itsAdiosIO->Open(fileName(), adios2::Mode::Write));
-    for (int i = 0; i < ncolumn(); ++i)
+    itsBufferedBytes += aBytes;
+    itsHighWaterMark = std::max(itsHighWaterMark, itsBufferedBytes);
+    if (itsMemoryBudget > 0 && itsBufferedBytes >= itsMemoryBudget)
     {
-        itsColumnPtrBlk[i]->create(aNrRows, itsAdiosEngine, itsOpenMode);
+        spill();
     }
-    itsAdiosEngine->BeginStep();
 }
 
-void Adios2StMan::open(uInt aNrRows, AipsIO &ios)
+uint64_t Adios2StMan::getBufferedBytes() const { return itsBufferedBytes; }
+
+uint64_t Adios2StMan::getHighWaterMark() const { return itsHighWaterMark; }
+
+uint64_t Adios2StMan::getSpillCount() const { return itsSpillCount; }
+
+void Adios2StMan::spill()
 {
-    itsOpenMode = 'r';
-    itsNrRows = aNrRows;
-    itsAdiosEngine = std::make_shared<adios2::Engine>(
-        itsAdiosIO->Open(fileName(), adios2::Mode::Read));
-    for (int i = 0; i < ncolumn(); ++i)
+    Adios2StManTraceScope trace(itsTracer.get(), "Spill");
+    ++itsSpillCount;
+    if (itsInline)
     {
-        itsColumnPtrBlk[i]->create(aNrRows, itsAdiosEngine, itsOpenMode);
+        // the reader takes the rows over as its next step
+        endStep();
+        return;
     }
-    itsAdiosEngine->BeginStep();
+    std::shared_ptr<adios2::Engine> engine =
+        (itsOpenMode == 'w') ? itsAdiosEngine : itsAdiosAppendEngine;
+    selectCompression();
+#if ADIOS2_VERSION_MAJOR * 100 + ADIOS2_VERSION_MINOR >= 209
+    if (engine->Type().find("BP5") != std::string::npos)
+    {
+        engine->PerformPuts();
+        engine->PerformDataWrite();
+        itsBufferedBytes = 0;
+        return;
+    }
+#endif
+    std::string type = engine->Type();
+    bool flushes = type.find("BP4") != std::string::npos ||
+                   type.find("BP3") != std::string::npos;
+    if (flushes || !itsContainerKey.empty())
+    {
+        // complete the deferred puts and let BP3/BP4 write their buffer out
+        // within the step; a container step belongs to all of its tables,
+        // so it is never ended here
+        engine->PerformPuts();
+        if (flushes)
+        {
+            engine->Flush();
+        }
+        itsBufferedBytes = 0;
+        return;
+    }
+    // the engine has no other way to release its buffer
+    endStep();
+    if (itsOpenMode == 'w')
+    {
+        // in Append mode the next put begins the next step
+        beginStep();
+        ++itsNrSteps;
+    }
+}
 
-    ios.getstart(itsDataManName);
-    ios >> itsDataManName;
-    ios >> itsStManColumnType;
-    ios.getend();
-    itsNrRows = aNrRows;
+size_t Adios2StMan::getReadWorkers()
+{
+    std::lock_guard<std::mutex> lock(itsEngineMutex);
+    if (itsReadWorkersOpened)
+    {
+        return itsReadWorkers.size();
+    }
+    itsReadWorkersOpened = true;
+    if (itsReadThreads < 2 || itsOpenMode != 'r' || itsInline)
+    {
+        return 0;
+    }
+    Adios2StManTraceScope trace(itsTracer.get(), "OpenReadThreads");
+    itsReadWorkers.resize(itsReadThreads);
+    for (size_t i = 0; i < itsReadWorkers.size(); ++i)
+    {
+        ReadWorker &worker = itsReadWorkers[i];
+        worker.io = declareIO(*itsAdios, "Adios2StManRead");
+        configureIO(*worker.io);
+        // every thread reads on its own, so the engines are not collective
+#ifdef HAVE_MPI
+        worker.engine = std::make_shared<adios2::Engine>(
+            worker.io->Open(containerName(), getReadMode(), MPI_COMM_SELF));
+#else
+        worker.engine = std::make_shared<adios2::Engine>(
+            worker.io->Open(containerName(), getReadMode()));
+#endif
+        if (itsOpenedNrSteps == 1)
+        {
+            worker.engine->BeginStep();
+        }
+        worker.thread.reset(new Adios2StManPrefetcher());
+    }
+    return itsReadWorkers.size();
+}
+
+std::shared_future<void> Adios2StMan::submitRead(
+    size_t aWorker, std::function<void(adios2::IO &, adios2::Engine &,
+                                       adios2::Box<adios2::Dims> &)> aTask)
+{
+    ReadWorker &worker = itsReadWorkers[aWorker];
+    adios2::IO *io = worker.io.get();
+    adios2::Engine *engine = worker.engine.get();
+    adios2::Box<adios2::Dims> *selection = &worker.selection;
+    return worker.thread->submit([aTask, io, engine, selection]() {
+        aTask(*io, *engine, *selection);
+    });
+}
+
+bool Adios2StMan::beginStep()
+{
+    if (itsInStep)
+    {
+        return true;
+    }
+    Adios2StManTraceScope trace(itsTracer.get(), "BeginStep");
+    if (itsInline && itsOpenMode == 'w')
+    {
+        // the Inline writer can only begin a new step once the reader has
+        // released the previous one
+        Adios2StMan *reader = nullptr;
+        {
+            std::lock_guard<std::recursive_mutex> lock(itsRegistryMutex);
+            auto it = itsInlineChannels.find(itsInlineKey);
+            if (it != itsInlineChannels.end())
+            {
+                reader = it->second.reader;
+            }
+        }
+        if (reader)
+        {
+            reader->endStep();
+        }
+    }
+    if (itsContainerKey.empty() &&
+        itsAdiosEngine->BeginStep() != adios2::StepStatus::OK)
+    {
+        return false;
+    }
+    itsInStep = true;
+    ++itsStepCount;
+    return true;
+}
+
+void Adios2StMan::endStep()
+{
+    if (itsInAppendStep)
+    {
+        Adios2StManTraceScope trace(itsTracer.get(), "EndStep");
+        for (int i = 0; i < ncolumn(); ++i)
+        {
+            itsColumnPtrBlk[i]->finalizeStep();
+        }
+        itsAdiosAppendEngine->EndStep();
+        itsInAppendStep = false;
+        itsBufferedBytes = 0;
+    }
+    if (!itsInStep)
+    {
+        return;
+    }
+    Adios2StManTraceScope trace(itsTracer.get(), "EndStep");
+    if (itsOpenMode == 'w')
+    {
+        selectCompression();
+        for (int i = 0; i < ncolumn(); ++i)
+        {
+            itsColumnPtrBlk[i]->finalizeStep();
+        }
+    }
+    if (itsContainerKey.empty())
+    {
+        itsAdiosEngine->EndStep();
+    }
+    itsInStep = false;
+    if (itsOpenMode == 'w')
+    {
+        itsBufferedBytes = 0;
+    }
 }
 
+bool Adios2StMan::isInline() const { return itsInline; }
+
+uint64_t Adios2StMan::getStepCount() const { return itsStepCount; }
+
 void Adios2StMan::deleteManager() {}
 
 DataManagerColumn *Adios2StMan::makeScalarColumn(const String &name,
                                                  int aDataType,
                                                  const String &dataTypeId)
 {
-    return makeColumnCommon(name, aDataType, dataTypeId);
+    return makeColumnCommon(name, aDataType, dataTypeId, 's');
 }
 
 DataManagerColumn *Adios2StMan::makeDirArrColumn(const String &name,
                                                  int aDataType,
                                                  const String &dataTypeId)
 {
-    return makeColumnCommon(name, aDataType, dataTypeId);
+    return makeColumnCommon(name, aDataType, dataTypeId, 'd');
 }
 
 DataManagerColumn *Adios2StMan::makeIndArrColumn(const String &name,
                                                  int aDataType,
                                                  const String &dataTypeId)
 {
-    return makeColumnCommon(name, aDataType, dataTypeId);
+    return makeColumnCommon(name, aDataType, dataTypeId, 'i');
 }
 
 DataManagerColumn *Adios2StMan::makeColumnCommon(const String &name,
                                                  int aDataType,
-                                                 const String &dataTypeId)
+                                                 const String &dataTypeId,
+                                                 char aColumnType)
 {
     if (ncolumn() >= itsColumnPtrBlk.nelements())
     {
@@ -274,19 +1714,79 @@ DataManagerColumn *Adios2StMan::makeColumnCommon(const String &name,
             this, aDataType, ncolumn(), name, itsAdiosIO);
         break;
     }
+    aColumn->setColumnType(aColumnType);
     itsColumnPtrBlk[ncolumn()] = aColumn;
     return aColumn;
 }
 
-uInt Adios2StMan::getNrRows() { return itsNrRows; }
+rownr_t Adios2StMan::getNrRows() { return itsNrRows; }
 
-void Adios2StMan::resync(uInt aNrRows) {}
+rownr_t Adios2StMan::resync64(rownr_t aNrRows) { return aNrRows; }
 
 Bool Adios2StMan::flush(AipsIO &ios, Bool doFsync)
 {
-    ios.putstart(itsDataManName, 2);
+    Adios2StManTraceScope trace(itsTracer.get(), "Flush");
+    // codecs are chosen by now so that they are stored with the table
+    selectCompression();
+    ios.putstart(itsDataManName, 10);
     ios << itsDataManName;
     ios << itsStManColumnType;
+    ios << uInt(itsColumnEncodings.size());
+    for (auto &i : itsColumnEncodings)
+    {
+        ios << String(i.first);
+        ios << String(i.second);
+    }
+    ios << uInt64(itsNrSteps);
+    ios << uInt64(itsBaseNrRows);
+    ios << itsReversedAxes;
+    if (itsContainer.empty())
+    {
+        ios << String() << String();
+    }
+    else
+    {
+        ios << String(relativePath(itsContainerPath,
+                                   dirName(absolutePath(fileName()))));
+        ios << String(itsNamespace);
+    }
+    // the rows each rank wrote are only known to that rank
+    ios << uInt(ncolumn());
+    std::vector<uint64_t> starts, lengths, steps;
+    for (int i = 0; i < ncolumn(); ++i)
+    {
+        Adios2StManColumn *column = itsColumnPtrBlk[i];
+        ios << column->getColumnName();
+        ios << String(column->getAdiosName());
+        ios << Int(column->getDataType());
+        ios << Int(column->getColumnType());
+        ios << column->shape(0);
+        Bool layoutKnown =
+            !itsUsingMpi && column->getLayout(starts, lengths, steps);
+        ios << layoutKnown;
+        if (layoutKnown)
+        {
+            ios << uInt64(starts.size());
+            for (size_t j = 0; j < starts.size(); ++j)
+            {
+                ios << uInt64(starts[j]) << uInt64(lengths[j])
+                    << uInt64(steps[j]);
+            }
+        }
+    }
+    ios << uInt(itsColumnCompressions.size());
+    for (auto &i : itsColumnCompressions)
+    {
+        ios << String(i.first);
+        ios << String(i.second);
+    }
+    ios << String(itsRowOrderKeys);
+    ios << uInt64(itsRowMap.size());
+    for (size_t i = 0; i < itsRowMap.size(); ++i)
+    {
+        ios << uInt64(itsRowMap[i].start) << uInt64(itsRowMap[i].length)
+            << uInt64(itsRowMap[i].target) << uInt64(itsRowMap[i].stride);
+    }
     ios.putend();
     return true;
 }
@@ -20,11 +20,24 @@
 #ifndef ADIOS2STMAN_H
 #define ADIOS2STMAN_H
 
+#include "Adios2StManBuffer.h"
+#include "Adios2StManEncoding.h"
+#include "Adios2StManPrefetch.h"
+#include "Adios2StManTrace.h"
+
 #include <adios2.h>
+#include <set>
+#include <mutex>
 #include <casacore/casa/IO/AipsIO.h>
+#include <casacore/casa/version.h>
 #include <casacore/tables/DataMan/DataManager.h>
 #include <casacore/tables/Tables/Table.h>
 
+// rownr_t and the 64-bit DataManager interface came with casacore 3.4
+#if CASACORE_MAJOR_VERSION * 100 + CASACORE_MINOR_VERSION < 304
+#error "Adios2StMan requires casacore 3.4 or later"
+#endif
+
 namespace casacore
 {
 
@@ -52,12 +65,14 @@ public:
     virtual DataManager *clone() const;
     virtual String dataManagerType() const;
     virtual String dataManagerName() const;
-    virtual void create(uInt aNrRows);
-    virtual void open(uInt aRowNr, AipsIO &);
-    virtual void resync(uInt aRowNr);
+    virtual Record dataManagerSpec() const;
+    virtual void create64(rownr_t aNrRows);
+    virtual rownr_t open64(rownr_t aNrRows, AipsIO &);
+    virtual rownr_t resync64(rownr_t aNrRows);
     virtual Bool flush(AipsIO &, Bool doFsync);
     DataManagerColumn *makeColumnCommon(const String &aName, int aDataType,
-                                        const String &aDataTypeID);
+                                        const String &aDataTypeID,
+                                        char aColumnType);
     virtual DataManagerColumn *makeScalarColumn(const String &aName,
                                                 int aDataType,
                                                 const String &aDataTypeID);
@@ -68,22 +83,369 @@ public:
                                                 int aDataType,
                                                 const String &aDataTypeID);
     virtual void deleteManager();
-    virtual void addRow(uInt aNrRows);
+    virtual Bool canAddRow() const;
+    virtual void addRow64(rownr_t aNrRows);
     static DataManager *makeObject(const String &aDataManType,
                                    const Record &spec);
-    uInt getNrRows();
+    rownr_t getNrRows();
+
+    // Encoding used for a scalar column: "plain" (default), "rle", which
+    // stores runs of equal values as (start row, length, value) triples, or
+    // "delta"/"delta2", which store run-length encoded first/second
+    // differences of integer and floating point columns such as TIME.
+    // Encoded columns are held in memory in full while written and are
+    // written again as a whole into the new step when updated after
+    // reopening. A delta column only decodes and re-encodes the checkpoint
+    // intervals around the rows put; the rest of it is copied encoded.
+    void setColumnEncoding(const String &aColName, const String &aEncoding);
+    String getColumnEncoding(const String &aColName) const;
+
+    // Step control. File engines run a single step per table lifetime. With
+    // the Inline engine, a writer and a reader Adios2StMan on the same
+    // Inline channel in one process share one ADIOS IO: endStep() on the
+    // writer publishes the rows put so far, and the reader sees them as its
+    // next step without any file I/O. Steps are begun lazily on the next
+    // access, and the reader moves on to the next step when a row outside
+    // the current one is requested. The instance bound to a table can be
+    // obtained through Table::findDataManager.
+    bool beginStep();
+    void endStep();
+    bool isInline() const;
+    uint64_t getStepCount() const;
+
+    // Name of the Inline channel, kept in the INLINECHANNEL field of the
+    // data manager spec; the table's file name if not set. The first table
+    // created on a channel is its writer. A table created on a channel that
+    // already has a writer, typically a scratch table with the writer's
+    // description and row count, or a table opened on it, is its reader.
+    void setInlineChannel(const String &aChannel);
+    String getInlineChannel() const;
+
+    // Engine and IO used for puts. For a table opened from disk, the
+    // container is opened in Append mode on the first put, and the cells
+    // written are stored in a new step. Reads resolve every cell to the
+    // newest step holding it, so updating one column only writes that
+    // column. Before cells put in an update session are read, syncWrites()
+    // ends and closes the step holding them and reopens the read engine,
+    // so that they are read back from it; the next put begins a new step.
+    std::shared_ptr<adios2::Engine> getWriteEngine();
+    void syncWrites();
+    // Engine for reads. A table opened from disk only opens its engine on
+    // the first read, as the column layout is kept in the table itself.
+    std::shared_ptr<adios2::Engine> getReadEngine();
+    std::shared_ptr<adios2::IO> getWriteIO();
+    uint64_t getNrSteps() const;
+    rownr_t getBaseNrRows() const;
+    // Whether cell axes are declared to ADIOS last axis first, so that the
+    // Fortran ordered casacore cells map onto ADIOS row-major dimensions
+    // and slices can be selected by ADIOS directly.
+    Bool hasReversedAxes() const;
+
+    // Access hints for a column of a table opened for reading. A background
+    // thread reads up to aDepth requests of aWindow rows ahead of the
+    // consumer, either sequentially from the first row read or over the
+    // given (first row, nr rows) ranges in order, as whole cells or as
+    // aSlicer of every cell. getArrayV, getSliceV and getScalarV are then
+    // served from the rows read ahead when they cover the requested cell.
+    // Hints are ignored for encoded columns and the Inline engine.
+    void setSequentialHint(const String &aColName, uInt aWindow,
+                           uInt aDepth = 2, const Slicer *aSlicer = 0);
+    void setRowRangesHint(
+        const String &aColName,
+        const std::vector<std::pair<rownr_t, rownr_t>> &aRanges,
+        uInt aWindow = 0, uInt aDepth = 2, const Slicer *aSlicer = 0);
+    void clearAccessHint(const String &aColName);
+
+    // Runs aTask on the read-ahead thread. Engine calls of the task and of
+    // the columns are serialised by the engine mutex.
+    std::shared_future<void> prefetch(std::function<void()> aTask);
+    std::mutex &getEngineMutex();
+
+    // Number of threads large reads are split across, 0 (default) or 1 to
+    // read on the calling thread. Each thread reads through an engine of
+    // its own opened on the container, so reading and decompressing of the
+    // parts run in parallel. Spec field READTHREADS.
+    void setReadThreads(uInt aNrThreads);
+    uInt getReadThreads() const;
+    // Opens the read threads on first use and returns how many there are,
+    // which is 0 unless the table is read from a file engine.
+    size_t getReadWorkers();
+    // Runs aTask with the IO, engine and selection scratch of read thread
+    // aWorker.
+    std::shared_future<void>
+    submitRead(size_t aWorker,
+               std::function<void(adios2::IO &, adios2::Engine &,
+                                  adios2::Box<adios2::Dims> &)> aTask);
+
+    // Write memory budget in bytes, 0 (default) for unlimited. Columns
+    // report the bytes they put with notePut(). Once the bytes held by the
+    // engine since the last flush reach the budget, the data is written
+    // out synchronously: BP5 writes it with PerformDataWrite and BP3/BP4
+    // flush it, both within the current step. Only engines without such a
+    // call end the step and begin a new one, which reads resolve like the
+    // steps of an updated table. Flushes are collective under MPI, so
+    // ranks have to put the same volume between flushes for the budget to
+    // be usable there. Spec field MEMORYBUDGET.
+    void setMemoryBudget(uint64_t aBytes);
+    uint64_t getMemoryBudget() const;
+    void notePut(uint64_t aBytes);
+    // bytes put since the last flush, the most held at any time, and how
+    // often the budget forced a flush
+    uint64_t getBufferedBytes() const;
+    uint64_t getHighWaterMark() const;
+    uint64_t getSpillCount() const;
+
+    // Shared container. With a container path set (spec field CONTAINER),
+    // the columns of this table are stored in that ADIOS container under
+    // the path of the table relative to the directory of the container, so
+    // a table and all its subtables can share one container and one
+    // metadata index. The tables of a process share one engine per
+    // container, which is closed when the last of them is. Both paths are
+    // kept relative to the table, so the tables can be moved together.
+    // Tables in a shared container cannot be updated once written, and
+    // the Inline engine cannot be shared. A container is written until its
+    // last table is closed; it can then be read, but no longer be added to.
+    void setContainer(const String &aPath);
+    String getContainer() const;
+
+    // Residency of plain scalar columns of tables opened for reading. A
+    // resident column is read in full into memory on first access, after
+    // which its getters are served from memory. Columns are resident if
+    // listed with setColumnResident() (spec subrecord RESIDENT) or if the
+    // whole column takes at most the given number of bytes (spec field
+    // RESIDENTBYTES, 0 by default, which disables the size rule). As tables
+    // opened from disk get a manager without a spec, both can also be set
+    // on the manager bound to the table, found with Table::findDataManager.
+    void setColumnResident(const String &aColName, Bool aResident = True);
+    void setResidentBytes(uint64_t aBytes);
+    uint64_t getResidentBytes() const;
+    bool isResident(const String &aColName, uint64_t aBytes) const;
+
+    // Compression of plain columns written to file engines. A codec is one
+    // of "none", "blosc-zstd", "blosc-lz4" or "bzip2" and can be set per
+    // column (spec subrecord COMPRESSIONS). In mode "auto" (spec field
+    // COMPRESSION, "none" by default), the other numeric columns are held
+    // back until 4 MiB have been put to them or until the first flush, and
+    // what was held back is written with every codec available in ADIOS
+    // to a scratch container next to the table. The codec writing the smallest output, at least
+    // 10% below uncompressed, while compressing at least the target
+    // throughput in MB/s (spec field COMPRESSIONTARGET, 200 by default) is
+    // chosen. Choices are stored with the table, used for later updates,
+    // and returned by getColumnCompression(), which returns an empty string
+    // for a column without one. Under MPI, every rank chooses from the
+    // data it put, and the choices of the first rank are stored.
+    void setCompression(const String &aMode);
+    String getCompression() const;
+    void setCompressionTarget(double aMBPerSecond);
+    double getCompressionTarget() const;
+    void setColumnCompression(const String &aColName, const String &aCodec);
+    String getColumnCompression(const String &aColName) const;
+    // operator of aCodec defined on the ADIOS instance of the table
+    adios2::Operator getOperator(const std::string &aCodec);
+    // Runs the trials of the automatic mode. aPutSample puts aBytes of
+    // sample data with the given operator, or without one if it is null.
+    // Not collective, so that each column can choose once its sample is
+    // complete.
+    std::string selectCodec(
+        uint64_t aBytes,
+        const std::function<void(adios2::IO &, adios2::Engine &,
+                                 adios2::Operator *)> &aPutSample);
+
+    // Physical row order. By default row r is stored at row r of the ADIOS
+    // variables. setRowOrder() stores row aOrder[i] at row i instead, for
+    // instance baseline-major, so that the rows of one baseline are one
+    // contiguous range on disk. Rows are translated through a run-length
+    // coded permutation index stored with the table, so getters and
+    // putters keep taking logical row numbers; rows added later are stored
+    // in place, and encoded columns keep logical order. The order has to be
+    // set on a new table before anything is put, and cannot be used with
+    // the Inline engine. sortedRowOrder() returns the order that sorts the
+    // rows by aKeys[0], then aKeys[1], and so on, keeping rows with equal
+    // keys in their logical order. aKeys names the key columns, such as
+    // "ANTENNA1,ANTENNA2", for information (spec field ROWORDERKEYS).
+    void setRowOrder(const std::vector<rownr_t> &aOrder,
+                     const String &aKeys = String());
+    String getRowOrderKeys() const;
+    // null while rows are stored in place
+    const Adios2StManRowMap *getRowMap() const;
+    static std::vector<rownr_t>
+    sortedRowOrder(const std::vector<std::vector<Int64>> &aKeys);
+
+    // Event tracing. With a path prefix set (spec field TRACE), every
+    // engine open, close, step, put, get and flush of the storage manager
+    // and its columns is recorded with its column and rows to a Chrome
+    // trace file <prefix>.<rank>.json, shared by the tables of a rank.
+    // getTracer() returns a null pointer while tracing is off.
+    void setTrace(const String &aPrefix);
+    String getTrace() const;
+    Adios2StManTracer *getTracer() const;
+
+    // Access logging. With a path prefix set (spec field ACCESSLOG), every
+    // get and put of the columns is logged with its table, column, rows and
+    // slicer to <prefix>.<rank>.log, shared by the tables of a rank, for
+    // adios2replay to re-execute under other settings. getAccessLogger()
+    // returns a null pointer while logging is off. getAccessLogTable()
+    // is the absolute path of the table that accesses are logged for.
+    void setAccessLog(const String &aPrefix);
+    String getAccessLog() const;
+    Adios2StManAccessLog *getAccessLogger() const;
+    const std::string &getAccessLogTable() const;
+    // aPath made absolute and without . and .. parts, as logged tables are
+    static std::string absolutePath(const std::string &aPath);
+
+    // ADIOS instances are shared by the storage managers of a process, one
+    // per communicator and one for serial use, and are released with the
+    // last storage manager using them, so the communicator is duplicated
+    // once rather than per table. The engine configuration is set per IO,
+    // and every storage manager declares its IOs under names unique in the
+    // process and removes them when it is closed. getAdiosInstanceCount()
+    // returns the number of ADIOS instances currently alive, getIOCount()
+    // the number of IOs declared and not yet removed.
+    static size_t getAdiosInstanceCount();
+    static size_t getIOCount();
+
+    // Staging buffers. Cells that cannot be read into or put from the
+    // storage of the caller's array, and the temporaries of slice, row
+    // order and read-ahead reads, are staged in buffers reused from a pool
+    // owned by the storage manager, so a steady loop over rows does not
+    // allocate. With huge pages on (spec field HUGEPAGES), buffers of
+    // 2 MiB and more are backed by transparent huge pages where the system
+    // supports them.
+    Adios2StManBufferPool &getBufferPool();
+    void setHugePages(Bool aHugePages);
+    Bool getHugePages() const;
 
 private:
+    void configureIO(adios2::IO &aIO);
+    adios2::Mode getReadMode() const;
+    void spill();
+    // path of the ADIOS container holding this table
+    std::string containerName() const;
+    void openContainer(adios2::Mode aMode);
+    void closeContainer();
+    bool containerExists() const;
+    static std::string relativePath(const std::string &aPath,
+                                    const std::string &aDir);
+    static std::string dirName(const std::string &aPath);
+    void setAccessHint(const String &aColName, Adios2StManAccessHint &aHint,
+                       const Slicer *aSlicer);
+    void selectCompression();
+    static adios2::Operator defineOperator(adios2::ADIOS &aAdios,
+                                           const std::string &aCodec);
+    static std::shared_ptr<adios2::ADIOS> acquireAdios(bool aUsingMpi);
+    // declares an IO named aPrefix followed by a number unique in the
+    // process
+    static std::shared_ptr<adios2::IO>
+    declareIO(adios2::ADIOS &aAdios, const std::string &aPrefix);
+    void removeIO(std::shared_ptr<adios2::IO> &aIO);
+    static void removeIO(adios2::ADIOS &aAdios,
+                         std::shared_ptr<adios2::IO> &aIO);
+    // removes a scratch container, returning the bytes it took
+    static uint64_t removeScratch(const std::string &aPath);
+
     String itsDataManName = "Adios2StMan";
-    uInt itsNrRows;
+    rownr_t itsNrRows;
     int itsStManColumnType;
     PtrBlock<Adios2StManColumn *> itsColumnPtrBlk;
 
     std::shared_ptr<adios2::ADIOS> itsAdios;
     std::shared_ptr<adios2::IO> itsAdiosIO;
     std::shared_ptr<adios2::Engine> itsAdiosEngine;
+    std::shared_ptr<adios2::IO> itsAdiosAppendIO;
+    std::shared_ptr<adios2::Engine> itsAdiosAppendEngine;
+
+    // 'n' until the table is created ('w') or opened ('r')
+    char itsOpenMode = 'n';
+    bool itsInStep = false;
+    uint64_t itsStepCount = 0;
+    // steps in the container and rows when it was created
+    uint64_t itsNrSteps = 1;
+    uint64_t itsOpenedNrSteps = 1;
+    bool itsInAppendStep = false;
+    rownr_t itsBaseNrRows = 0;
+    Bool itsReversedAxes = false;
+
+    std::map<std::string, std::string> itsColumnEncodings;
+    std::set<std::string> itsResidentColumns;
+    uint64_t itsResidentBytes = 0;
+    std::string itsCompression = "none";
+    double itsCompressionTarget = 200;
+    std::map<std::string, std::string> itsColumnCompressions;
+    std::string itsTrace;
+    std::shared_ptr<Adios2StManTracer> itsTracer;
+    std::string itsAccessLog;
+    std::shared_ptr<Adios2StManAccessLog> itsAccessLogger;
+    std::string itsAccessLogTable;
+    std::string itsRowOrderKeys;
+    Adios2StManRowMap itsRowMap;
+
+    // before the read threads, which may still be filling buffers of it
+    Adios2StManBufferPool itsBufferPool;
+    std::unique_ptr<Adios2StManPrefetcher> itsPrefetcher;
+    std::mutex itsEngineMutex;
+
+    struct ReadWorker
+    {
+        std::shared_ptr<adios2::IO> io;
+        std::shared_ptr<adios2::Engine> engine;
+        // only used on the thread, so reused from task to task
+        adios2::Box<adios2::Dims> selection;
+        std::unique_ptr<Adios2StManPrefetcher> thread;
+    };
+    uInt itsReadThreads = 0;
+
+    uint64_t itsMemoryBudget = 0;
+    uint64_t itsBufferedBytes = 0;
+    uint64_t itsHighWaterMark = 0;
+    uint64_t itsSpillCount = 0;
+    bool itsReadWorkersOpened = false;
+    std::vector<ReadWorker> itsReadWorkers;
+
+    // Writer and reader sharing an Inline engine, keyed by channel name
+    struct InlineChannel
+    {
+        std::shared_ptr<adios2::ADIOS> adios;
+        std::shared_ptr<adios2::IO> io;
+        Adios2StMan *writer;
+        Adios2StMan *reader;
+    };
+    static std::map<std::string, InlineChannel> itsInlineChannels;
+
+    // Engine shared by the tables in one container, keyed by open mode and
+    // absolute container path
+    struct SharedContainer
+    {
+        std::shared_ptr<adios2::ADIOS> adios;
+        std::shared_ptr<adios2::IO> io;
+        std::shared_ptr<adios2::Engine> engine;
+        size_t users;
+    };
+    static std::map<std::string, SharedContainer> itsSharedContainers;
+
+    struct PooledAdios
+    {
+        bool mpi;
+#ifdef HAVE_MPI
+        MPI_Comm comm;
+#endif
+        std::weak_ptr<adios2::ADIOS> adios;
+    };
+    static std::vector<PooledAdios> itsAdiosPool;
+    static uint64_t itsIOCount;
+    static size_t itsLiveIOCount;
+    // guards the pool, the IO count, the shared containers and Inline
+    // channels, and DeclareIO/RemoveIO on the pooled instances, which
+    // storage managers of different threads share
+    static std::recursive_mutex itsRegistryMutex;
+    std::string itsContainer;     // as set, empty for a container per table
+    std::string itsContainerPath; // absolute
+    std::string itsContainerKey;
+    std::string itsNamespace;
+    bool itsInline = false;
+    std::string itsInlineChannel;
+    std::string itsInlineKey;
 
-    char itsOpenMode;
+    void openInline();
 
     static std::string itsAdiosEngineType;
     static adios2::Params itsAdiosEngineParams;
@@ -0,0 +1,135 @@
+//    (c) Oak Ridge National Laboratory
+//    1 Bethel Valley Road, Oak Ridge, TN 37830, United States
+//
+//    This library is free software: you can redistribute it and/or
+//    modify it under the terms of the GNU General Public License as published
+//    by the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License along
+//    with this library. If not, see <http://www.gnu.org/licenses/>.
+//
+//    Any bugs, questions, concerns and/or suggestions please email to
+//    wangr1@ornl.gov or jason.ruonan.wang@gmail.com
+
+#include "Adios2StManBuffer.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <new>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace casacore
+{
+
+const size_t Adios2StManBufferPool::CacheLineSize;
+const size_t Adios2StManBufferPool::HugePageSize;
+const size_t Adios2StManBufferPool::MaxFreeBytes;
+
+Adios2StManBufferPool::Adios2StManBufferPool()
+: itsHugePages(false), itsPageSize(sysconf(_SC_PAGESIZE)),
+  itsAllocationCount(0), itsPoolBytes(0), itsFreeBytes(0)
+{
+}
+
+Adios2StManBufferPool::~Adios2StManBufferPool()
+{
+    for (auto &sizeClass : itsFree)
+    {
+        for (void *data : sizeClass)
+        {
+            std::free(data);
+        }
+    }
+}
+
+void *Adios2StManBufferPool::acquire(size_t &aBytes)
+{
+    size_t log2 = 0;
+    while ((size_t(1) << log2) < std::max(aBytes, CacheLineSize))
+    {
+        ++log2;
+    }
+    aBytes = size_t(1) << log2;
+    std::lock_guard<std::mutex> lock(itsMutex);
+    if (log2 < itsFree.size() && !itsFree[log2].empty())
+    {
+        void *data = itsFree[log2].back();
+        itsFree[log2].pop_back();
+        itsFreeBytes -= aBytes;
+        return data;
+    }
+    bool huge = itsHugePages && aBytes >= HugePageSize;
+    size_t alignment = huge ? HugePageSize
+                            : (aBytes >= itsPageSize ? itsPageSize
+                                                     : CacheLineSize);
+    void *data = 0;
+    if (posix_memalign(&data, alignment, aBytes) != 0)
+    {
+        throw std::bad_alloc();
+    }
+#ifdef MADV_HUGEPAGE
+    if (huge)
+    {
+        // only a hint, the buffer works without huge pages
+        madvise(data, aBytes, MADV_HUGEPAGE);
+    }
+#endif
+    ++itsAllocationCount;
+    itsPoolBytes += aBytes;
+    return data;
+}
+
+void Adios2StManBufferPool::release(void *aData, size_t aBytes)
+{
+    size_t log2 = 0;
+    while ((size_t(1) << log2) < aBytes)
+    {
+        ++log2;
+    }
+    std::lock_guard<std::mutex> lock(itsMutex);
+    if (itsFreeBytes + aBytes > MaxFreeBytes)
+    {
+        std::free(aData);
+        itsPoolBytes -= aBytes;
+        return;
+    }
+    if (itsFree.size() <= log2)
+    {
+        itsFree.resize(log2 + 1);
+    }
+    itsFree[log2].push_back(aData);
+    itsFreeBytes += aBytes;
+}
+
+void Adios2StManBufferPool::setHugePages(bool aHugePages)
+{
+    std::lock_guard<std::mutex> lock(itsMutex);
+    itsHugePages = aHugePages;
+}
+
+bool Adios2StManBufferPool::getHugePages() const
+{
+    std::lock_guard<std::mutex> lock(itsMutex);
+    return itsHugePages;
+}
+
+uint64_t Adios2StManBufferPool::getAllocationCount() const
+{
+    std::lock_guard<std::mutex> lock(itsMutex);
+    return itsAllocationCount;
+}
+
+uint64_t Adios2StManBufferPool::getPoolBytes() const
+{
+    std::lock_guard<std::mutex> lock(itsMutex);
+    return itsPoolBytes;
+}
+
+} // namespace casacore
@@ -0,0 +1,176 @@
+//    (c) Oak Ridge National Laboratory
+//    1 Bethel Valley Road, Oak Ridge, TN 37830, United States
+//
+//    This library is free software: you can redistribute it and/or
+//    modify it under the terms of the GNU General Public License as published
+//    by the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License along
+//    with this library. If not, see <http://www.gnu.org/licenses/>.
+//
+//    Any bugs, questions, concerns and/or suggestions please email to
+//    wangr1@ornl.gov or jason.ruonan.wang@gmail.com
+
+#ifndef ADIOS2STMANBUFFER_H
+#define ADIOS2STMANBUFFER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <type_traits>
+#include <vector>
+
+namespace casacore
+{
+
+// Arena of reusable staging buffers. Sizes are rounded up to a power of two
+// and released buffers are kept on a free list per size, so that row loops
+// reuse the same few buffers instead of allocating. Buffers are aligned to
+// a cache line, or to a page from a page on. With huge pages on, buffers
+// of 2 MiB and more are aligned to and advised as huge pages. Released
+// buffers are freed instead of kept once the free lists hold MaxFreeBytes,
+// so that a few large reads do not pin their buffers for the lifetime of
+// the pool. Thread safe.
+class Adios2StManBufferPool
+{
+public:
+    static const size_t CacheLineSize = 64;
+    static const size_t HugePageSize = 2 << 20;
+    static const size_t MaxFreeBytes = 256 << 20;
+
+    Adios2StManBufferPool();
+    ~Adios2StManBufferPool();
+
+    // Returns a buffer of at least aBytes, setting aBytes to its size.
+    void *acquire(size_t &aBytes);
+    void release(void *aData, size_t aBytes);
+
+    void setHugePages(bool aHugePages);
+    bool getHugePages() const;
+    // buffers allocated from the heap so far, and bytes held by the pool,
+    // in use or free
+    uint64_t getAllocationCount() const;
+    uint64_t getPoolBytes() const;
+
+private:
+    Adios2StManBufferPool(const Adios2StManBufferPool &);
+    Adios2StManBufferPool &operator=(const Adios2StManBufferPool &);
+
+    mutable std::mutex itsMutex;
+    std::vector<std::vector<void *>> itsFree; // by log2 of the size
+    bool itsHugePages;
+    size_t itsPageSize;
+    uint64_t itsAllocationCount;
+    uint64_t itsPoolBytes;
+    uint64_t itsFreeBytes;
+};
+
+// Buffer held from a pool until it is destroyed.
+class Adios2StManBuffer
+{
+public:
+    explicit Adios2StManBuffer(Adios2StManBufferPool &aPool)
+    : itsPool(aPool), itsData(0), itsBytes(0)
+    {
+    }
+    ~Adios2StManBuffer()
+    {
+        if (itsData)
+        {
+            itsPool.release(itsData, itsBytes);
+        }
+    }
+    // Makes the buffer hold at least aBytes, keeping its first aKeepBytes.
+    void *reserve(size_t aBytes, size_t aKeepBytes = 0)
+    {
+        if (aBytes > itsBytes || !itsData)
+        {
+            size_t bytes = aBytes;
+            void *data = itsPool.acquire(bytes);
+            if (itsData)
+            {
+                std::memcpy(data, itsData, aKeepBytes);
+                itsPool.release(itsData, itsBytes);
+            }
+            itsData = data;
+            itsBytes = bytes;
+        }
+        return itsData;
+    }
+    // Returns the buffer to the pool.
+    void clear()
+    {
+        if (itsData)
+        {
+            itsPool.release(itsData, itsBytes);
+            itsData = 0;
+            itsBytes = 0;
+        }
+    }
+
+private:
+    Adios2StManBuffer(const Adios2StManBuffer &);
+    Adios2StManBuffer &operator=(const Adios2StManBuffer &);
+
+    Adios2StManBufferPool &itsPool;
+    void *itsData;
+    size_t itsBytes;
+};
+
+// Staging array of values of T in a pooled buffer. Types that are not
+// trivially copyable, such as String, are held in a vector instead.
+template <class T, bool Pooled = std::is_trivially_copyable<T>::value>
+class Adios2StManStaging
+{
+public:
+    explicit Adios2StManStaging(Adios2StManBufferPool &aPool)
+    : itsBuffer(aPool), itsData(0)
+    {
+    }
+    // Makes room for aCount values, keeping the first aKeep of them; the
+    // others are left uninitialised.
+    T *resize(size_t aCount, size_t aKeep = 0)
+    {
+        itsData = static_cast<T *>(
+            itsBuffer.reserve(aCount * sizeof(T), aKeep * sizeof(T)));
+        return itsData;
+    }
+    T *data() { return itsData; }
+    void clear()
+    {
+        itsBuffer.clear();
+        itsData = 0;
+    }
+
+private:
+    Adios2StManBuffer itsBuffer;
+    T *itsData;
+};
+
+template <class T>
+class Adios2StManStaging<T, false>
+{
+public:
+    explicit Adios2StManStaging(Adios2StManBufferPool &) {}
+    T *resize(size_t aCount, size_t = 0)
+    {
+        itsValues.resize(aCount);
+        return itsValues.data();
+    }
+    T *data() { return itsValues.data(); }
+    void clear() { std::vector<T>().swap(itsValues); }
+
+private:
+    std::vector<T> itsValues;
+};
+
+} // namespace casacore
+
+#endif
@@ -25,8 +25,11 @@ namespace casacore
 Adios2StManColumn::Adios2StManColumn(Adios2StMan *aParent, int aDataType,
                                      uInt aColNr, String aColName,
                                      std::shared_ptr<adios2::IO> aAdiosIO)
-: StManColumn(aDataType), itsStManPtr(aParent), itsCasaDataType(aDataType),
-  itsCasaShape(0), itsAdiosIO(aAdiosIO), itsColumnName(aColName)
+: StManColumnBase(aDataType), itsStManPtr(aParent), itsCasaDataType(aDataType),
+  itsCasaShape(0), itsAdiosIO(aAdiosIO), itsColumnName(aColName),
+  itsAdiosName(aColName),
+  itsColumnType('s'), itsEncoding('p'), itsOpenMode('r'), itsInline(false),
+  itsReversedAxes(false)
 {
     itsAdiosShape.resize(1);
     itsAdiosStart.resize(1);
@@ -38,23 +41,160 @@ Adios2StManColumn::Adios2StManColumn(Adios2StMan *aParent, int aDataType,
 
 String Adios2StManColumn::getColumnName() { return itsColumnName; }
 
+void Adios2StManColumn::setColumnType(char aColumnType)
+{
+    itsColumnType = aColumnType;
+}
+
 void Adios2StManColumn::setShapeColumn(const IPosition &aShape)
 {
     itsCasaShape = aShape;
     itsAdiosShape.resize(aShape.size() + 1);
     itsAdiosStart.resize(aShape.size() + 1);
     itsAdiosCount.resize(aShape.size() + 1);
-    for (int i = 1; i < itsCasaShape.size() + 1; ++i)
-    {
-        itsAdiosShape[i] = itsCasaShape[i - 1];
-        itsAdiosCount[i] = itsCasaShape[i - 1];
-        itsAdiosStart[i] = 0;
-    }
+    setAdiosCellShape();
     itsAdiosStart[0] = 0;
     itsAdiosCount[0] = 1;
 }
 
-IPosition Adios2StManColumn::shape(uInt aRowNr) { return itsCasaShape; }
+void Adios2StManColumn::setAdiosCellShape()
+{
+    size_t ndim = itsCasaShape.size();
+    for (size_t i = 0; i < ndim; ++i)
+    {
+        size_t dim = itsReversedAxes ? ndim - i : i + 1;
+        itsAdiosShape[dim] = itsCasaShape[i];
+    }
+    selectCells(0);
+}
+
+void Adios2StManColumn::selectCells(const Slicer *ns)
+{
+    size_t ndim = itsCasaShape.size();
+    for (size_t i = 0; i < ndim; ++i)
+    {
+        size_t dim = itsReversedAxes ? ndim - i : i + 1;
+        itsAdiosStart[dim] = ns ? ns->start()(i) : 0;
+        itsAdiosCount[dim] = ns ? ns->length()(i) : itsCasaShape[i];
+    }
+}
+
+bool Adios2StManColumn::isStrided(const Slicer &ns)
+{
+    for (size_t i = 0; i < ns.stride().size(); ++i)
+    {
+        if (ns.stride()(i) != 1)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+Slicer Adios2StManColumn::boundingBox(const Slicer &ns)
+{
+    IPosition length(ns.length());
+    for (size_t i = 0; i < length.size(); ++i)
+    {
+        length(i) = (length(i) - 1) * ns.stride()(i) + 1;
+    }
+    return Slicer(ns.start(), length);
+}
+
+Slicer Adios2StManColumn::boxSlice(const Slicer &ns)
+{
+    return Slicer(IPosition(ns.length().size(), 0), ns.length(), ns.stride());
+}
+
+void Adios2StManColumn::logCell(bool aPut, rownr_t aRowNr, const Slicer *ns)
+{
+    Adios2StManAccessLog *log = itsStManPtr->getAccessLogger();
+    if (!log)
+    {
+        return;
+    }
+    Adios2StManAccessLog::Access access;
+    access.put = aPut;
+    access.kind = 'c';
+    access.table = itsStManPtr->getAccessLogTable();
+    access.column = itsColumnName;
+    access.rows.emplace_back(aRowNr, 1);
+    for (size_t i = 0; ns && i < ns->ndim(); ++i)
+    {
+        access.start.push_back(ns->start()(i));
+        access.length.push_back(ns->length()(i));
+        access.stride.push_back(ns->stride()(i));
+    }
+    log->record(access);
+}
+
+void Adios2StManColumn::logRows(bool aPut, const RefRows *aRows,
+                                const Slicer *ns)
+{
+    Adios2StManAccessLog *log = itsStManPtr->getAccessLogger();
+    if (!log)
+    {
+        return;
+    }
+    Adios2StManAccessLog::Access access;
+    access.put = aPut;
+    access.kind = aRows ? 'r' : 'a';
+    access.table = itsStManPtr->getAccessLogTable();
+    access.column = itsColumnName;
+    if (aRows)
+    {
+        forEachRowRange(*aRows, [&](rownr_t aRowStart, rownr_t aNrRows) {
+            access.rows.emplace_back(aRowStart, aNrRows);
+        });
+    }
+    for (size_t i = 0; ns && i < ns->ndim(); ++i)
+    {
+        access.start.push_back(ns->start()(i));
+        access.length.push_back(ns->length()(i));
+        access.stride.push_back(ns->stride()(i));
+    }
+    log->record(access);
+}
+
+void Adios2StManColumn::setNrRows(rownr_t aNrRows)
+{
+    itsAdiosShape[0] = aNrRows;
+}
+
+void Adios2StManColumn::setAdiosIO(std::shared_ptr<adios2::IO> aAdiosIO)
+{
+    itsAdiosIO = aAdiosIO;
+}
+
+void Adios2StManColumn::setAdiosNamespace(const std::string &aNamespace)
+{
+    itsAdiosName = aNamespace.empty() ? std::string(itsColumnName)
+                                      : aNamespace + "/" + itsColumnName;
+}
+
+void Adios2StManColumn::setAdiosName(const std::string &aName)
+{
+    itsAdiosName = aName;
+}
+
+const std::string &Adios2StManColumn::getAdiosName() const
+{
+    return itsAdiosName;
+}
+
+char Adios2StManColumn::getColumnType() const { return itsColumnType; }
+
+IPosition Adios2StManColumn::shape(rownr_t aRowNr) { return itsCasaShape; }
+
+size_t Adios2StManColumn::getCellSize()
+{
+    size_t cellSize = 1;
+    for (size_t i = 1; i < itsAdiosShape.size(); ++i)
+    {
+        cellSize *= itsAdiosShape[i];
+    }
+    return cellSize;
+}
 
 int Adios2StManColumn::getDataTypeSize() { return itsDataTypeSize; }
 
@@ -64,92 +204,92 @@ int Adios2StManColumn::getDataType() { return itsCasaDataType; }
 // ------------------------------------------------------------------------------------------------------
 // ------------------------------------------------------------------------------------------------------
 
-void Adios2StManColumn::putBoolV(uInt rownr, const Bool *dataPtr)
+void Adios2StManColumn::putBool(rownr_t rownr, const Bool *dataPtr)
 {
     putScalarV(rownr, dataPtr);
 }
-void Adios2StManColumn::putuCharV(uInt rownr, const uChar *dataPtr)
+void Adios2StManColumn::putuChar(rownr_t rownr, const uChar *dataPtr)
 {
     putScalarV(rownr, dataPtr);
 }
-void Adios2StManColumn::putShortV(uInt rownr, const Short *dataPtr)
+void Adios2StManColumn::putShort(rownr_t rownr, const Short *dataPtr)
 {
     putScalarV(rownr, dataPtr);
 }
-void Adios2StManColumn::putuShortV(uInt rownr, const uShort *dataPtr)
+void Adios2StManColumn::putuShort(rownr_t rownr, const uShort *dataPtr)
 {
     putScalarV(rownr, dataPtr);
 }
-void Adios2StManColumn::putIntV(uInt rownr, const Int *dataPtr)
+void Adios2StManColumn::putInt(rownr_t rownr, const Int *dataPtr)
 {
     putScalarV(rownr, dataPtr);
 }
-void Adios2StManColumn::putuIntV(uInt rownr, const uInt *dataPtr)
+void Adios2StManColumn::putuInt(rownr_t rownr, const uInt *dataPtr)
 {
     putScalarV(rownr, dataPtr);
 }
-void Adios2StManColumn::putfloatV(uInt rownr, const Float *dataPtr)
+void Adios2StManColumn::putfloat(rownr_t rownr, const Float *dataPtr)
 {
     putScalarV(rownr, dataPtr);
 }
-void Adios2StManColumn::putdoubleV(uInt rownr, const Double *dataPtr)
+void Adios2StManColumn::putdouble(rownr_t rownr, const Double *dataPtr)
 {
     putScalarV(rownr, dataPtr);
 }
-void Adios2StManColumn::putComplexV(uInt rownr, const Complex *dataPtr)
+void Adios2StManColumn::putComplex(rownr_t rownr, const Complex *dataPtr)
 {
     putScalarV(rownr, dataPtr);
 }
-void Adios2StManColumn::putDComplexV(uInt rownr, const DComplex *dataPtr)
+void Adios2StManColumn::putDComplex(rownr_t rownr, const DComplex *dataPtr)
 {
     putScalarV(rownr, dataPtr);
 }
-void Adios2StManColumn::putStringV(uInt rownr, const String *dataPtr)
+void Adios2StManColumn::putString(rownr_t rownr, const String *dataPtr)
 {
     putScalarV(rownr, dataPtr);
 }
 
-void Adios2StManColumn::getBoolV(uInt rownr, Bool *dataPtr)
+void Adios2StManColumn::getBool(rownr_t rownr, Bool *dataPtr)
 {
     getScalarV(rownr, dataPtr);
 }
-void Adios2StManColumn::getuCharV(uInt rownr, uChar *dataPtr)
+void Adios2StManColumn::getuChar(rownr_t rownr, uChar *dataPtr)
 {
     getScalarV(rownr, dataPtr);
 }
-void Adios2StManColumn::getShortV(uInt rownr, Short *dataPtr)
+void Adios2StManColumn::getShort(rownr_t rownr, Short *dataPtr)
 {
     getScalarV(rownr, dataPtr);
 }
-void Adios2StManColumn::getuShortV(uInt rownr, uShort *dataPtr)
+void Adios2StManColumn::getuShort(rownr_t rownr, uShort *dataPtr)
 {
     getScalarV(rownr, dataPtr);
 }
-void Adios2StManColumn::getIntV(uInt rownr, Int *dataPtr)
+void Adios2StManColumn::getInt(rownr_t rownr, Int *dataPtr)
 {
     getScalarV(rownr, dataPtr);
 }
-void Adios2StManColumn::getuIntV(uInt rownr, uInt *dataPtr)
+void Adios2StManColumn::getuInt(rownr_t rownr, uInt *dataPtr)
 {
     getScalarV(rownr, dataPtr);
 }
-void Adios2StManColumn::getfloatV(uInt rownr, Float *dataPtr)
+void Adios2StManColumn::getfloat(rownr_t rownr, Float *dataPtr)
 {
     getScalarV(rownr, dataPtr);
 }
-void Adios2StManColumn::getdoubleV(uInt rownr, Double *dataPtr)
+void Adios2StManColumn::getdouble(rownr_t rownr, Double *dataPtr)
 {
     getScalarV(rownr, dataPtr);
 }
-void Adios2StManColumn::getComplexV(uInt rownr, Complex *dataPtr)
+void Adios2StManColumn::getComplex(rownr_t rownr, Complex *dataPtr)
 {
     getScalarV(rownr, dataPtr);
 }
-void Adios2StManColumn::getDComplexV(uInt rownr, DComplex *dataPtr)
+void Adios2StManColumn::getDComplex(rownr_t rownr, DComplex *dataPtr)
 {
     getScalarV(rownr, dataPtr);
 }
-void Adios2StManColumn::getStringV(uInt rownr, String *dataPtr)
+void Adios2StManColumn::getString(rownr_t rownr, String *dataPtr)
 {
     getScalarV(rownr, dataPtr);
 }
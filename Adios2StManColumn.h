@@ -21,65 +21,206 @@
 #define ADIOSSTMANCOLUMN_H
 
 #include "Adios2StMan.h"
+#include "Adios2StManEncoding.h"
 
 #include <casacore/casa/Arrays/Array.h>
-#include <casacore/tables/DataMan/StManColumn.h>
+#include <casacore/tables/DataMan/StManColumnBase.h>
+#include <casacore/tables/Tables/RefRows.h>
+
+#include <atomic>
+#include <deque>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <type_traits>
 
 namespace casacore
 {
 
-class Adios2StManColumn : public StManColumn
+class Adios2StManColumn : public StManColumnBase
 {
 public:
     Adios2StManColumn(Adios2StMan *aParent, int aDataType, uInt aColNr,
                       String aColName, std::shared_ptr<adios2::IO> aAdiosIO);
 
-    virtual void create(uInt aNrRows,
+    virtual void create(rownr_t aNrRows,
                         std::shared_ptr<adios2::Engine> aAdiosEngine,
                         char aOpenMode) = 0;
+    // called on write before the engine ends its step
+    virtual void finalizeStep() = 0;
+    // chooses the codec of a column sampled for automatic compression and
+    // puts the data held back for it
+    virtual void selectCompression() = 0;
+    virtual void setAccessHint(const Adios2StManAccessHint &aHint) = 0;
+    // called when the residency settings of the storage manager change
+    virtual void updateResident() = 0;
+
+    // called once the storage manager has ended the update step and
+    // reopened its read engine on aNrSteps steps
+    virtual void syncWrites(uint64_t aNrSteps) = 0;
     virtual void setShapeColumn(const IPosition &aShape);
-    virtual IPosition shape(uInt aRowNr);
+    virtual void setNrRows(rownr_t aNrRows);
+    void setColumnType(char aColumnType);
+    void setAdiosIO(std::shared_ptr<adios2::IO> aAdiosIO);
+    void setAdiosNamespace(const std::string &aNamespace);
+    void setAdiosName(const std::string &aName);
+    const std::string &getAdiosName() const;
+    char getColumnType() const;
+    // Rows written so far as (start row, nr rows, step) runs, which lets a
+    // reopened table find its cells without scanning the ADIOS metadata.
+    // getLayout returns false if the layout is not known.
+    virtual bool getLayout(std::vector<uint64_t> &aStarts,
+                           std::vector<uint64_t> &aLengths,
+                           std::vector<uint64_t> &aSteps) = 0;
+    virtual void setLayout(const std::vector<uint64_t> &aStarts,
+                           const std::vector<uint64_t> &aLengths,
+                           const std::vector<uint64_t> &aSteps) = 0;
+    virtual IPosition shape(rownr_t aRowNr);
 
     int getDataTypeSize();
     int getDataType();
     String getColumnName();
 
-    virtual void putScalarV(uInt aRowNr, const void *aDataPtr) = 0;
-    virtual void getScalarV(uInt aRowNr, void *aDataPtr) = 0;
-
-    virtual void putBoolV(uInt aRowNr, const Bool *aDataPtr);
-    virtual void putuCharV(uInt aRowNr, const uChar *aDataPtr);
-    virtual void putShortV(uInt aRowNr, const Short *aDataPtr);
-    virtual void putuShortV(uInt aRowNr, const uShort *aDataPtr);
-    virtual void putIntV(uInt aRowNr, const Int *aDataPtr);
-    virtual void putuIntV(uInt aRowNr, const uInt *aDataPtr);
-    virtual void putfloatV(uInt aRowNr, const Float *aDataPtr);
-    virtual void putdoubleV(uInt aRowNr, const Double *aDataPtr);
-    virtual void putComplexV(uInt aRowNr, const Complex *aDataPtr);
-    virtual void putDComplexV(uInt aRowNr, const DComplex *aDataPtr);
-    virtual void putStringV(uInt aRowNr, const String *aDataPtr);
-
-    virtual void getBoolV(uInt aRowNr, Bool *aDataPtr);
-    virtual void getuCharV(uInt aRowNr, uChar *aDataPtr);
-    virtual void getShortV(uInt aRowNr, Short *aDataPtr);
-    virtual void getuShortV(uInt aRowNr, uShort *aDataPtr);
-    virtual void getIntV(uInt aRowNr, Int *aDataPtr);
-    virtual void getuIntV(uInt aRowNr, uInt *aDataPtr);
-    virtual void getfloatV(uInt aRowNr, Float *aDataPtr);
-    virtual void getdoubleV(uInt aRowNr, Double *aDataPtr);
-    virtual void getComplexV(uInt aRowNr, Complex *aDataPtr);
-    virtual void getDComplexV(uInt aRowNr, DComplex *aDataPtr);
-    virtual void getStringV(uInt aRowNr, String *aDataPtr);
+    virtual void putScalarV(rownr_t aRowNr, const void *aDataPtr) = 0;
+    virtual void getScalarV(rownr_t aRowNr, void *aDataPtr) = 0;
+
+    virtual void putBool(rownr_t aRowNr, const Bool *aDataPtr);
+    virtual void putuChar(rownr_t aRowNr, const uChar *aDataPtr);
+    virtual void putShort(rownr_t aRowNr, const Short *aDataPtr);
+    virtual void putuShort(rownr_t aRowNr, const uShort *aDataPtr);
+    virtual void putInt(rownr_t aRowNr, const Int *aDataPtr);
+    virtual void putuInt(rownr_t aRowNr, const uInt *aDataPtr);
+    virtual void putfloat(rownr_t aRowNr, const Float *aDataPtr);
+    virtual void putdouble(rownr_t aRowNr, const Double *aDataPtr);
+    virtual void putComplex(rownr_t aRowNr, const Complex *aDataPtr);
+    virtual void putDComplex(rownr_t aRowNr, const DComplex *aDataPtr);
+    virtual void putString(rownr_t aRowNr, const String *aDataPtr);
+
+    virtual void getBool(rownr_t aRowNr, Bool *aDataPtr);
+    virtual void getuChar(rownr_t aRowNr, uChar *aDataPtr);
+    virtual void getShort(rownr_t aRowNr, Short *aDataPtr);
+    virtual void getuShort(rownr_t aRowNr, uShort *aDataPtr);
+    virtual void getInt(rownr_t aRowNr, Int *aDataPtr);
+    virtual void getuInt(rownr_t aRowNr, uInt *aDataPtr);
+    virtual void getfloat(rownr_t aRowNr, Float *aDataPtr);
+    virtual void getdouble(rownr_t aRowNr, Double *aDataPtr);
+    virtual void getComplex(rownr_t aRowNr, Complex *aDataPtr);
+    virtual void getDComplex(rownr_t aRowNr, DComplex *aDataPtr);
+    virtual void getString(rownr_t aRowNr, String *aDataPtr);
 
 
 protected:
     void getArrayWrapper(uint64_t rowStart, uint64_t nrRows, const Slicer &ns,
-                         void *dataPtr);
+                         ArrayBase &dataPtr);
+    size_t getCellSize();
+    void setAdiosCellShape();
+    // Sets the cell dimensions of itsAdiosStart and itsAdiosCount to whole
+    // cells, or to slice ns of each cell if given. Strides of ns are
+    // ignored.
+    void selectCells(const Slicer *ns);
+    static bool isStrided(const Slicer &ns);
+    // Box of a cell spanned by strided slice ns, and the slice of that box
+    // ns selects.
+    static Slicer boundingBox(const Slicer &ns);
+    static Slicer boxSlice(const Slicer &ns);
+    // Logs a get or put of cell aRowNr, or of the rows in aRows, or of all
+    // rows if aRows is null, to the access log of the storage manager if
+    // it is on.
+    void logCell(bool aPut, rownr_t aRowNr, const Slicer *ns);
+    void logRows(bool aPut, const RefRows *aRows, const Slicer *ns);
+
+    // Rows of a get: those of a RefRows, or a single row, for which no
+    // RefRows has to be built.
+    struct CellRows
+    {
+        CellRows(const RefRows &aRows) : rows(&aRows), row(0) {}
+        explicit CellRows(rownr_t aRow) : rows(0), row(aRow) {}
+        const RefRows *rows;
+        rownr_t row;
+    };
+    template <class F>
+    static void forEachRowRange(const CellRows &aRows, F aFunc)
+    {
+        if (aRows.rows)
+        {
+            forEachRowRange(*aRows.rows, aFunc);
+        }
+        else
+        {
+            aFunc(aRows.row, 1);
+        }
+    }
+    // Calls aFunc(rowStart, nrRows) for each contiguous run of rows in
+    // rownrs, in order.
+    template <class F>
+    static void forEachRowRange(const RefRows &rownrs, F aFunc)
+    {
+        RefRowsSliceIter iter(rownrs);
+        while (!iter.pastEnd())
+        {
+            rownr_t rowStart = iter.sliceStart();
+            rownr_t rowEnd = iter.sliceEnd();
+            rownr_t rowIncr = iter.sliceIncr();
+            if (rowIncr == 1)
+            {
+                aFunc(rowStart, rowEnd - rowStart + 1);
+            }
+            else
+            {
+                for (rownr_t i = rowStart; i <= rowEnd; i += rowIncr)
+                {
+                    aFunc(i, 1);
+                }
+            }
+            iter.next();
+        }
+    }
+
+    // Copies slice ns of a cell of shape aShape, both in casacore (first
+    // axis fastest) order, into aOut.
+    template <class T>
+    static void copySlice(const T *aCell, const IPosition &aShape,
+                          const Slicer &ns, T *aOut)
+    {
+        size_t ndim = aShape.size();
+        std::vector<size_t> steps(ndim, 1);
+        for (size_t i = 1; i < ndim; ++i)
+        {
+            steps[i] = steps[i - 1] * aShape[i - 1];
+        }
+        std::vector<size_t> pos(ndim, 0);
+        size_t nrRuns = ns.length().product() / ns.length()(0);
+        for (size_t k = 0; k < nrRuns; ++k)
+        {
+            const T *in = aCell + ns.start()(0);
+            for (size_t i = 1; i < ndim; ++i)
+            {
+                in += (ns.start()(i) + pos[i] * ns.stride()(i)) * steps[i];
+            }
+            for (size_t j = 0; j < size_t(ns.length()(0)); ++j)
+            {
+                *aOut++ = in[j * ns.stride()(0)];
+            }
+            for (size_t i = 1; i < ndim; ++i)
+            {
+                if (++pos[i] < size_t(ns.length()(i)))
+                {
+                    break;
+                }
+                pos[i] = 0;
+            }
+        }
+    }
 
     Adios2StMan *itsStManPtr;
 
     String itsColumnName;
+    std::string itsAdiosName; // variable name, prefixed in a shared container
     char itsColumnType; // 's'-scalar, 'd'-direct array, 'i'-indirect array
+    char itsEncoding;   // 'p'-plain, 'r'-run-length, 'd'-delta or delta2
+    char itsOpenMode;   // 'w'-write, 'r'-read
+    bool itsInline;
+    bool itsReversedAxes; // cell axes declared to ADIOS last axis first
     IPosition itsCasaShape;
     int itsDataTypeSize;
     int itsCasaDataType;
@@ -99,109 +240,1848 @@ class Adios2StManColumnT : public Adios2StManColumn
 public:
     Adios2StManColumnT(Adios2StMan *aParent, int aDataType, uInt aColNr,
                        String aColName, std::shared_ptr<adios2::IO> aAdiosIO)
-    : Adios2StManColumn(aParent, aDataType, aColNr, aColName, aAdiosIO)
+    : Adios2StManColumn(aParent, aDataType, aColNr, aColName, aAdiosIO),
+      itsStagingStep(0), itsStagingUsed(0), itsInlineStep(0), itsNrSteps(1),
+      itsBaseNrRows(0), itsVersionsLoaded(false), itsResident(false),
+      itsResidentLoaded(false), itsCompression('n'),
+      itsStagedData(aParent->getBufferPool()), itsStagedSize(0), itsHintNext(0),
+      itsPrefetchGeneration(0),
+      itsEncodingLoaded(false), itsDeltaOrder(1), itsDeltaFirstRow(0)
     {
     }
-    void create(uInt aNrRows, std::shared_ptr<adios2::Engine> aAdiosEngine,
+    void create(rownr_t aNrRows, std::shared_ptr<adios2::Engine> aAdiosEngine,
                 char aOpenMode)
     {
         itsAdiosShape[0] = aNrRows;
         itsAdiosEngine = aAdiosEngine;
-        itsAdiosVariable = itsAdiosIO->InquireVariable<T>(itsColumnName);
+        itsOpenMode = aOpenMode;
+        itsInline = itsStManPtr->isInline();
+        itsNrSteps = itsStManPtr->getNrSteps();
+        itsBaseNrRows = itsStManPtr->getBaseNrRows();
+        itsReversedAxes = itsStManPtr->hasReversedAxes();
+        setAdiosCellShape();
+        if (aOpenMode == 'w')
+        {
+            itsAdiosWriteIO = itsAdiosIO;
+            itsAdiosWriteEngine = aAdiosEngine;
+        }
+        String encoding = itsStManPtr->getColumnEncoding(itsColumnName);
+        itsEncoding = 'p';
+        if (encoding == "rle")
+        {
+            if (itsColumnType != 's' || std::is_same<T, std::string>::value)
+            {
+                throw(std::runtime_error(
+                    "Adios2StMan: rle encoding is only supported for "
+                    "numeric scalar columns, column " + itsColumnName));
+            }
+            itsEncoding = 'r';
+        }
+        else if (encoding == "delta" || encoding == "delta2")
+        {
+            if (itsColumnType != 's' || !Adios2StManDeltaTraits<T>::supported)
+            {
+                throw(std::runtime_error(
+                    "Adios2StMan: delta encoding is only supported for "
+                    "integer and floating point scalar columns, column " +
+                    itsColumnName));
+            }
+            itsEncoding = 'd';
+            itsDeltaOrder = (encoding == "delta2") ? 2 : 1;
+        }
+        if (itsEncoding != 'p')
+        {
+            if (itsInline)
+            {
+                throw(std::runtime_error(
+                    "Adios2StMan: encodings are not supported with the Inline "
+                    "engine, column " + itsColumnName));
+            }
+            itsEncodingLoaded = (aOpenMode == 'w');
+            return;
+        }
+        updateResident();
+        if (!aAdiosEngine)
+        {
+            // opened for reading, the engine is opened on the first read
+            return;
+        }
+        itsAdiosVariable = itsAdiosIO->InquireVariable<T>(itsAdiosName);
         if (!itsAdiosVariable && aOpenMode == 'w')
         {
             itsAdiosVariable = itsAdiosIO->DefineVariable<T>(
-                itsColumnName, itsAdiosShape, itsAdiosStart,
+                itsAdiosName, itsAdiosShape, itsAdiosStart,
                 itsAdiosCount);
         }
+        if (aOpenMode == 'w')
+        {
+            itsAdiosWriteVariable = itsAdiosVariable;
+            initCompression();
+        }
+    }
+    void setNrRows(rownr_t aNrRows)
+    {
+        Adios2StManColumn::setNrRows(aNrRows);
+        if (itsResidentLoaded)
+        {
+            itsResidentValues.resize(aNrRows);
+        }
+        if (itsAdiosWriteVariable)
+        {
+            itsAdiosWriteVariable.SetShape(itsAdiosShape);
+        }
     }
-    virtual void putArrayV(uInt rownr, const void *dataPtr)
+    bool getLayout(std::vector<uint64_t> &aStarts,
+                   std::vector<uint64_t> &aLengths,
+                   std::vector<uint64_t> &aSteps)
     {
-        Bool deleteIt;
-        itsAdiosStart[0] = rownr;
-        itsAdiosVariable.SetSelection(
+        // only what is in memory is used, so that a flush does not open
+        // the engine; a layout that was neither stored with the table nor
+        // read yet stays unknown and is read from the blocks on open
+        if (itsEncoding != 'p' || itsInline ||
+            (itsOpenMode == 'r' && itsNrSteps > 1 && !itsVersionsLoaded))
+        {
+            return false;
+        }
+        Adios2StManRunTable<uint64_t> layout = itsVersions;
+        for (size_t i = 0; i < itsWrittenRows.size(); ++i)
+        {
+            layout.put(itsWrittenRows[i].start, itsWrittenRows[i].length,
+                       itsWrittenRows[i].value);
+        }
+        layout.toArrays(aStarts, aLengths, aSteps);
+        return true;
+    }
+    void setLayout(const std::vector<uint64_t> &aStarts,
+                   const std::vector<uint64_t> &aLengths,
+                   const std::vector<uint64_t> &aSteps)
+    {
+        itsVersions.clear();
+        itsVersions.append(aStarts, aLengths, aSteps);
+        itsVersionsLoaded = true;
+    }
+    void updateResident()
+    {
+        itsResident = (itsOpenMode == 'r' && itsColumnType == 's' &&
+                       itsEncoding == 'p' && !itsInline &&
+                       !std::is_same<T, std::string>::value &&
+                       itsStManPtr->isResident(
+                           itsColumnName, uint64_t(itsAdiosShape[0]) * sizeof(T)));
+        if (!itsResident && itsResidentLoaded)
+        {
+            std::vector<T>().swap(itsResidentValues);
+            itsResidentLoaded = false;
+        }
+    }
+    void setAccessHint(const Adios2StManAccessHint &aHint)
+    {
+        dropPrefetch();
+        itsHint = Adios2StManAccessHint();
+        if (itsInline || itsEncoding != 'p' || itsOpenMode != 'r')
+        {
+            return;
+        }
+        itsHint = aHint;
+        itsHintNext = itsAdiosShape[0];
+        fillPrefetch();
+    }
+    void syncWrites(uint64_t aNrSteps)
+    {
+        // rows read ahead may predate the writes
+        dropPrefetch();
+        if (itsVersionsLoaded || itsNrSteps == 1)
+        {
+            for (size_t i = 0; i < itsWrittenRows.size(); ++i)
+            {
+                itsVersions.put(itsWrittenRows[i].start,
+                                itsWrittenRows[i].length,
+                                itsWrittenRows[i].value);
+            }
+            itsVersionsLoaded = true;
+        }
+        // otherwise the versions are read from the blocks of all steps
+        itsWrittenRows.clear();
+        itsNrSteps = aNrSteps;
+        itsAdiosEngine.reset();
+        itsAdiosVariable = adios2::Variable<T>();
+        // the next put gets the engine of the next step
+        itsAdiosWriteEngine.reset();
+    }
+    void selectCompression()
+    {
+        if (itsCompression != 's')
+        {
+            return;
+        }
+        Adios2StManTraceScope trace(itsStManPtr->getTracer(), "SelectCodec", &itsColumnName);
+        size_t sampleSize =
+            std::min(itsStagedSize, CompressionSampleBytes / sizeof(T));
+        const T *sample = itsStagedData.data();
+        std::string codec = itsStManPtr->selectCodec(
+            uint64_t(sampleSize) * sizeof(T),
+            [sample, sampleSize](adios2::IO &aIO, adios2::Engine &aEngine,
+                                 adios2::Operator *aOperator) {
+                auto var =
+                    aIO.DefineVariable<T>("sample", {}, {}, {sampleSize});
+                if (aOperator)
+                {
+                    var.AddOperation(*aOperator);
+                }
+                aEngine.Put(var, sample, adios2::Mode::Sync);
+            });
+        itsStManPtr->setColumnCompression(itsColumnName, codec);
+        initCompression();
+        for (auto &put : itsStagedPuts)
+        {
+            Adios2StManTraceScope trace(itsStManPtr->getTracer(), "Put", &itsColumnName,
+                                        put.start[0], put.count[0]);
+            itsAdiosWriteVariable.SetSelection({put.start, put.count});
+            itsAdiosWriteEngine->Put(itsAdiosWriteVariable,
+                                     itsStagedData.data() + put.offset,
+                                     adios2::Mode::Sync);
+        }
+        itsStagedPuts.clear();
+        itsStagedData.clear();
+        itsStagedSize = 0;
+    }
+    void finalizeStep()
+    {
+        if (!itsAdiosWriteEngine)
+        {
+            return;
+        }
+        if (itsEncoding == 'r')
+        {
+            putRunTable();
+        }
+        else if (itsEncoding == 'd')
+        {
+            putDeltaBlock();
+        }
+    }
+    virtual void putArrayV(rownr_t rownr, const ArrayBase &dataPtr)
+    {
+        logCell(true, rownr, 0);
+        prepareWrite();
+        selectCells(0);
+        uint64_t row = storedRow(rownr);
+        itsAdiosStart[0] = row;
+        itsAdiosWriteVariable.SetSelection(
             {itsAdiosStart, itsAdiosCount});
-        const T *data =
-            (reinterpret_cast<const Array<T> *>(dataPtr))->getStorage(deleteIt);
-        itsAdiosEngine->Put(itsAdiosVariable, data);
-        (reinterpret_cast<const Array<T> *>(dataPtr))
-            ->freeStorage(reinterpret_cast<const T *&>(data), deleteIt);
+        InputCells in(*itsStManPtr, dataPtr);
+        if (itsInline)
+        {
+            putInline(in.data(), getCellSize());
+        }
+        else
+        {
+            // a staged copy is released below, so it is put now
+            putPlain(in.data(), getCellSize(),
+                     in.staged() ? adios2::Mode::Sync : adios2::Mode::Deferred);
+        }
+        itsWrittenRows.put(row, itsStManPtr->getNrSteps() - 1);
+        itsStManPtr->notePut(getCellSize() * sizeof(T));
+    }
+    virtual void putScalarV(rownr_t rownr, const void *dataPtr)
+    {
+        logCell(true, rownr, 0);
+        putScalar(rownr, reinterpret_cast<const T *>(dataPtr));
+    }
+    virtual void getArrayV(rownr_t aRowNr, ArrayBase &dataPtr)
+    {
+        logCell(false, aRowNr, 0);
+        syncWrites(aRowNr, 1);
+        OutputCells out(*itsStManPtr, dataPtr);
+        if (itsHint.kind != 'n' && getPrefetched(aRowNr, 0, out.data()))
+        {
+            return;
+        }
+        if (itsInline)
+        {
+            const T *cell = getInlineCell(aRowNr);
+            std::copy(cell, cell + getCellSize(), out.data());
+            return;
+        }
+        selectCells(0);
+        getRows(aRowNr, 1, out.data());
+    }
+    virtual void getSliceV(rownr_t aRowNr, const Slicer &ns, ArrayBase &dataPtr)
+    {
+        logCell(false, aRowNr, &ns);
+        syncWrites(aRowNr, 1);
+        if (itsHint.kind != 'n')
+        {
+            OutputCells out(*itsStManPtr, dataPtr);
+            if (getPrefetched(aRowNr, &ns, out.data()))
+            {
+                return;
+            }
+        }
+        getCells(CellRows(aRowNr), &ns, dataPtr);
     }
-    virtual void putScalarV(uInt rownr, const void *dataPtr)
+    virtual void getArrayColumnV(ArrayBase &dataPtr)
     {
-        itsAdiosStart[0] = rownr;
-        itsAdiosVariable.SetSelection(
+        logRows(false, 0, 0);
+        syncWrites(0, itsAdiosShape[0]);
+        OutputCells out(*itsStManPtr, dataPtr);
+        if (itsInline)
+        {
+            size_t cellSize = getCellSize();
+            for (rownr_t i = 0; i < itsAdiosShape[0]; ++i)
+            {
+                const T *cell = getInlineCell(i);
+                std::copy(cell, cell + cellSize, out.data() + i * cellSize);
+            }
+            return;
+        }
+        selectCells(0);
+        getRows(0, itsAdiosShape[0], out.data());
+    }
+    virtual void getColumnSliceV(const Slicer &ns, ArrayBase &dataPtr)
+    {
+        logRows(false, 0, &ns);
+        if (itsAdiosShape[0] > 0)
+        {
+            getCells(RefRows(0, itsAdiosShape[0] - 1), &ns, dataPtr);
+        }
+    }
+    virtual void getScalarV(rownr_t aRowNr, void *data)
+    {
+        logCell(false, aRowNr, 0);
+        if (itsEncoding != 'p')
+        {
+            getEncoded(aRowNr, 1, reinterpret_cast<T *>(data));
+            return;
+        }
+        if (itsInline)
+        {
+            *reinterpret_cast<T *>(data) = *getInlineCell(aRowNr);
+            return;
+        }
+        syncWrites(aRowNr, 1);
+        if (itsResident)
+        {
+            loadResident();
+            *reinterpret_cast<T *>(data) = itsResidentValues[aRowNr];
+            return;
+        }
+        if (itsHint.kind != 'n' &&
+            getPrefetched(aRowNr, 0, reinterpret_cast<T *>(data)))
+        {
+            return;
+        }
+        getRows(aRowNr, 1, reinterpret_cast<T *>(data));
+    }
+    virtual void getArrayColumnCellsV(const RefRows &rownrs, ArrayBase &dataPtr)
+    {
+        logRows(false, &rownrs, 0);
+        getCells(rownrs, 0, dataPtr);
+    }
+    virtual void getColumnSliceCellsV(const RefRows &rownrs, const Slicer &ns,
+                                      ArrayBase &dataPtr)
+    {
+        logRows(false, &rownrs, &ns);
+        getCells(rownrs, &ns, dataPtr);
+    }
+    virtual void getScalarColumnV(ArrayBase &dataPtr)
+    {
+        if (itsEncoding == 'p' && itsInline)
+        {
+            // logged cell by cell through getScalarV
+            StManColumnBase::getScalarColumnV(dataPtr);
+            return;
+        }
+        logRows(false, 0, 0);
+        syncWrites(0, itsAdiosShape[0]);
+        OutputCells out(*itsStManPtr, dataPtr);
+        if (itsResident)
+        {
+            loadResident();
+            std::copy(itsResidentValues.begin(), itsResidentValues.end(),
+                      out.data());
+        }
+        else if (itsEncoding == 'p')
+        {
+            getRows(0, itsAdiosShape[0], out.data());
+        }
+        else
+        {
+            getEncoded(0, itsAdiosShape[0], out.data());
+        }
+    }
+    virtual void getScalarColumnCellsV(const RefRows &rownrs, ArrayBase &dataPtr)
+    {
+        logRows(false, &rownrs, 0);
+        if (itsEncoding == 'p' && !itsResident)
+        {
+            getCells(rownrs, 0, dataPtr);
+            return;
+        }
+        syncWrites(rownrs);
+        OutputCells cells(*itsStManPtr, dataPtr);
+        T *out = cells.data();
+        if (itsResident)
+        {
+            loadResident();
+        }
+        forEachRowRange(rownrs, [&](rownr_t aRowStart, rownr_t aNrRows) {
+            if (itsResident)
+            {
+                std::copy(&itsResidentValues[aRowStart],
+                          &itsResidentValues[aRowStart] + aNrRows, out);
+            }
+            else
+            {
+                getEncoded(aRowStart, aNrRows, out);
+            }
+            out += aNrRows;
+        });
+    }
+    virtual void putScalarColumnV(const ArrayBase &dataPtr)
+    {
+        logRows(true, 0, 0);
+        InputCells in(*itsStManPtr, dataPtr);
+        putRows(0, itsAdiosShape[0], in.data());
+    }
+    virtual void putScalarColumnCellsV(const RefRows &rownrs,
+                                       const ArrayBase &dataPtr)
+    {
+        logRows(true, &rownrs, 0);
+        InputCells in(*itsStManPtr, dataPtr);
+        putCells(rownrs, in.data());
+    }
+    virtual void putArrayColumnV(const ArrayBase &dataPtr)
+    {
+        putScalarColumnV(dataPtr);
+    }
+    virtual void putArrayColumnCellsV(const RefRows &rownrs,
+                                      const ArrayBase &dataPtr)
+    {
+        logRows(true, &rownrs, 0);
+        InputCells in(*itsStManPtr, dataPtr);
+        putCells(rownrs, in.data());
+    }
+
+private:
+    // smallest read that is split across the read threads
+    static const size_t ParallelReadBytes = 8 << 20;
+    // data per column the codecs are tried on in the automatic mode
+    static const size_t CompressionSampleBytes = 4 << 20;
+    // largest ratio of a bounding box read to the strided slice in it
+    static const size_t StridedBoxDensity = 4;
+
+    // Contiguous cells of an array read into: the storage of the array if
+    // it has contiguous storage, otherwise a pooled buffer copied into the
+    // array when this goes out of scope.
+    class OutputCells
+    {
+    public:
+        OutputCells(Adios2StMan &aStMan, ArrayBase &aArray)
+        : itsArray(*reinterpret_cast<Array<T> *>(&aArray)),
+          itsStaging(aStMan.getBufferPool()),
+          itsContiguous(itsArray.contiguousStorage())
+        {
+            itsData = itsContiguous ? itsArray.data()
+                                    : itsStaging.resize(itsArray.nelements());
+        }
+        ~OutputCells()
+        {
+            if (!itsContiguous)
+            {
+                std::copy(itsData, itsData + itsArray.nelements(),
+                          itsArray.begin());
+            }
+        }
+        T *data() { return itsData; }
+
+    private:
+        Array<T> &itsArray;
+        Adios2StManStaging<T> itsStaging;
+        bool itsContiguous;
+        T *itsData;
+    };
+    // Contiguous cells of an array put: the storage of the array, or a
+    // copy staged in a pooled buffer if its storage is not contiguous.
+    class InputCells
+    {
+    public:
+        InputCells(Adios2StMan &aStMan, const ArrayBase &aArray)
+        : itsStaging(aStMan.getBufferPool())
+        {
+            const Array<T> &array =
+                *reinterpret_cast<const Array<T> *>(&aArray);
+            itsStaged = !array.contiguousStorage();
+            if (itsStaged)
+            {
+                T *staged = itsStaging.resize(array.nelements());
+                std::copy(array.begin(), array.end(), staged);
+                itsData = staged;
+            }
+            else
+            {
+                itsData = array.data();
+            }
+        }
+        const T *data() const { return itsData; }
+        bool staged() const { return itsStaged; }
+
+    private:
+        Adios2StManStaging<T> itsStaging;
+        bool itsStaged;
+        const T *itsData;
+    };
+
+    // Adds the operator of the codec set for the column to the write
+    // variable, or starts sampling the column in the automatic mode.
+    void initCompression()
+    {
+        itsCompression = 'n';
+        if (itsInline || std::is_same<T, std::string>::value)
+        {
+            return;
+        }
+        std::string codec = itsStManPtr->getColumnCompression(itsColumnName);
+        if (codec.empty())
+        {
+            if (itsOpenMode == 'w' && itsStManPtr->getCompression() == "auto")
+            {
+                itsCompression = 's';
+            }
+            return;
+        }
+        if (codec != "none")
+        {
+            itsAdiosWriteVariable.AddOperation(
+                itsStManPtr->getOperator(codec));
+            itsCompression = 'c';
+        }
+    }
+    // Puts aSize values at the current selection. While the column is
+    // sampled, they are copied and put once its codec has been chosen,
+    // which happens as soon as a full sample has been copied.
+    void putPlain(const T *aData, size_t aSize, adios2::Mode aMode)
+    {
+        if (itsCompression != 's')
+        {
+            Adios2StManTraceScope trace(itsStManPtr->getTracer(), "Put", &itsColumnName,
+                                        itsAdiosStart[0], itsAdiosCount[0]);
+            itsAdiosWriteEngine->Put(itsAdiosWriteVariable, aData, aMode);
+            return;
+        }
+        bool contiguous = !itsStagedPuts.empty();
+        if (contiguous)
+        {
+            // rows following the previous put with the same cell selection
+            // are merged into one selection
+            const StagedPut &last = itsStagedPuts.back();
+            contiguous = (last.start[0] + last.count[0] == itsAdiosStart[0]);
+            for (size_t i = 1; contiguous && i < itsAdiosStart.size(); ++i)
+            {
+                contiguous = (last.start[i] == itsAdiosStart[i] &&
+                              last.count[i] == itsAdiosCount[i]);
+            }
+        }
+        if (contiguous)
+        {
+            itsStagedPuts.back().count[0] += itsAdiosCount[0];
+        }
+        else
+        {
+            itsStagedPuts.push_back(
+                {itsAdiosStart, itsAdiosCount, itsStagedSize});
+        }
+        T *staged = itsStagedData.resize(itsStagedSize + aSize, itsStagedSize);
+        std::copy(aData, aData + aSize, staged + itsStagedSize);
+        itsStagedSize += aSize;
+        if (itsStagedSize * sizeof(T) >= CompressionSampleBytes)
+        {
+            selectCompression();
+        }
+    }
+
+    // Puts scalar aRowNr without logging it, for the puts of several rows
+    // that are logged as a whole.
+    void putScalar(rownr_t aRowNr, const T *aData)
+    {
+        prepareWrite();
+        if (itsEncoding == 'r')
+        {
+            itsRunTable.put(aRowNr, *aData);
+            return;
+        }
+        if (itsEncoding == 'd')
+        {
+            putDeltaValue(aRowNr, *aData);
+            return;
+        }
+        uint64_t row = storedRow(aRowNr);
+        itsAdiosStart[0] = row;
+        itsAdiosWriteVariable.SetSelection(
             {itsAdiosStart, itsAdiosCount});
-        itsAdiosEngine->Put(itsAdiosVariable,
-                            reinterpret_cast<const T *>(dataPtr));
+        if (itsInline)
+        {
+            putInline(aData, 1);
+        }
+        else
+        {
+            putPlain(aData, 1, adios2::Mode::Deferred);
+        }
+        if (itsResidentLoaded)
+        {
+            itsResidentValues[aRowNr] = *aData;
+        }
+        itsWrittenRows.put(row, itsStManPtr->getNrSteps() - 1);
+        itsStManPtr->notePut(sizeof(T));
     }
-    virtual void getArrayV(uInt aRowNr, void *dataPtr)
+    // Puts aNrRows full cells starting at aRowStart with one selection per
+    // range of rows stored contiguously.
+    void putRows(rownr_t aRowStart, rownr_t aNrRows, const T *aData)
     {
-        itsAdiosStart[0] = aRowNr;
-        itsAdiosCount[0] = 1;
-        for (int i = 1; i < itsAdiosShape.size(); ++i)
+        prepareWrite();
+        if (itsEncoding == 'r' || itsEncoding == 'd')
+        {
+            for (rownr_t i = 0; i < aNrRows; ++i)
+            {
+                putScalar(aRowStart + i, aData + i);
+            }
+            return;
+        }
+        if (aNrRows == 0)
+        {
+            return;
+        }
+        selectCells(0);
+        size_t cellSize = getCellSize();
+        const T *in = aData;
+        forEachStoredRange(RefRows(aRowStart, aRowStart + aNrRows - 1),
+                           [&](uint64_t aStart, uint64_t aN) {
+                               putStoredRows(aStart, aN, in);
+                               in += aN * cellSize;
+                           });
+        if (itsResidentLoaded)
         {
-            itsAdiosStart[i] = 0;
-            itsAdiosCount[i] = itsAdiosShape[i];
+            std::copy(aData, aData + aNrRows, &itsResidentValues[aRowStart]);
         }
-        itsAdiosVariable.SetSelection({itsAdiosStart, itsAdiosCount});
-        Bool deleteIt;
-        T *data = (reinterpret_cast<Array<T>*>(dataPtr))->getStorage(deleteIt);
-        itsAdiosEngine->Get<T>(itsAdiosVariable, data,adios2::Mode::Sync);
-        reinterpret_cast<Array<T>*>(dataPtr)->putStorage(reinterpret_cast<T *&>(data), deleteIt);
+        itsStManPtr->notePut(uint64_t(aNrRows) * cellSize * sizeof(T));
     }
-    virtual void getSliceV(uInt aRowNr, const Slicer &ns, void *dataPtr)
+    // Puts the cells of rownrs, which are consecutive in aData.
+    void putCells(const RefRows &rownrs, const T *aData)
     {
-        itsAdiosStart[0] = aRowNr;
+        prepareWrite();
+        const T *in = aData;
+        size_t cellSize = getCellSize();
+        if (itsEncoding != 'p' || itsResidentLoaded)
+        {
+            forEachRowRange(rownrs, [&](rownr_t aRowStart, rownr_t aNrRows) {
+                putRows(aRowStart, aNrRows, in);
+                in += aNrRows * cellSize;
+            });
+            return;
+        }
+        selectCells(0);
+        uint64_t nrRows = 0;
+        forEachStoredRange(rownrs, [&](uint64_t aStart, uint64_t aN) {
+            putStoredRows(aStart, aN, in);
+            in += aN * cellSize;
+            nrRows += aN;
+        });
+        itsStManPtr->notePut(nrRows * cellSize * sizeof(T));
+    }
+    // Puts aNrRows full cells at stored rows [aRowStart, aRowStart + aNrRows)
+    // with a single selection. The put is synchronous because aData may be
+    // a temporary copy.
+    void putStoredRows(uint64_t aRowStart, uint64_t aNrRows, const T *aData)
+    {
+        itsAdiosStart[0] = aRowStart;
+        itsAdiosCount[0] = aNrRows;
+        itsAdiosWriteVariable.SetSelection({itsAdiosStart, itsAdiosCount});
+        if (itsInline)
+        {
+            putInline(aData, aNrRows * getCellSize());
+        }
+        else
+        {
+            putPlain(aData, aNrRows * getCellSize(), adios2::Mode::Sync);
+        }
         itsAdiosCount[0] = 1;
-        for (int i = 1; i < itsAdiosShape.size(); ++i)
+        itsWrittenRows.put(aRowStart, aNrRows, itsStManPtr->getNrSteps() - 1);
+    }
+    // Before rows put since the table was reopened are read back, has the
+    // storage manager end the step they were put in.
+    void syncWrites(uint64_t aRowNr, uint64_t aNrRows)
+    {
+        if (itsWrittenRows.size() > 0 && itsOpenMode == 'r' &&
+            (itsStManPtr->getRowMap() ||
+             itsWrittenRows.overlaps(aRowNr, aNrRows)))
         {
-            itsAdiosStart[i] = ns.start()(i - 1);
-            itsAdiosCount[i] = ns.length()(i - 1);
+            itsStManPtr->syncWrites();
         }
-        itsAdiosVariable.SetSelection({itsAdiosStart, itsAdiosCount});
-        Bool deleteIt;
-        T *data = (reinterpret_cast<Array<T>*>(dataPtr))->getStorage(deleteIt);
-        itsAdiosEngine->Get<T>(itsAdiosVariable, data,adios2::Mode::Sync);
-        reinterpret_cast<Array<T>*>(dataPtr)->putStorage(reinterpret_cast<T *&>(data), deleteIt);
     }
-    virtual void getArrayColumnV(void *dataPtr)
+    void syncWrites(const CellRows &rownrs)
+    {
+        forEachRowRange(rownrs, [&](rownr_t aRowStart, rownr_t aNrRows) {
+            syncWrites(aRowStart, aNrRows);
+        });
+    }
+    // Row aRowNr is stored at.
+    uint64_t storedRow(uint64_t aRowNr) const
     {
-        for(auto &i:itsAdiosStart){
-            i=0;
+        const Adios2StManRowMap *map = itsStManPtr->getRowMap();
+        return map ? map->map(aRowNr) : aRowNr;
+    }
+    // Calls aFunc(storedStart, nrRows) for each range of the rows in
+    // rownrs that are stored contiguously, in the order of rownrs.
+    template <class F>
+    void forEachStoredRange(const CellRows &rownrs, F aFunc)
+    {
+        const Adios2StManRowMap *map = itsStManPtr->getRowMap();
+        if (!map)
+        {
+            forEachRowRange(rownrs, aFunc);
+            return;
+        }
+        uint64_t start = 0;
+        uint64_t count = 0;
+        auto add = [&](uint64_t aRow, uint64_t aN) {
+            if (count > 0 && start + count == aRow)
+            {
+                count += aN;
+                return;
+            }
+            if (count > 0)
+            {
+                aFunc(start, count);
+            }
+            start = aRow;
+            count = aN;
+        };
+        forEachRowRange(rownrs, [&](rownr_t aRowStart, rownr_t aNrRows) {
+            map->forEachRun(aRowStart, aNrRows, [&](uint64_t aTarget,
+                                                    uint64_t aN,
+                                                    uint64_t aStride) {
+                if (aStride == 1)
+                {
+                    add(aTarget, aN);
+                    return;
+                }
+                for (uint64_t i = 0; i < aN; ++i)
+                {
+                    add(aTarget + i * aStride, 1);
+                }
+            });
+        });
+        if (count > 0)
+        {
+            aFunc(start, count);
         }
-        itsAdiosVariable.SetSelection({itsAdiosStart, itsAdiosShape});
-        Bool deleteIt;
-        T *data = (reinterpret_cast<Array<T>*>(dataPtr))->getStorage(deleteIt);
-        itsAdiosEngine->Get<T>(itsAdiosVariable, data,adios2::Mode::Sync);
-        reinterpret_cast<Array<T>*>(dataPtr)->putStorage(reinterpret_cast<T *&>(data), deleteIt);
     }
-    virtual void getColumnSliceV(const Slicer &ns, void *dataPtr)
+    // Reads the rows in rownrs into dataPtr, as whole cells or as slice ns
+    // of each cell. Every range of rows stored contiguously is a single
+    // selection that is read straight into its part of the output.
+    void getCells(const CellRows &rownrs, const Slicer *ns, ArrayBase &dataPtr)
     {
-        itsAdiosStart[0] = 0;
-        itsAdiosCount[0] = itsAdiosShape[0];
-        for (int i = 1; i < itsAdiosShape.size(); ++i)
+        syncWrites(rownrs);
+        OutputCells output(*itsStManPtr, dataPtr);
+        T *out = output.data();
+        size_t cellSize = ns ? ns->length().product() : getCellSize();
+        if (itsInline)
         {
-            itsAdiosStart[i] = ns.start()(i - 1);
-            itsAdiosCount[i] = ns.length()(i - 1);
+            forEachRowRange(rownrs, [&](rownr_t aRowStart, rownr_t aNrRows) {
+                for (rownr_t i = aRowStart; i < aRowStart + aNrRows; ++i)
+                {
+                    const T *cell = getInlineCell(i);
+                    if (ns)
+                    {
+                        copySlice(cell, itsCasaShape, *ns, out);
+                    }
+                    else
+                    {
+                        std::copy(cell, cell + cellSize, out);
+                    }
+                    out += cellSize;
+                }
+            });
         }
-        itsAdiosVariable.SetSelection({itsAdiosStart, itsAdiosCount});
-        Bool deleteIt;
-        T *data = (reinterpret_cast<Array<T>*>(dataPtr))->getStorage(deleteIt);
-        itsAdiosEngine->Get<T>(itsAdiosVariable, data,adios2::Mode::Sync);
-        reinterpret_cast<Array<T>*>(dataPtr)->putStorage(reinterpret_cast<T *&>(data), deleteIt);
+        else if (ns && !itsReversedAxes && itsCasaShape.size() > 1)
+        {
+            // older containers: read whole cells and slice them in memory
+            selectCells(0);
+            size_t fullSize = getCellSize();
+            Adios2StManStaging<T> cells(itsStManPtr->getBufferPool());
+            forEachStoredRange(rownrs, [&](uint64_t aRowStart, uint64_t aNrRows) {
+                getStoredRows(aRowStart, aNrRows, cells.resize(aNrRows * fullSize));
+                for (rownr_t i = 0; i < aNrRows; ++i)
+                {
+                    copySlice(cells.data() + i * fullSize, itsCasaShape, *ns,
+                              out);
+                    out += cellSize;
+                }
+            });
+        }
+        else if (ns && isStrided(*ns))
+        {
+            getStridedCells(rownrs, *ns, out);
+        }
+        else
+        {
+            selectCells(ns);
+            forEachStoredRange(rownrs, [&](uint64_t aRowStart, uint64_t aNrRows) {
+                getStoredRows(aRowStart, aNrRows, out);
+                out += aNrRows * cellSize;
+            });
+        }
+    }
+    // Reads strided slice ns of the rows in rownrs into aOut. If ns selects
+    // at least 1 / StridedBoxDensity of the box it spans, the box is read
+    // and the slice gathered from it in memory. Sparser slices are read
+    // with one selection per position along the strided axes, so only the
+    // requested elements are read; the selections of a range of rows are
+    // deferred gets into one pooled buffer, performed together.
+    void getStridedCells(const CellRows &rownrs, const Slicer &ns, T *aOut)
+    {
+        size_t ndim = itsCasaShape.size();
+        size_t cellSize = ns.length().product();
+        if (cellSize == 0)
+        {
+            return;
+        }
+        Slicer box = boundingBox(ns);
+        size_t boxSize = box.length().product();
+        Adios2StManStaging<T> cells(itsStManPtr->getBufferPool());
+        if (cellSize * StridedBoxDensity >= boxSize)
+        {
+            Slicer gather = boxSlice(ns);
+            selectCells(&box);
+            forEachStoredRange(rownrs, [&](uint64_t aRowStart, uint64_t aNrRows) {
+                getStoredRows(aRowStart, aNrRows, cells.resize(aNrRows * boxSize));
+                for (uint64_t i = 0; i < aNrRows; ++i)
+                {
+                    copySlice(cells.data() + i * boxSize, box.length(), gather,
+                              aOut);
+                    aOut += cellSize;
+                }
+            });
+            return;
+        }
+        // a selection takes one position along every strided axis and the
+        // whole slice along the others
+        std::vector<size_t> &strided = itsStridedAxes;
+        strided.clear();
+        IPosition subStart(ns.start());
+        IPosition subLength(ns.length());
+        for (size_t i = 0; i < ndim; ++i)
+        {
+            if (ns.stride()(i) != 1)
+            {
+                strided.push_back(i);
+                subLength(i) = 1;
+            }
+        }
+        std::vector<size_t> &steps = itsStridedSteps;
+        steps.assign(ndim, 1);
+        for (size_t i = 1; i < ndim; ++i)
+        {
+            steps[i] = steps[i - 1] * ns.length()(i - 1);
+        }
+        // offsets in the output cell of the elements of a selection
+        size_t subSize = subLength.product();
+        std::vector<size_t> &offsets = itsStridedOffsets;
+        offsets.resize(subSize);
+        std::vector<size_t> &pos = itsStridedPos;
+        pos.assign(ndim, 0);
+        for (size_t e = 0; e < subSize; ++e)
+        {
+            offsets[e] = 0;
+            for (size_t i = 0; i < ndim; ++i)
+            {
+                offsets[e] += pos[i] * steps[i];
+            }
+            for (size_t i = 0; i < ndim; ++i)
+            {
+                if (++pos[i] < size_t(subLength(i)))
+                {
+                    break;
+                }
+                pos[i] = 0;
+            }
+        }
+        // start along the strided axes and offset in the output cell of
+        // every selection
+        std::vector<size_t> &starts = itsStridedStarts;
+        std::vector<size_t> &bases = itsStridedBases;
+        starts.clear();
+        bases.clear();
+        std::vector<size_t> &k = itsStridedIndex;
+        k.assign(strided.size(), 0);
+        for (;;)
+        {
+            size_t base = 0;
+            for (size_t j = 0; j < strided.size(); ++j)
+            {
+                size_t axis = strided[j];
+                starts.push_back(ns.start()(axis) + k[j] * ns.stride()(axis));
+                base += k[j] * steps[axis];
+            }
+            bases.push_back(base);
+            size_t j = 0;
+            for (; j < k.size(); ++j)
+            {
+                if (++k[j] < size_t(ns.length()(strided[j])))
+                {
+                    break;
+                }
+                k[j] = 0;
+            }
+            if (j == k.size())
+            {
+                break;
+            }
+        }
+        size_t nrSubs = bases.size();
+        forEachStoredRange(rownrs, [&](uint64_t aRowStart, uint64_t aNrRows) {
+            size_t partSize = aNrRows * subSize;
+            cells.resize(nrSubs * partSize);
+            if (itsNrSteps == 1)
+            {
+                // the selections of a range of rows are read with deferred
+                // gets performed at once
+                std::lock_guard<std::mutex> lock(itsStManPtr->getEngineMutex());
+                openRead();
+                Adios2StManTraceScope trace(itsStManPtr->getTracer(), "Get",
+                                            &itsColumnName, aRowStart, aNrRows);
+                for (size_t c = 0; c < nrSubs; ++c)
+                {
+                    for (size_t j = 0; j < strided.size(); ++j)
+                    {
+                        subStart(strided[j]) = starts[c * strided.size() + j];
+                    }
+                    Slicer sub(subStart, subLength);
+                    selectCells(&sub);
+                    itsAdiosStart[0] = aRowStart;
+                    itsAdiosCount[0] = aNrRows;
+                    itsReadSelection.first = itsAdiosStart;
+                    itsReadSelection.second = itsAdiosCount;
+                    itsAdiosVariable.SetSelection(itsReadSelection);
+                    itsAdiosEngine->Get<T>(itsAdiosVariable,
+                                           cells.data() + c * partSize,
+                                           adios2::Mode::Deferred);
+                }
+                itsAdiosCount[0] = 1;
+                itsAdiosEngine->PerformGets();
+            }
+            else
+            {
+                // rows of an updated table may come from different steps
+                for (size_t c = 0; c < nrSubs; ++c)
+                {
+                    for (size_t j = 0; j < strided.size(); ++j)
+                    {
+                        subStart(strided[j]) = starts[c * strided.size() + j];
+                    }
+                    Slicer sub(subStart, subLength);
+                    selectCells(&sub);
+                    getStoredRows(aRowStart, aNrRows,
+                                  cells.data() + c * partSize);
+                }
+            }
+            for (size_t c = 0; c < nrSubs; ++c)
+            {
+                for (uint64_t r = 0; r < aNrRows; ++r)
+                {
+                    const T *in = cells.data() + c * partSize + r * subSize;
+                    T *cell = aOut + r * cellSize + bases[c];
+                    for (size_t e = 0; e < subSize; ++e)
+                    {
+                        cell[offsets[e]] = in[e];
+                    }
+                }
+            }
+            aOut += aNrRows * cellSize;
+        });
     }
-    virtual void getScalarV(uInt aRowNr, void *data)
+    // Reads aNrRows rows starting at aRowStart into aData, using the cell
+    // selection already set up in itsAdiosStart and itsAdiosCount for the
+    // other dimensions.
+    void getRows(uint64_t aRowStart, uint64_t aNrRows, T *aData)
     {
-        itsAdiosStart[0] = aRowNr;
+        itsAdiosStart[0] = aRowStart;
+        itsAdiosCount[0] = aNrRows;
+        readRows(itsAdiosStart, itsAdiosCount, aData);
         itsAdiosCount[0] = 1;
-        itsAdiosVariable.SetSelection({itsAdiosStart, itsAdiosCount});
-        itsAdiosEngine->Get<T>(itsAdiosVariable, reinterpret_cast<T *>(data),
-                               adios2::Mode::Sync);
+    }
+    // As getRows, for stored rows.
+    void getStoredRows(uint64_t aRowStart, uint64_t aNrRows, T *aData)
+    {
+        itsAdiosStart[0] = aRowStart;
+        itsAdiosCount[0] = aNrRows;
+        readStoredRows(itsAdiosStart, itsAdiosCount, aData);
+        itsAdiosCount[0] = 1;
+    }
+    // Reads the box aStart, aCount of logical rows into aData. In a
+    // reordered table, rows stored within twice as many rows as are read
+    // are read as one box and scattered in memory, others range by range.
+    // This runs on the read-ahead thread as well.
+    void readRows(const adios2::Dims &aStart, const adios2::Dims &aCount,
+                  T *aData)
+    {
+        const Adios2StManRowMap *map = itsStManPtr->getRowMap();
+        if (!map)
+        {
+            readStoredRows(aStart, aCount, aData);
+            return;
+        }
+        struct Part
+        {
+            uint64_t target;
+            uint64_t nrRows;
+            uint64_t stride;
+        };
+        std::vector<Part> parts;
+        uint64_t low = std::numeric_limits<uint64_t>::max();
+        uint64_t high = 0;
+        map->forEachRun(aStart[0], aCount[0], [&](uint64_t aTarget,
+                                                  uint64_t aN,
+                                                  uint64_t aStride) {
+            uint64_t last = aTarget + (aN - 1) * aStride;
+            low = std::min(low, std::min(aTarget, last));
+            high = std::max(high, std::max(aTarget, last));
+            parts.push_back({aTarget, aN, aStride});
+        });
+        adios2::Dims start = aStart;
+        adios2::Dims count = aCount;
+        if (parts.size() == 1 && parts[0].stride == 1)
+        {
+            start[0] = parts[0].target;
+            readStoredRows(start, count, aData);
+            return;
+        }
+        size_t rowSize = 1;
+        for (size_t i = 1; i < aCount.size(); ++i)
+        {
+            rowSize *= aCount[i];
+        }
+        T *out = aData;
+        if (high - low < 2 * aCount[0])
+        {
+            Adios2StManStaging<T> box(itsStManPtr->getBufferPool());
+            box.resize((high - low + 1) * rowSize);
+            start[0] = low;
+            count[0] = high - low + 1;
+            readStoredRows(start, count, box.data());
+            for (auto &part : parts)
+            {
+                for (uint64_t i = 0; i < part.nrRows; ++i)
+                {
+                    const T *row =
+                        box.data() +
+                        (part.target + i * part.stride - low) * rowSize;
+                    std::copy(row, row + rowSize, out);
+                    out += rowSize;
+                }
+            }
+            return;
+        }
+        for (auto &part : parts)
+        {
+            uint64_t n = (part.stride == 1) ? part.nrRows : 1;
+            for (uint64_t i = 0; i < part.nrRows; i += n)
+            {
+                start[0] = part.target + i * part.stride;
+                count[0] = n;
+                readStoredRows(start, count, out);
+                out += n * rowSize;
+            }
+        }
+    }
+    // Reads the box aStart, aCount of stored rows into aData. Reads of at
+    // least ParallelReadBytes are split by rows across the read threads of
+    // the storage manager. This runs on the read-ahead thread as well, so
+    // it leaves the selection members alone.
+    void readStoredRows(const adios2::Dims &aStart, const adios2::Dims &aCount,
+                        T *aData)
+    {
+        size_t rowSize = 1;
+        for (size_t i = 1; i < aCount.size(); ++i)
+        {
+            rowSize *= aCount[i];
+        }
+        size_t nrWorkers = 0;
+        if (aCount[0] > 1 &&
+            aCount[0] * rowSize * sizeof(T) >= ParallelReadBytes)
+        {
+            nrWorkers = itsStManPtr->getReadWorkers();
+        }
+        if (nrWorkers < 2)
+        {
+            std::lock_guard<std::mutex> lock(itsStManPtr->getEngineMutex());
+            openRead();
+            itsReadSelection.first = aStart;
+            itsReadSelection.second = aCount;
+            readRowsFrom(*itsAdiosEngine, itsAdiosVariable, itsReadSelection,
+                         aData);
+            return;
+        }
+        Adios2StManTraceScope trace(itsStManPtr->getTracer(), "ParallelRead",
+                                    &itsColumnName, aStart[0], aCount[0]);
+        if (itsNrSteps > 1)
+        {
+            std::lock_guard<std::mutex> lock(itsStManPtr->getEngineMutex());
+            openRead();
+            loadVersions();
+        }
+        uint64_t rowStart = aStart[0];
+        uint64_t nrRows = aCount[0];
+        uint64_t rowsPerWorker = (nrRows + nrWorkers - 1) / nrWorkers;
+        std::vector<std::shared_future<void>> done;
+        for (size_t i = 0; i < nrWorkers && i * rowsPerWorker < nrRows; ++i)
+        {
+            uint64_t first = rowStart + i * rowsPerWorker;
+            uint64_t n = std::min(rowsPerWorker, nrRows - i * rowsPerWorker);
+            T *out = aData + i * rowsPerWorker * rowSize;
+            // aStart and aCount outlive the parts, which are waited for
+            done.push_back(itsStManPtr->submitRead(
+                i, [this, &aStart, &aCount, first, n,
+                    out](adios2::IO &aIO, adios2::Engine &aEngine,
+                         adios2::Box<adios2::Dims> &aSelection) {
+                    aSelection.first = aStart;
+                    aSelection.second = aCount;
+                    aSelection.first[0] = first;
+                    aSelection.second[0] = n;
+                    auto var = aIO.InquireVariable<T>(itsAdiosName);
+                    readRowsFrom(aEngine, var, aSelection, out);
+                }));
+        }
+        for (auto &part : done)
+        {
+            part.wait();
+        }
+        for (auto &part : done)
+        {
+            part.get();
+        }
+    }
+    // Reads the box aSelection of aVariable through aEngine. In an updated
+    // container each range of rows is read from the newest step that holds
+    // it, adjusting the rows of aSelection, which is scratch owned by the
+    // calling thread so that its vectors are reused from read to read.
+    void readRowsFrom(adios2::Engine &aEngine, adios2::Variable<T> &aVariable,
+                      adios2::Box<adios2::Dims> &aSelection, T *aData)
+    {
+        if (itsNrSteps == 1)
+        {
+            Adios2StManTraceScope trace(itsStManPtr->getTracer(), "Get", &itsColumnName,
+                                        aSelection.first[0],
+                                        aSelection.second[0]);
+            aVariable.SetSelection(aSelection);
+            aEngine.Get<T>(aVariable, aData, adios2::Mode::Sync);
+            return;
+        }
+        size_t rowSize = 1;
+        for (size_t i = 1; i < aSelection.second.size(); ++i)
+        {
+            rowSize *= aSelection.second[i];
+        }
+        uint64_t rowStart = aSelection.first[0];
+        uint64_t nrRows = aSelection.second[0];
+        forEachVersion(rowStart, nrRows, [&](uint64_t aFrom, uint64_t aN,
+                                             uint64_t aStep) {
+            Adios2StManTraceScope trace(itsStManPtr->getTracer(), "Get", &itsColumnName,
+                                        aFrom, aN);
+            aSelection.first[0] = aFrom;
+            aSelection.second[0] = aN;
+            aVariable.SetStepSelection({aStep, 1});
+            aVariable.SetSelection(aSelection);
+            aEngine.Get<T>(aVariable, aData + (aFrom - rowStart) * rowSize,
+                           adios2::Mode::Sync);
+        });
+    }
+    // Copies cell aRowNr, or slice ns of it, from the rows read ahead into
+    // aData, waiting for the read if it is still in flight. Returns false
+    // if the cell is not covered by the hint, after moving the hint along
+    // for a sequential consumer that jumped.
+    bool getPrefetched(uint64_t aRowNr, const Slicer *ns, T *aData)
+    {
+        if (itsHint.sliced != (ns != 0) ||
+            (ns && !(ns->start().isEqual(itsHint.slicer.start()) &&
+                     ns->length().isEqual(itsHint.slicer.length()) &&
+                     ns->stride().isEqual(itsHint.slicer.stride()))))
+        {
+            return false;
+        }
+        while (!itsPrefetchWindows.empty() &&
+               itsPrefetchWindows.front()->start +
+                       itsPrefetchWindows.front()->nrRows <=
+                   aRowNr)
+        {
+            itsPrefetchWindows.pop_front();
+        }
+        if (itsPrefetchWindows.empty() ||
+            itsPrefetchWindows.front()->start > aRowNr)
+        {
+            if (itsHint.kind != 's')
+            {
+                fillPrefetch();
+                return false;
+            }
+            dropPrefetch();
+            itsHintNext = aRowNr;
+            fillPrefetch();
+        }
+        auto window = itsPrefetchWindows.front();
+        window->done.get();
+        bool wholeCells = prefetchWholeCells();
+        size_t cellSize = wholeCells ? getCellSize() : window->cellSize;
+        const T *cell = window->data.data() + (aRowNr - window->start) * cellSize;
+        if (ns && wholeCells)
+        {
+            copySlice(cell, itsCasaShape, *ns, aData);
+        }
+        else if (ns && isStrided(*ns))
+        {
+            copySlice(cell, boundingBox(*ns).length(), boxSlice(*ns), aData);
+        }
+        else
+        {
+            std::copy(cell, cell + cellSize, aData);
+        }
+        fillPrefetch();
+        return true;
+    }
+    // Slices of containers with casacore ordered cell axes are cut from
+    // whole cells, as in getCells. Strided slices are read ahead as the
+    // box they span.
+    bool prefetchWholeCells()
+    {
+        return !itsHint.sliced || (!itsReversedAxes && itsCasaShape.size() > 1);
+    }
+    // Forgets the rows read ahead. Requests still queued see the generation
+    // move on and return without reading.
+    void dropPrefetch()
+    {
+        ++itsPrefetchGeneration;
+        itsPrefetchWindows.clear();
+    }
+    // Tops the read-ahead requests up to the depth of the hint.
+    void fillPrefetch()
+    {
+        uint64_t nrRows = itsAdiosShape[0];
+        while (itsHint.kind != 'n' && itsPrefetchWindows.size() < itsHint.depth)
+        {
+            uint64_t start = 0;
+            uint64_t count = 0;
+            if (itsHint.kind == 's')
+            {
+                if (itsHintNext >= nrRows)
+                {
+                    break;
+                }
+                start = itsHintNext;
+                count = std::min(itsHint.window, nrRows - start);
+                itsHintNext += count;
+            }
+            else
+            {
+                if (itsHint.ranges.empty())
+                {
+                    break;
+                }
+                auto &range = itsHint.ranges.front();
+                start = range.first;
+                count = range.second;
+                if (itsHint.window > 0 && count > itsHint.window)
+                {
+                    count = itsHint.window;
+                }
+                range.first += count;
+                range.second -= count;
+                if (range.second == 0)
+                {
+                    itsHint.ranges.pop_front();
+                }
+                if (start >= nrRows)
+                {
+                    continue;
+                }
+                count = std::min(count, nrRows - start);
+            }
+            bool wholeCells = prefetchWholeCells();
+            Slicer box = boundingBox(itsHint.slicer);
+            selectCells(wholeCells ? 0 : &box);
+            adios2::Dims boxStart = itsAdiosStart;
+            adios2::Dims boxCount = itsAdiosCount;
+            boxStart[0] = start;
+            boxCount[0] = count;
+            std::shared_ptr<PrefetchWindow> window(
+                new PrefetchWindow(itsStManPtr->getBufferPool()));
+            window->start = start;
+            window->nrRows = count;
+            window->cellSize =
+                wholeCells ? getCellSize() : box.length().product();
+            window->data.resize(count * window->cellSize);
+            uint64_t generation = itsPrefetchGeneration;
+            window->done = itsStManPtr->prefetch([this, window, boxStart,
+                                                  boxCount, generation]() {
+                if (itsPrefetchGeneration != generation)
+                {
+                    return;
+                }
+                Adios2StManTraceScope trace(itsStManPtr->getTracer(), "Prefetch",
+                                            &itsColumnName, boxStart[0],
+                                            boxCount[0]);
+                readRows(boxStart, boxCount, window->data.data());
+            });
+            itsPrefetchWindows.push_back(window);
+        }
+    }
+    // Calls aFunc(rowStart, nrRows, step) for each range of rows in
+    // [aRowStart, aRowStart + aNrRows) whose newest copy is in one step.
+    // Rows that were added after creation and never written are skipped.
+    template <class F>
+    void forEachVersion(uint64_t aRowStart, uint64_t aNrRows, F aFunc)
+    {
+        loadVersions();
+        uint64_t row = aRowStart;
+        uint64_t last = aRowStart + aNrRows;
+        size_t i = itsVersions.find(row);
+        if (i == itsVersions.size())
+        {
+            i = 0;
+        }
+        else if (row >= itsVersions[i].start + itsVersions[i].length)
+        {
+            ++i;
+        }
+        while (row < last)
+        {
+            uint64_t to = last;
+            uint64_t step = 0;
+            if (i < itsVersions.size() && itsVersions[i].start <= row)
+            {
+                to = std::min(last,
+                              itsVersions[i].start + itsVersions[i].length);
+                step = itsVersions[i].value;
+                ++i;
+            }
+            else
+            {
+                if (i < itsVersions.size())
+                {
+                    to = std::min(last, itsVersions[i].start);
+                }
+                if (row >= itsBaseNrRows)
+                {
+                    row = to;
+                    continue;
+                }
+                to = std::min<uint64_t>(to, itsBaseNrRows);
+            }
+            aFunc(row, to - row, step);
+            row = to;
+        }
+    }
+    // Reads a resident column in full on first access.
+    void loadResident()
+    {
+        if (itsResidentLoaded)
+        {
+            return;
+        }
+        Adios2StManTraceScope trace(itsStManPtr->getTracer(), "LoadResident", &itsColumnName);
+        itsResidentValues.resize(itsAdiosShape[0]);
+        if (!itsResidentValues.empty())
+        {
+            getRows(0, itsResidentValues.size(), itsResidentValues.data());
+        }
+        itsResidentLoaded = true;
+    }
+    // Opens the engine of a table opened for reading on first use. Called
+    // with the engine mutex held.
+    void openRead()
+    {
+        if (itsAdiosEngine)
+        {
+            return;
+        }
+        itsAdiosEngine = itsStManPtr->getReadEngine();
+        if (itsEncoding == 'p')
+        {
+            itsAdiosVariable = itsAdiosIO->InquireVariable<T>(itsAdiosName);
+        }
+    }
+    // Maps rows to the newest step that wrote them. Step 0 holds the table
+    // as created and is not recorded.
+    void loadVersions()
+    {
+        if (itsVersionsLoaded)
+        {
+            return;
+        }
+        itsVersionsLoaded = true;
+        Adios2StManTraceScope trace(itsStManPtr->getTracer(), "BlocksInfo", &itsColumnName);
+        for (uint64_t step = 1; step < itsNrSteps; ++step)
+        {
+            for (auto &info : itsAdiosEngine->BlocksInfo(itsAdiosVariable, step))
+            {
+                itsVersions.put(info.Start[0], info.Count[0], step);
+            }
+        }
+    }
+    // Sets up the write engine on the first put after the table has been
+    // reopened. Encoded columns are held in memory in full and rewritten
+    // as a whole into the new step, so updating them is meant for tables
+    // written by a single process. A delta column keeps its blocks encoded;
+    // only the rows around the ones put to are decoded, see
+    // putDeltaValue().
+    void prepareWrite()
+    {
+        if (itsOpenMode == 'w')
+        {
+            return;
+        }
+        itsAdiosWriteEngine = itsStManPtr->getWriteEngine();
+        if (itsAdiosWriteIO)
+        {
+            return;
+        }
+        itsAdiosWriteIO = itsStManPtr->getWriteIO();
+        if (itsEncoding == 'p')
+        {
+            itsAdiosWriteVariable =
+                itsAdiosWriteIO->InquireVariable<T>(itsAdiosName);
+            if (itsAdiosWriteVariable)
+            {
+                itsAdiosWriteVariable.SetShape(itsAdiosShape);
+            }
+            else
+            {
+                itsAdiosWriteVariable = itsAdiosWriteIO->DefineVariable<T>(
+                    itsAdiosName, itsAdiosShape, itsAdiosStart,
+                    itsAdiosCount);
+            }
+            initCompression();
+            return;
+        }
+        loadEncoding();
+    }
+    // Step holding the newest blocks of aVariable, selected for the reads
+    // that follow when the container has been updated.
+    template <class U>
+    size_t selectNewestStep(adios2::Variable<U> &aVariable)
+    {
+        if (itsNrSteps == 1)
+        {
+            return itsAdiosEngine->CurrentStep();
+        }
+        size_t step = itsNrSteps;
+        while (step-- > 0)
+        {
+            if (!itsAdiosEngine->BlocksInfo(aVariable, step).empty())
+            {
+                break;
+            }
+        }
+        if (step >= itsNrSteps)
+        {
+            step = 0;
+        }
+        aVariable.SetStepSelection({step, 1});
+        return step;
+    }
+    // The Inline engine keeps pointers to the data passed to Put until the
+    // reader has finished the step, so cells are staged in buffers that
+    // live until the writer begins its next step.
+    void putInline(const T *aData, size_t aSize)
+    {
+        itsStManPtr->beginStep();
+        if (itsStagingStep != itsStManPtr->getStepCount())
+        {
+            // the buffers of the previous step are reused
+            itsStagingUsed = 0;
+            itsStagingStep = itsStManPtr->getStepCount();
+        }
+        if (itsStagingUsed == itsStagingBuffers.size())
+        {
+            itsStagingBuffers.emplace_back(itsStManPtr->getBufferPool());
+        }
+        T *buffer = itsStagingBuffers[itsStagingUsed++].resize(aSize);
+        std::copy(aData, aData + aSize, buffer);
+        Adios2StManTraceScope trace(itsStManPtr->getTracer(), "Put", &itsColumnName,
+                                    itsAdiosStart[0], itsAdiosCount[0]);
+        itsAdiosWriteEngine->Put(itsAdiosWriteVariable, buffer);
+    }
+    // Returns a pointer into the writer's buffer for aRowNr, moving the
+    // reader on to later steps until one contains the row.
+    const T *getInlineCell(rownr_t aRowNr)
+    {
+        size_t cellSize = getCellSize();
+        while (itsStManPtr->beginStep())
+        {
+            if (itsInlineStep != itsStManPtr->getStepCount())
+            {
+                itsInlineStep = itsStManPtr->getStepCount();
+                Adios2StManTraceScope trace(itsStManPtr->getTracer(), "Get", &itsColumnName);
+                itsInlineBlocks = itsAdiosEngine->BlocksInfo(
+                    itsAdiosVariable, itsAdiosEngine->CurrentStep());
+                for (auto &info : itsInlineBlocks)
+                {
+                    itsAdiosVariable.SetBlockSelection(info.BlockID);
+                    itsAdiosEngine->Get(itsAdiosVariable, info);
+                }
+                itsAdiosEngine->PerformGets();
+                if (itsInlineBlocks.empty())
+                {
+                    break;
+                }
+            }
+            for (auto &info : itsInlineBlocks)
+            {
+                if (aRowNr >= info.Start[0] &&
+                    aRowNr < info.Start[0] + info.Count[0])
+                {
+                    return info.Data() + (aRowNr - info.Start[0]) * cellSize;
+                }
+            }
+            itsStManPtr->endStep();
+        }
+        throw(std::runtime_error("Adios2StMan: row " + std::to_string(aRowNr) +
+                                 " of column " + itsColumnName +
+                                 " is not available from the Inline writer"));
+    }
+
+    // Reads rows [aRowNr, aRowNr + aNrRows) of an encoded column from the
+    // in-memory run table or delta blocks.
+    void getEncoded(uint64_t aRowNr, uint64_t aNrRows, T *aData)
+    {
+        loadEncoding();
+        if (itsEncoding == 'r')
+        {
+            itsRunTable.get(aRowNr, aNrRows, aData);
+            return;
+        }
+        decodeDeltaBlocks(aRowNr, aNrRows, aData);
+        // rows put since the blocks were read back
+        uint64_t last = aRowNr + aNrRows;
+        for (uint64_t r = std::max<uint64_t>(aRowNr, itsDeltaFirstRow);
+             r < std::min<uint64_t>(last,
+                                    itsDeltaFirstRow + itsDeltaValues.size());
+             ++r)
+        {
+            aData[r - aRowNr] = itsDeltaValues[r - itsDeltaFirstRow];
+        }
+    }
+    void decodeDeltaBlocks(uint64_t aRowNr, uint64_t aNrRows, T *aData) const
+    {
+        for (auto &block : itsDeltaBlocks)
+        {
+            uint64_t from = std::max(block.start(), aRowNr);
+            uint64_t to =
+                std::min(block.start() + block.nrRows(), aRowNr + aNrRows);
+            if (from < to)
+            {
+                block.decode(from, to - from, aData + (from - aRowNr));
+            }
+        }
+    }
+    void loadEncoding()
+    {
+        if (itsEncodingLoaded)
+        {
+            return;
+        }
+        itsEncodingLoaded = true;
+        std::lock_guard<std::mutex> lock(itsStManPtr->getEngineMutex());
+        openRead();
+        if (itsEncoding == 'r')
+        {
+            getRunTable();
+        }
+        else if (itsEncoding == 'd')
+        {
+            getDeltaBlocks();
+        }
+    }
+    // Each MPI rank writes its own runs as one block of three local arrays,
+    // so no communication is needed to agree on offsets.
+    void putRunTable()
+    {
+        itsRunTable.toArrays(itsRunStarts, itsRunLengths, itsRunValues);
+        if (itsRunStarts.empty())
+        {
+            return;
+        }
+        Adios2StManTraceScope trace(itsStManPtr->getTracer(), "PutEncoded", &itsColumnName);
+        adios2::Dims count = {itsRunStarts.size()};
+        auto startVar = defineLocalArray<uint64_t>("/RunStart", count);
+        auto lengthVar = defineLocalArray<uint64_t>("/RunLength", count);
+        auto valueVar = defineLocalArray<T>("/RunValue", count);
+        itsAdiosWriteEngine->Put(startVar, itsRunStarts.data());
+        itsAdiosWriteEngine->Put(lengthVar, itsRunLengths.data());
+        itsAdiosWriteEngine->Put(valueVar, itsRunValues.data());
+    }
+    void getRunTable()
+    {
+        Adios2StManTraceScope trace(itsStManPtr->getTracer(), "GetEncoded", &itsColumnName);
+        auto startVar =
+            itsAdiosIO->InquireVariable<uint64_t>(itsAdiosName + "/RunStart");
+        auto lengthVar =
+            itsAdiosIO->InquireVariable<uint64_t>(itsAdiosName + "/RunLength");
+        auto valueVar = itsAdiosIO->InquireVariable<T>(itsAdiosName + "/RunValue");
+        if (!startVar || !lengthVar || !valueVar)
+        {
+            return;
+        }
+        size_t step = selectNewestStep(startVar);
+        if (itsNrSteps > 1)
+        {
+            lengthVar.SetStepSelection({step, 1});
+            valueVar.SetStepSelection({step, 1});
+        }
+        auto blocks = itsAdiosEngine->BlocksInfo(startVar, step);
+        for (size_t i = 0; i < blocks.size(); ++i)
+        {
+            startVar.SetBlockSelection(i);
+            lengthVar.SetBlockSelection(i);
+            valueVar.SetBlockSelection(i);
+            itsAdiosEngine->Get(startVar, itsRunStarts, adios2::Mode::Sync);
+            itsAdiosEngine->Get(lengthVar, itsRunLengths, adios2::Mode::Sync);
+            itsAdiosEngine->Get(valueVar, itsRunValues, adios2::Mode::Sync);
+            itsRunTable.append(itsRunStarts, itsRunLengths, itsRunValues);
+        }
+        itsRunTable.sort();
+    }
+    // Rows put are kept decoded in one window, which is encoded again at
+    // the end of the step. After reopening, the window is widened to the
+    // checkpoints of the blocks read back around the rows put, and filled
+    // from them, so the rest of those blocks is written again as it is.
+    void putDeltaValue(uint64_t aRowNr, const T &aValue)
+    {
+        uint64_t first = aRowNr;
+        uint64_t last = aRowNr + 1;
+        if (!itsDeltaValues.empty())
+        {
+            first = std::min(first, itsDeltaFirstRow);
+            last = std::max<uint64_t>(last, itsDeltaFirstRow +
+                                                itsDeltaValues.size());
+        }
+        else
+        {
+            itsDeltaFirstRow = aRowNr;
+        }
+        for (auto &block : itsDeltaBlocks)
+        {
+            uint64_t end = block.start() + block.nrRows();
+            if (block.start() <= first && first < end)
+            {
+                first = block.alignDown(first);
+            }
+            if (block.start() < last && last < end)
+            {
+                last = block.alignUp(last);
+            }
+        }
+        uint64_t oldLast = itsDeltaFirstRow + itsDeltaValues.size();
+        if (first < itsDeltaFirstRow)
+        {
+            uint64_t nrRows = itsDeltaFirstRow - first;
+            itsDeltaValues.insert(itsDeltaValues.begin(), nrRows, T());
+            itsDeltaFirstRow = first;
+            decodeDeltaBlocks(first, nrRows, itsDeltaValues.data());
+        }
+        if (last > oldLast)
+        {
+            itsDeltaValues.resize(last - itsDeltaFirstRow);
+            decodeDeltaBlocks(oldLast, last - oldLast,
+                              itsDeltaValues.data() +
+                                  (oldLast - itsDeltaFirstRow));
+        }
+        itsDeltaValues[aRowNr - itsDeltaFirstRow] = aValue;
+    }
+    // Like the run table, each rank writes the row range it has touched as
+    // one block, next to the parts of the blocks read back that lie outside
+    // of it.
+    void putDeltaBlock()
+    {
+        if (itsDeltaValues.empty())
+        {
+            return;
+        }
+        Adios2StManTraceScope trace(itsStManPtr->getTracer(), "PutEncoded", &itsColumnName);
+        uint64_t first = itsDeltaFirstRow;
+        uint64_t last = first + itsDeltaValues.size();
+        for (auto &block : itsDeltaBlocks)
+        {
+            uint64_t end = block.start() + block.nrRows();
+            if (block.start() < first)
+            {
+                putDeltaArrays(block.slice(
+                    block.start(), std::min(end, first) - block.start()));
+            }
+            if (end > last)
+            {
+                uint64_t start = std::max(block.start(), last);
+                putDeltaArrays(block.slice(start, end - start));
+            }
+        }
+        Adios2StManDeltaBlock<T> block;
+        block.encode(itsDeltaFirstRow, itsDeltaValues, itsDeltaOrder,
+                     Adios2StManDeltaBlock<T>::DefaultInterval);
+        putDeltaArrays(block);
+    }
+    // Puts a block as a header (start row, number of rows, order,
+    // checkpoint interval), the checkpoints and the run-length encoded
+    // residuals. The arrays are reused for the next block, so the puts are
+    // synchronous.
+    void putDeltaArrays(const Adios2StManDeltaBlock<T> &aBlock)
+    {
+        aBlock.toArrays(itsDeltaHeader, itsDeltaCheckpoints, itsRunStarts,
+                        itsRunLengths, itsDeltaResiduals);
+        auto headerVar = defineLocalArray<uint64_t>(
+            "/DeltaHeader", {itsDeltaHeader.size()});
+        auto checkpointVar = defineLocalArray<uint64_t>(
+            "/DeltaCheckpoint", {itsDeltaCheckpoints.size()});
+        adios2::Dims count = {itsRunStarts.size()};
+        auto startVar = defineLocalArray<uint64_t>("/DeltaRunStart", count);
+        auto lengthVar = defineLocalArray<uint64_t>("/DeltaRunLength", count);
+        auto valueVar = defineLocalArray<uint64_t>("/DeltaRunValue", count);
+        itsAdiosWriteEngine->Put(headerVar, itsDeltaHeader.data(),
+                                 adios2::Mode::Sync);
+        itsAdiosWriteEngine->Put(checkpointVar, itsDeltaCheckpoints.data(),
+                                 adios2::Mode::Sync);
+        itsAdiosWriteEngine->Put(startVar, itsRunStarts.data(),
+                                 adios2::Mode::Sync);
+        itsAdiosWriteEngine->Put(lengthVar, itsRunLengths.data(),
+                                 adios2::Mode::Sync);
+        itsAdiosWriteEngine->Put(valueVar, itsDeltaResiduals.data(),
+                                 adios2::Mode::Sync);
+    }
+    void getDeltaBlocks()
+    {
+        Adios2StManTraceScope trace(itsStManPtr->getTracer(), "GetEncoded", &itsColumnName);
+        const char *suffixes[] = {"/DeltaHeader", "/DeltaCheckpoint",
+                                  "/DeltaRunStart", "/DeltaRunLength",
+                                  "/DeltaRunValue"};
+        std::vector<adios2::Variable<uint64_t>> vars;
+        for (auto suffix : suffixes)
+        {
+            vars.push_back(
+                itsAdiosIO->InquireVariable<uint64_t>(itsAdiosName + suffix));
+            if (!vars.back())
+            {
+                return;
+            }
+        }
+        size_t step = selectNewestStep(vars[0]);
+        if (itsNrSteps > 1)
+        {
+            for (auto &var : vars)
+            {
+                var.SetStepSelection({step, 1});
+            }
+        }
+        auto blocks = itsAdiosEngine->BlocksInfo(vars[0], step);
+        std::vector<std::vector<uint64_t>> arrays(vars.size());
+        for (size_t i = 0; i < blocks.size(); ++i)
+        {
+            for (size_t j = 0; j < vars.size(); ++j)
+            {
+                vars[j].SetBlockSelection(i);
+                itsAdiosEngine->Get(vars[j], arrays[j], adios2::Mode::Sync);
+            }
+            itsDeltaBlocks.emplace_back();
+            itsDeltaBlocks.back().fromArrays(arrays[0], arrays[1], arrays[2],
+                                             arrays[3], arrays[4]);
+        }
+    }
+    template <class U>
+    adios2::Variable<U> defineLocalArray(const std::string &aSuffix,
+                                         const adios2::Dims &aCount)
+    {
+        auto var =
+            itsAdiosWriteIO->InquireVariable<U>(itsAdiosName + aSuffix);
+        if (!var)
+        {
+            return itsAdiosWriteIO->DefineVariable<U>(itsAdiosName + aSuffix,
+                                                      {}, {}, aCount);
+        }
+        var.SetSelection({adios2::Dims(), aCount});
+        return var;
     }
 
-private:
     adios2::Variable<T> itsAdiosVariable;
+    std::shared_ptr<adios2::IO> itsAdiosWriteIO;
+    std::shared_ptr<adios2::Engine> itsAdiosWriteEngine;
+    adios2::Variable<T> itsAdiosWriteVariable;
+
+    std::deque<Adios2StManStaging<T>> itsStagingBuffers;
+    uint64_t itsStagingStep;
+    size_t itsStagingUsed; // buffers holding puts of the current step
+    std::vector<typename adios2::Variable<T>::Info> itsInlineBlocks;
+    uint64_t itsInlineStep;
+    // selection of reads on the calling thread, under the engine mutex
+    adios2::Box<adios2::Dims> itsReadSelection;
+    // scratch of getStridedCells
+    std::vector<size_t> itsStridedAxes;
+    std::vector<size_t> itsStridedSteps;
+    std::vector<size_t> itsStridedOffsets;
+    std::vector<size_t> itsStridedPos;
+    std::vector<size_t> itsStridedIndex;
+    std::vector<size_t> itsStridedStarts;
+    std::vector<size_t> itsStridedBases;
+
+    uint64_t itsNrSteps;
+    uint64_t itsBaseNrRows;
+    bool itsVersionsLoaded;
+    Adios2StManRunTable<uint64_t> itsVersions;
+    // rows put in this session and the step they went to
+    Adios2StManRunTable<uint64_t> itsWrittenRows;
+
+    bool itsResident;
+    bool itsResidentLoaded;
+    std::vector<T> itsResidentValues;
+
+    // 'n' uncompressed, 'c' compressed, 's' sampled for automatic
+    // compression, with the puts held back until the codec is chosen
+    char itsCompression;
+    struct StagedPut
+    {
+        adios2::Dims start;
+        adios2::Dims count;
+        size_t offset;
+    };
+    std::vector<StagedPut> itsStagedPuts;
+    Adios2StManStaging<T> itsStagedData;
+    size_t itsStagedSize;
+
+    // rows read ahead on the prefetch thread; data is only touched by the
+    // consumer once done is ready
+    struct PrefetchWindow
+    {
+        explicit PrefetchWindow(Adios2StManBufferPool &aPool) : data(aPool) {}
+        uint64_t start;
+        uint64_t nrRows;
+        size_t cellSize;
+        Adios2StManStaging<T> data;
+        std::shared_future<void> done;
+    };
+    Adios2StManAccessHint itsHint;
+    uint64_t itsHintNext;
+    std::deque<std::shared_ptr<PrefetchWindow>> itsPrefetchWindows;
+    // bumped whenever the windows are dropped, read by the prefetch thread
+    std::atomic<uint64_t> itsPrefetchGeneration;
+
+    bool itsEncodingLoaded;
+    Adios2StManRunTable<T> itsRunTable;
+    std::vector<uint64_t> itsRunStarts;
+    std::vector<uint64_t> itsRunLengths;
+    std::vector<T> itsRunValues;
+
+    int itsDeltaOrder;
+    uint64_t itsDeltaFirstRow;
+    std::vector<T> itsDeltaValues;
+    std::vector<Adios2StManDeltaBlock<T>> itsDeltaBlocks;
+    std::vector<uint64_t> itsDeltaHeader;
+    std::vector<uint64_t> itsDeltaCheckpoints;
+    std::vector<uint64_t> itsDeltaResiduals;
 };
 
 } // namespace casacore
@@ -0,0 +1,629 @@
+//    (c) Oak Ridge National Laboratory
+//    1 Bethel Valley Road, Oak Ridge, TN 37830, United States
+//
+//    This library is free software: you can redistribute it and/or
+//    modify it under the terms of the GNU General Public License as published
+//    by the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License along
+//    with this library. If not, see <http://www.gnu.org/licenses/>.
+//
+//    Any bugs, questions, concerns and/or suggestions please email to
+//    wangr1@ornl.gov or jason.ruonan.wang@gmail.com
+
+#ifndef ADIOS2STMANENCODING_H
+#define ADIOS2STMANENCODING_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+namespace casacore
+{
+
+// In-memory table of (start row, length, value) runs for run-length encoded
+// scalar columns. Runs are kept sorted by start row and never overlap, and
+// adjacent runs holding the same value are merged.
+template <class T>
+class Adios2StManRunTable
+{
+public:
+    struct Run
+    {
+        uint64_t start;
+        uint64_t length;
+        T value;
+    };
+
+    void put(uint64_t aRowNr, const T &aValue) { put(aRowNr, 1, aValue); }
+
+    // Sets rows [aRowNr, aRowNr + aNrRows) to aValue, replacing whatever
+    // runs covered them before.
+    void put(uint64_t aRowNr, uint64_t aNrRows, const T &aValue)
+    {
+        if (aNrRows == 0)
+        {
+            return;
+        }
+        // fast path for rows written in ascending order
+        if (itsRuns.empty() || aRowNr >= end(itsRuns.size() - 1))
+        {
+            if (!itsRuns.empty() && aRowNr == end(itsRuns.size() - 1) &&
+                itsRuns.back().value == aValue)
+            {
+                itsRuns.back().length += aNrRows;
+            }
+            else
+            {
+                itsRuns.push_back({aRowNr, aNrRows, aValue});
+            }
+            return;
+        }
+
+        // runs [from, to) overlap the new range; the parts of the first and
+        // last of them sticking out of it are kept as head and tail
+        uint64_t last = aRowNr + aNrRows;
+        size_t i = find(aRowNr);
+        size_t from = 0;
+        if (i < itsRuns.size())
+        {
+            from = (end(i) > aRowNr) ? i : i + 1;
+        }
+        size_t to = from;
+        Run head = {0, 0, aValue};
+        Run tail = {0, 0, aValue};
+        for (; to < itsRuns.size() && itsRuns[to].start < last; ++to)
+        {
+            if (itsRuns[to].start < aRowNr)
+            {
+                head = {itsRuns[to].start, aRowNr - itsRuns[to].start,
+                        itsRuns[to].value};
+            }
+            if (end(to) > last)
+            {
+                tail = {last, end(to) - last, itsRuns[to].value};
+            }
+        }
+        itsRuns.erase(itsRuns.begin() + from, itsRuns.begin() + to);
+        size_t pos = from;
+        if (head.length > 0)
+        {
+            itsRuns.insert(itsRuns.begin() + pos++, head);
+        }
+        itsRuns.insert(itsRuns.begin() + pos, Run{aRowNr, aNrRows, aValue});
+        if (tail.length > 0)
+        {
+            itsRuns.insert(itsRuns.begin() + pos + 1, tail);
+        }
+        merge(pos);
+    }
+
+    // Returns false if aRowNr has never been written.
+    bool get(uint64_t aRowNr, T &aValue) const
+    {
+        size_t i = find(aRowNr);
+        if (i < itsRuns.size() && aRowNr < end(i))
+        {
+            aValue = itsRuns[i].value;
+            return true;
+        }
+        return false;
+    }
+
+    // Expands rows [aRowNr, aRowNr + aNrRows) into aData. Rows that have
+    // never been written read as T().
+    void get(uint64_t aRowNr, uint64_t aNrRows, T *aData) const
+    {
+        size_t i = find(aRowNr);
+        if (i >= itsRuns.size())
+        {
+            i = 0;
+        }
+        uint64_t last = aRowNr + aNrRows;
+        uint64_t r = aRowNr;
+        for (; i < itsRuns.size() && itsRuns[i].start < last; ++i)
+        {
+            uint64_t from = std::max(itsRuns[i].start, aRowNr);
+            uint64_t to = std::min(end(i), last);
+            for (; r < from; ++r)
+            {
+                aData[r - aRowNr] = T();
+            }
+            for (r = std::max(r, from); r < to; ++r)
+            {
+                aData[r - aRowNr] = itsRuns[i].value;
+            }
+        }
+        for (; r < last; ++r)
+        {
+            aData[r - aRowNr] = T();
+        }
+    }
+
+    // Splits the table into the three arrays stored in the ADIOS container.
+    void toArrays(std::vector<uint64_t> &aStarts,
+                  std::vector<uint64_t> &aLengths,
+                  std::vector<T> &aValues) const
+    {
+        aStarts.resize(itsRuns.size());
+        aLengths.resize(itsRuns.size());
+        aValues.resize(itsRuns.size());
+        for (size_t i = 0; i < itsRuns.size(); ++i)
+        {
+            aStarts[i] = itsRuns[i].start;
+            aLengths[i] = itsRuns[i].length;
+            aValues[i] = itsRuns[i].value;
+        }
+    }
+
+    // Adds runs read back from one ADIOS block. Call sort() once all blocks
+    // have been appended.
+    void append(const std::vector<uint64_t> &aStarts,
+                const std::vector<uint64_t> &aLengths,
+                const std::vector<T> &aValues)
+    {
+        for (size_t i = 0; i < aStarts.size(); ++i)
+        {
+            itsRuns.push_back({aStarts[i], aLengths[i], aValues[i]});
+        }
+    }
+
+    void sort()
+    {
+        std::sort(itsRuns.begin(), itsRuns.end(),
+                  [](const Run &a, const Run &b) { return a.start < b.start; });
+    }
+
+    // Runs covering rows [aRowNr, aRowNr + aNrRows), cut to that range and
+    // renumbered to start at row 0.
+    Adios2StManRunTable slice(uint64_t aRowNr, uint64_t aNrRows) const
+    {
+        Adios2StManRunTable table;
+        size_t i = find(aRowNr);
+        if (i >= itsRuns.size())
+        {
+            i = 0;
+        }
+        uint64_t last = aRowNr + aNrRows;
+        for (; i < itsRuns.size() && itsRuns[i].start < last; ++i)
+        {
+            uint64_t from = std::max(itsRuns[i].start, aRowNr);
+            uint64_t to = std::min(end(i), last);
+            if (from < to)
+            {
+                table.itsRuns.push_back(
+                    {from - aRowNr, to - from, itsRuns[i].value});
+            }
+        }
+        return table;
+    }
+
+    void clear() { itsRuns.clear(); }
+    size_t size() const { return itsRuns.size(); }
+    const Run &operator[](size_t i) const { return itsRuns[i]; }
+
+    // Whether any of rows [aRowNr, aRowNr + aNrRows) has been written.
+    bool overlaps(uint64_t aRowNr, uint64_t aNrRows) const
+    {
+        if (aNrRows == 0)
+        {
+            return false;
+        }
+        size_t i = find(aRowNr + aNrRows - 1);
+        return i < itsRuns.size() && end(i) > aRowNr;
+    }
+
+    // Index of the last run starting at or before aRowNr, or size() if none.
+    size_t find(uint64_t aRowNr) const
+    {
+        auto it = std::upper_bound(
+            itsRuns.begin(), itsRuns.end(), aRowNr,
+            [](uint64_t r, const Run &a) { return r < a.start; });
+        if (it == itsRuns.begin())
+        {
+            return itsRuns.size();
+        }
+        return (it - itsRuns.begin()) - 1;
+    }
+
+private:
+    uint64_t end(size_t i) const
+    {
+        return itsRuns[i].start + itsRuns[i].length;
+    }
+
+    void merge(size_t i)
+    {
+        if (i + 1 < itsRuns.size() && end(i) == itsRuns[i + 1].start &&
+            itsRuns[i].value == itsRuns[i + 1].value)
+        {
+            itsRuns[i].length += itsRuns[i + 1].length;
+            itsRuns.erase(itsRuns.begin() + i + 1);
+        }
+        if (i > 0 && end(i - 1) == itsRuns[i].start &&
+            itsRuns[i - 1].value == itsRuns[i].value)
+        {
+            itsRuns[i - 1].length += itsRuns[i].length;
+            itsRuns.erase(itsRuns.begin() + i);
+        }
+    }
+
+    std::vector<Run> itsRuns;
+};
+
+// Maps column values onto unsigned 64-bit words for delta coding. Integers
+// are sign-extended and floating point values use their bit pattern, so the
+// round trip is exact. All arithmetic on the words wraps modulo 2^64.
+template <class T, class Enable = void>
+struct Adios2StManDeltaTraits
+{
+    static const bool supported = false;
+    static uint64_t toWord(const T &) { return 0; }
+    static T fromWord(uint64_t) { return T(); }
+};
+
+template <class T>
+struct Adios2StManDeltaTraits<
+    T, typename std::enable_if<std::is_integral<T>::value>::type>
+{
+    static const bool supported = true;
+    static uint64_t toWord(const T &aValue)
+    {
+        return static_cast<uint64_t>(static_cast<int64_t>(aValue));
+    }
+    static T fromWord(uint64_t aWord)
+    {
+        return static_cast<T>(static_cast<int64_t>(aWord));
+    }
+};
+
+template <>
+struct Adios2StManDeltaTraits<double>
+{
+    static const bool supported = true;
+    static uint64_t toWord(const double &aValue)
+    {
+        uint64_t word;
+        std::memcpy(&word, &aValue, sizeof(word));
+        return word;
+    }
+    static double fromWord(uint64_t aWord)
+    {
+        double value;
+        std::memcpy(&value, &aWord, sizeof(value));
+        return value;
+    }
+};
+
+template <>
+struct Adios2StManDeltaTraits<float>
+{
+    static const bool supported = true;
+    static uint64_t toWord(const float &aValue)
+    {
+        uint32_t word;
+        std::memcpy(&word, &aValue, sizeof(word));
+        return word;
+    }
+    static float fromWord(uint64_t aWord)
+    {
+        uint32_t word = static_cast<uint32_t>(aWord);
+        float value;
+        std::memcpy(&value, &word, sizeof(value));
+        return value;
+    }
+};
+
+// One delta encoded segment of a scalar column, covering rows
+// [start, start + nrRows). The residuals (first differences for order 1,
+// second differences for order 2) are run-length encoded, so a constant
+// stride collapses into a single run. Checkpoints hold the decoder state
+// every itsInterval rows to bound the work for random single-row access.
+template <class T>
+class Adios2StManDeltaBlock
+{
+public:
+    typedef Adios2StManDeltaTraits<T> Traits;
+    static const uint64_t DefaultInterval = 1024;
+
+    Adios2StManDeltaBlock() : itsStart(0), itsNrRows(0), itsOrder(1),
+                              itsInterval(DefaultInterval)
+    {
+    }
+
+    void encode(uint64_t aStart, const std::vector<T> &aValues, int aOrder,
+                uint64_t aInterval)
+    {
+        itsStart = aStart;
+        itsNrRows = aValues.size();
+        itsOrder = aOrder;
+        itsInterval = aInterval;
+        itsCheckpoints.clear();
+        itsResiduals.clear();
+        uint64_t x = 0, d = 0;
+        for (uint64_t r = 0; r < itsNrRows; ++r)
+        {
+            if (r % itsInterval == 0)
+            {
+                itsCheckpoints.push_back(x);
+                itsCheckpoints.push_back(d);
+            }
+            uint64_t word = Traits::toWord(aValues[r]);
+            uint64_t delta = word - x;
+            itsResiduals.put(r, itsOrder == 2 ? delta - d : delta);
+            d = delta;
+            x = word;
+        }
+    }
+
+    // Decodes rows [aRowNr, aRowNr + aNrRows), which must lie inside the
+    // block, into aData.
+    void decode(uint64_t aRowNr, uint64_t aNrRows, T *aData) const
+    {
+        uint64_t first = aRowNr - itsStart;
+        uint64_t last = first + aNrRows;
+        uint64_t c = first / itsInterval;
+        uint64_t x = itsCheckpoints[2 * c];
+        uint64_t d = itsCheckpoints[2 * c + 1];
+        uint64_t r = c * itsInterval;
+        size_t i = itsResiduals.find(r);
+        for (; i < itsResiduals.size() && r < last; ++i)
+        {
+            const uint64_t v = itsResiduals[i].value;
+            const uint64_t runEnd =
+                std::min(itsResiduals[i].start + itsResiduals[i].length,
+                         last);
+            // skip rows before the requested range in closed form
+            if (r < first)
+            {
+                uint64_t k = std::min(runEnd, first) - r;
+                advance(x, d, v, k);
+                r += k;
+            }
+            // every row of a run is a closed form of its offset, so this
+            // loop carries no dependency and can be vectorized
+            const uint64_t n = runEnd - r;
+            T *out = aData + (r - first);
+            if (itsOrder == 2)
+            {
+                for (uint64_t k = 1; k <= n; ++k)
+                {
+                    out[k - 1] = Traits::fromWord(x + k * d + triangle(k) * v);
+                }
+            }
+            else
+            {
+                for (uint64_t k = 1; k <= n; ++k)
+                {
+                    out[k - 1] = Traits::fromWord(x + k * v);
+                }
+            }
+            advance(x, d, v, n);
+            r += n;
+        }
+    }
+
+    void toArrays(std::vector<uint64_t> &aHeader,
+                  std::vector<uint64_t> &aCheckpoints,
+                  std::vector<uint64_t> &aStarts,
+                  std::vector<uint64_t> &aLengths,
+                  std::vector<uint64_t> &aValues) const
+    {
+        aHeader = {itsStart, itsNrRows, static_cast<uint64_t>(itsOrder),
+                   itsInterval};
+        aCheckpoints = itsCheckpoints;
+        itsResiduals.toArrays(aStarts, aLengths, aValues);
+    }
+
+    void fromArrays(const std::vector<uint64_t> &aHeader,
+                    const std::vector<uint64_t> &aCheckpoints,
+                    const std::vector<uint64_t> &aStarts,
+                    const std::vector<uint64_t> &aLengths,
+                    const std::vector<uint64_t> &aValues)
+    {
+        itsStart = aHeader[0];
+        itsNrRows = aHeader[1];
+        itsOrder = static_cast<int>(aHeader[2]);
+        itsInterval = aHeader[3];
+        itsCheckpoints = aCheckpoints;
+        itsResiduals.clear();
+        itsResiduals.append(aStarts, aLengths, aValues);
+    }
+
+    // Rows [aRowNr, aRowNr + aNrRows) of the block as a block of their own,
+    // without decoding them. aRowNr has to be a checkpoint, see alignDown().
+    Adios2StManDeltaBlock slice(uint64_t aRowNr, uint64_t aNrRows) const
+    {
+        Adios2StManDeltaBlock block;
+        uint64_t first = aRowNr - itsStart;
+        block.itsStart = aRowNr;
+        block.itsNrRows = aNrRows;
+        block.itsOrder = itsOrder;
+        block.itsInterval = itsInterval;
+        uint64_t from = first / itsInterval;
+        uint64_t to = (first + aNrRows + itsInterval - 1) / itsInterval;
+        block.itsCheckpoints.assign(itsCheckpoints.begin() + 2 * from,
+                                    itsCheckpoints.begin() + 2 * to);
+        block.itsResiduals = itsResiduals.slice(first, aNrRows);
+        return block;
+    }
+
+    // The checkpoint at or before aRowNr, and the one at or after it or the
+    // end of the block, for a row inside the block.
+    uint64_t alignDown(uint64_t aRowNr) const
+    {
+        return itsStart + (aRowNr - itsStart) / itsInterval * itsInterval;
+    }
+    uint64_t alignUp(uint64_t aRowNr) const
+    {
+        uint64_t row = itsStart + (aRowNr - itsStart + itsInterval - 1) /
+                                      itsInterval * itsInterval;
+        return std::min(row, itsStart + itsNrRows);
+    }
+
+    uint64_t start() const { return itsStart; }
+    uint64_t nrRows() const { return itsNrRows; }
+
+private:
+    // k * (k + 1) / 2 without losing the top bit to the multiplication
+    static uint64_t triangle(uint64_t k)
+    {
+        return (k % 2 == 0) ? (k / 2) * (k + 1) : k * ((k + 1) / 2);
+    }
+
+    // state after k more rows with constant residual v
+    void advance(uint64_t &x, uint64_t &d, uint64_t v, uint64_t k) const
+    {
+        if (itsOrder == 2)
+        {
+            x += k * d + triangle(k) * v;
+            d += k * v;
+        }
+        else
+        {
+            x += k * v;
+            d = v;
+        }
+    }
+
+    uint64_t itsStart;
+    uint64_t itsNrRows;
+    int itsOrder;
+    uint64_t itsInterval;
+    std::vector<uint64_t> itsCheckpoints;
+    Adios2StManRunTable<uint64_t> itsResiduals;
+};
+
+// Permutation from logical row numbers to the rows they are stored at,
+// kept as runs in which logical rows start + i are stored at rows
+// target + i * stride. Strides wrap modulo 2^64, so descending runs are
+// runs as well. Rows past the last run are stored in place. A table
+// reordered baseline-major collapses into one run per time step.
+class Adios2StManRowMap
+{
+public:
+    struct Run
+    {
+        uint64_t start;
+        uint64_t length;
+        uint64_t target;
+        uint64_t stride;
+    };
+
+    // Builds the map from the stored row aTargets[r] of every logical
+    // row r.
+    void build(const std::vector<uint64_t> &aTargets)
+    {
+        itsRuns.clear();
+        uint64_t n = aTargets.size();
+        for (uint64_t i = 0; i < n;)
+        {
+            Run run = {i, 1, aTargets[i], 1};
+            if (i + 1 < n)
+            {
+                run.stride = aTargets[i + 1] - aTargets[i];
+                while (i + run.length < n &&
+                       aTargets[i + run.length] -
+                               aTargets[i + run.length - 1] ==
+                           run.stride)
+                {
+                    ++run.length;
+                }
+            }
+            itsRuns.push_back(run);
+            i += run.length;
+        }
+        if (itsRuns.size() == 1 && itsRuns[0].target == 0 &&
+            itsRuns[0].stride == 1)
+        {
+            // rows stored in place need no map
+            itsRuns.clear();
+        }
+    }
+
+    uint64_t map(uint64_t aRowNr) const
+    {
+        size_t i = find(aRowNr);
+        if (i < itsRuns.size() && aRowNr < end(i))
+        {
+            return itsRuns[i].target + (aRowNr - itsRuns[i].start) *
+                                           itsRuns[i].stride;
+        }
+        return aRowNr;
+    }
+
+    // Calls aFunc(target, nrRows, stride) for the parts of the logical rows
+    // [aRowNr, aRowNr + aNrRows) in the runs they fall in, in logical order.
+    template <class F>
+    void forEachRun(uint64_t aRowNr, uint64_t aNrRows, F aFunc) const
+    {
+        uint64_t row = aRowNr;
+        uint64_t last = aRowNr + aNrRows;
+        size_t i = find(row);
+        if (i == itsRuns.size())
+        {
+            i = 0;
+        }
+        while (row < last)
+        {
+            if (i < itsRuns.size() && row >= end(i))
+            {
+                ++i;
+                continue;
+            }
+            if (i == itsRuns.size() || row < itsRuns[i].start)
+            {
+                uint64_t to = (i < itsRuns.size())
+                                  ? std::min(last, itsRuns[i].start)
+                                  : last;
+                aFunc(row, to - row, uint64_t(1));
+                row = to;
+                continue;
+            }
+            const Run &run = itsRuns[i];
+            uint64_t to = std::min(last, end(i));
+            aFunc(run.target + (row - run.start) * run.stride, to - row,
+                  (to - row > 1) ? run.stride : uint64_t(1));
+            row = to;
+        }
+    }
+
+    void add(const Run &aRun) { itsRuns.push_back(aRun); }
+    void clear() { itsRuns.clear(); }
+    bool empty() const { return itsRuns.empty(); }
+    size_t size() const { return itsRuns.size(); }
+    const Run &operator[](size_t i) const { return itsRuns[i]; }
+
+private:
+    uint64_t end(size_t i) const
+    {
+        return itsRuns[i].start + itsRuns[i].length;
+    }
+
+    // Index of the last run starting at or before aRowNr, or size() if none.
+    size_t find(uint64_t aRowNr) const
+    {
+        auto it = std::upper_bound(
+            itsRuns.begin(), itsRuns.end(), aRowNr,
+            [](uint64_t r, const Run &a) { return r < a.start; });
+        if (it == itsRuns.begin())
+        {
+            return itsRuns.size();
+        }
+        return (it - itsRuns.begin()) - 1;
+    }
+
+    std::vector<Run> itsRuns;
+};
+
+} // namespace casacore
+
+#endif
@@ -0,0 +1,74 @@
+//    (c) Oak Ridge National Laboratory
+//    1 Bethel Valley Road, Oak Ridge, TN 37830, United States
+//
+//    This library is free software: you can redistribute it and/or
+//    modify it under the terms of the GNU General Public License as published
+//    by the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License along
+//    with this library. If not, see <http://www.gnu.org/licenses/>.
+//
+//    Any bugs, questions, concerns and/or suggestions please email to
+//    wangr1@ornl.gov or jason.ruonan.wang@gmail.com
+
+#include "Adios2StManPrefetch.h"
+
+namespace casacore
+{
+
+Adios2StManPrefetcher::Adios2StManPrefetcher()
+: itsStop(false), itsThread(&Adios2StManPrefetcher::run, this)
+{
+}
+
+Adios2StManPrefetcher::~Adios2StManPrefetcher()
+{
+    {
+        std::lock_guard<std::mutex> lock(itsMutex);
+        itsStop = true;
+        itsTasks.clear();
+    }
+    itsCondition.notify_all();
+    itsThread.join();
+}
+
+std::shared_future<void>
+Adios2StManPrefetcher::submit(std::function<void()> aTask)
+{
+    std::packaged_task<void()> task(std::move(aTask));
+    std::shared_future<void> done = task.get_future().share();
+    {
+        std::lock_guard<std::mutex> lock(itsMutex);
+        itsTasks.push_back(std::move(task));
+    }
+    itsCondition.notify_one();
+    return done;
+}
+
+void Adios2StManPrefetcher::run()
+{
+    while (true)
+    {
+        std::packaged_task<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(itsMutex);
+            itsCondition.wait(lock,
+                              [this] { return itsStop || !itsTasks.empty(); });
+            if (itsStop)
+            {
+                return;
+            }
+            task = std::move(itsTasks.front());
+            itsTasks.pop_front();
+        }
+        task();
+    }
+}
+
+} // namespace casacore
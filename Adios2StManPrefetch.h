@@ -0,0 +1,73 @@
+//    (c) Oak Ridge National Laboratory
+//    1 Bethel Valley Road, Oak Ridge, TN 37830, United States
+//
+//    This library is free software: you can redistribute it and/or
+//    modify it under the terms of the GNU General Public License as published
+//    by the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License along
+//    with this library. If not, see <http://www.gnu.org/licenses/>.
+//
+//    Any bugs, questions, concerns and/or suggestions please email to
+//    wangr1@ornl.gov or jason.ruonan.wang@gmail.com
+
+#ifndef ADIOS2STMANPREFETCH_H
+#define ADIOS2STMANPREFETCH_H
+
+#include <casacore/casa/Arrays/Slicer.h>
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+namespace casacore
+{
+
+// Access pattern of a column as announced by the application, used to read
+// ahead of the consumer in the background.
+struct Adios2StManAccessHint
+{
+    char kind = 'n';     // 'n'-none, 's'-sequential rows, 'l'-list of ranges
+    uint64_t window = 0; // rows per read-ahead request, 0 for whole ranges
+    uint64_t depth = 2;  // read-ahead requests kept in flight
+    std::deque<std::pair<uint64_t, uint64_t>> ranges; // (first row, nr rows)
+    bool sliced = false; // whether the consumer reads slice of every cell
+    Slicer slicer;
+};
+
+// Runs read-ahead requests in order on a single background thread. The
+// requests of all columns of a storage manager share it, as they have to
+// take turns on the engine anyway.
+class Adios2StManPrefetcher
+{
+public:
+    Adios2StManPrefetcher();
+    // Drops the requests that have not started and waits for the running one.
+    ~Adios2StManPrefetcher();
+
+    std::shared_future<void> submit(std::function<void()> aTask);
+
+private:
+    void run();
+
+    std::mutex itsMutex;
+    std::condition_variable itsCondition;
+    std::deque<std::packaged_task<void()>> itsTasks;
+    bool itsStop;
+    std::thread itsThread;
+};
+
+} // namespace casacore
+
+#endif
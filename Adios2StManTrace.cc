@@ -0,0 +1,380 @@
+//    (c) Oak Ridge National Laboratory
+//    1 Bethel Valley Road, Oak Ridge, TN 37830, United States
+//
+//    This library is free software: you can redistribute it and/or
+//    modify it under the terms of the GNU General Public License as published
+//    by the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License along
+//    with this library. If not, see <http://www.gnu.org/licenses/>.
+//
+//    Any bugs, questions, concerns and/or suggestions please email to
+//    wangr1@ornl.gov or jason.ruonan.wang@gmail.com
+
+#include "Adios2StManTrace.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+namespace casacore
+{
+
+std::mutex Adios2StManTracer::itsTracersMutex;
+std::map<std::string, std::weak_ptr<Adios2StManTracer>>
+    Adios2StManTracer::itsTracers;
+
+std::shared_ptr<Adios2StManTracer>
+Adios2StManTracer::open(const std::string &aPath, int aRank)
+{
+    std::lock_guard<std::mutex> lock(itsTracersMutex);
+    std::shared_ptr<Adios2StManTracer> tracer = itsTracers[aPath].lock();
+    if (!tracer)
+    {
+        tracer.reset(new Adios2StManTracer(aPath, aRank));
+        itsTracers[aPath] = tracer;
+    }
+    return tracer;
+}
+
+Adios2StManTracer::Adios2StManTracer(const std::string &aPath, int aRank)
+: itsPath(aPath), itsFile(std::fopen(aPath.c_str(), "w")), itsRank(aRank)
+{
+    if (!itsFile)
+    {
+        throw(std::runtime_error("Adios2StMan: cannot open trace file " +
+                                 aPath));
+    }
+    std::fprintf(itsFile,
+                 "[\n{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,"
+                 "\"args\":{\"name\":\"rank %d\"}}",
+                 itsRank, itsRank);
+}
+
+Adios2StManTracer::~Adios2StManTracer()
+{
+    std::fprintf(itsFile, "\n]\n");
+    std::fclose(itsFile);
+    std::lock_guard<std::mutex> lock(itsTracersMutex);
+    auto it = itsTracers.find(itsPath);
+    if (it != itsTracers.end() && it->second.expired())
+    {
+        itsTracers.erase(it);
+    }
+}
+
+void Adios2StManTracer::record(const char *aName, const std::string *aColumn,
+                               uint64_t aRowStart, uint64_t aNrRows,
+                               double aBegin, double aEnd)
+{
+    std::string args;
+    if (aColumn)
+    {
+        args = ",\"args\":{\"column\":\"";
+        for (char c : *aColumn)
+        {
+            if (c == '"' || c == '\\')
+            {
+                args += '\\';
+            }
+            if ((unsigned char)c < 0x20)
+            {
+                char escaped[8];
+                std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                args += escaped;
+                continue;
+            }
+            args += c;
+        }
+        args += "\"";
+        if (aNrRows > 0)
+        {
+            args += ",\"row\":" + std::to_string(aRowStart) +
+                    ",\"rows\":" + std::to_string(aNrRows);
+        }
+        args += "}";
+    }
+    std::lock_guard<std::mutex> lock(itsMutex);
+    auto thread = itsThreads.emplace(std::this_thread::get_id(),
+                                     int(itsThreads.size()))
+                      .first;
+    std::fprintf(itsFile,
+                 ",\n{\"name\":\"%s\",\"cat\":\"adios2stman\",\"ph\":\"X\","
+                 "\"pid\":%d,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f%s}",
+                 aName, itsRank, thread->second, aBegin, aEnd - aBegin,
+                 args.c_str());
+}
+
+double Adios2StManTracer::now()
+{
+    return std::chrono::duration<double, std::micro>(
+               std::chrono::system_clock::now().time_since_epoch())
+        .count();
+}
+
+std::mutex Adios2StManAccessLog::itsLogsMutex;
+std::map<std::string, std::weak_ptr<Adios2StManAccessLog>>
+    Adios2StManAccessLog::itsLogs;
+
+std::shared_ptr<Adios2StManAccessLog>
+Adios2StManAccessLog::open(const std::string &aPath)
+{
+    std::lock_guard<std::mutex> lock(itsLogsMutex);
+    std::shared_ptr<Adios2StManAccessLog> log = itsLogs[aPath].lock();
+    if (!log)
+    {
+        log.reset(new Adios2StManAccessLog(aPath));
+        itsLogs[aPath] = log;
+    }
+    return log;
+}
+
+Adios2StManAccessLog::Adios2StManAccessLog(const std::string &aPath)
+: itsPath(aPath), itsFile(std::fopen(aPath.c_str(), "w")),
+  itsHasPending(false)
+{
+    if (!itsFile)
+    {
+        throw(std::runtime_error("Adios2StMan: cannot open access log " +
+                                 aPath));
+    }
+    std::fprintf(itsFile, "# adios2stman access log 2\n");
+}
+
+Adios2StManAccessLog::~Adios2StManAccessLog()
+{
+    if (itsHasPending)
+    {
+        write(itsPending);
+    }
+    std::fclose(itsFile);
+    std::lock_guard<std::mutex> lock(itsLogsMutex);
+    auto it = itsLogs.find(itsPath);
+    if (it != itsLogs.end() && it->second.expired())
+    {
+        itsLogs.erase(it);
+    }
+}
+
+void Adios2StManAccessLog::record(const Access &aAccess)
+{
+    std::lock_guard<std::mutex> lock(itsMutex);
+    if (itsHasPending)
+    {
+        Access &pending = itsPending;
+        if (aAccess.kind == 'c' && pending.put == aAccess.put &&
+            pending.table == aAccess.table &&
+            pending.column == aAccess.column &&
+            pending.start == aAccess.start &&
+            pending.length == aAccess.length &&
+            pending.stride == aAccess.stride &&
+            pending.rows.size() < MaxMergedRanges)
+        {
+            auto &last = pending.rows.back();
+            if (aAccess.rows[0].first == last.first + last.second)
+            {
+                last.second += aAccess.rows[0].second;
+            }
+            else
+            {
+                pending.rows.push_back(aAccess.rows[0]);
+            }
+            return;
+        }
+        write(pending);
+        itsHasPending = false;
+    }
+    if (aAccess.kind == 'c')
+    {
+        itsPending = aAccess;
+        itsHasPending = true;
+    }
+    else
+    {
+        write(aAccess);
+    }
+}
+
+// Table and column names are written in double quotes, with quotes,
+// backslashes and control characters escaped, as they may hold spaces.
+static std::string quoteName(const std::string &aName)
+{
+    std::string quoted = "\"";
+    for (char c : aName)
+    {
+        if (c == '"' || c == '\\')
+        {
+            quoted += '\\';
+        }
+        if ((unsigned char)c < 0x20)
+        {
+            char escaped[8];
+            std::snprintf(escaped, sizeof(escaped), "\\x%02x", c);
+            quoted += escaped;
+            continue;
+        }
+        quoted += c;
+    }
+    return quoted + '"';
+}
+
+// Reads a name written by quoteName(), or a bare word from logs of
+// version 1, which did not quote names.
+static bool readName(std::istream &aStream, int aVersion, std::string &aName)
+{
+    aName.clear();
+    if (aVersion < 2)
+    {
+        return bool(aStream >> aName);
+    }
+    char c;
+    if (!(aStream >> c) || c != '"')
+    {
+        return false;
+    }
+    while (aStream.get(c))
+    {
+        if (c == '"')
+        {
+            return true;
+        }
+        if (c == '\\')
+        {
+            if (!aStream.get(c))
+            {
+                return false;
+            }
+            if (c == 'x')
+            {
+                char hex[3] = {0, 0, 0};
+                if (!aStream.get(hex[0]) || !aStream.get(hex[1]))
+                {
+                    return false;
+                }
+                c = char(std::strtol(hex, nullptr, 16));
+            }
+        }
+        aName += c;
+    }
+    return false;
+}
+
+void Adios2StManAccessLog::write(const Access &aAccess)
+{
+    std::ostringstream line;
+    line << (aAccess.put ? "put " : "get ")
+         << (aAccess.kind == 'c' ? "cell "
+                                 : (aAccess.kind == 'r' ? "cells " : "column "))
+         << quoteName(aAccess.table) << ' ' << quoteName(aAccess.column)
+         << ' ';
+    if (aAccess.kind == 'a')
+    {
+        line << '-';
+    }
+    for (size_t i = 0; i < aAccess.rows.size(); ++i)
+    {
+        line << (i ? "," : "") << aAccess.rows[i].first << '+'
+             << aAccess.rows[i].second;
+    }
+    line << ' ';
+    if (aAccess.start.empty())
+    {
+        line << '-';
+    }
+    const std::vector<int64_t> *parts[] = {&aAccess.start, &aAccess.length,
+                                           &aAccess.stride};
+    for (size_t p = 0; p < 3 && !aAccess.start.empty(); ++p)
+    {
+        for (size_t i = 0; i < parts[p]->size(); ++i)
+        {
+            line << (i ? "," : (p ? "/" : "")) << (*parts[p])[i];
+        }
+    }
+    line << '\n';
+    std::fputs(line.str().c_str(), itsFile);
+}
+
+std::vector<Adios2StManAccessLog::Access>
+Adios2StManAccessLog::load(const std::string &aPath)
+{
+    std::ifstream file(aPath);
+    if (!file)
+    {
+        throw(std::runtime_error("Adios2StMan: cannot open access log " +
+                                 aPath));
+    }
+    std::vector<Access> accesses;
+    std::string line;
+    int version = 1;
+    for (size_t lineNr = 1; std::getline(file, line); ++lineNr)
+    {
+        if (line.empty() || line[0] == '#')
+        {
+            // names are quoted from version 2 on
+            const std::string header = "# adios2stman access log ";
+            if (lineNr == 1 && line.compare(0, header.size(), header) == 0)
+            {
+                version = std::atoi(line.c_str() + header.size());
+                if (version > 2)
+                {
+                    throw(std::runtime_error(
+                        "Adios2StMan: unsupported version " +
+                        std::to_string(version) + " of access log " + aPath));
+                }
+            }
+            continue;
+        }
+        std::istringstream fields(line);
+        std::string op, kind, rows, slicer;
+        Access access;
+        fields >> op >> kind;
+        if (!readName(fields, version, access.table) ||
+            !readName(fields, version, access.column))
+        {
+            fields.setstate(std::ios::failbit);
+        }
+        fields >> rows >> slicer;
+        access.put = (op == "put");
+        access.kind = kind == "cell" ? 'c' : (kind == "cells" ? 'r' : 'a');
+        if (!fields || (op != "get" && !access.put) ||
+            (kind != "cell" && kind != "cells" && kind != "column"))
+        {
+            throw(std::runtime_error("Adios2StMan: malformed line " +
+                                     std::to_string(lineNr) +
+                                     " in access log " + aPath));
+        }
+        std::istringstream ranges(rows == "-" ? "" : rows);
+        std::string range;
+        while (std::getline(ranges, range, ','))
+        {
+            size_t plus = range.find('+');
+            access.rows.emplace_back(std::stoull(range.substr(0, plus)),
+                                     std::stoull(range.substr(plus + 1)));
+        }
+        std::istringstream parts(slicer == "-" ? "" : slicer);
+        std::vector<int64_t> *axes[] = {&access.start, &access.length,
+                                        &access.stride};
+        std::string part;
+        for (size_t p = 0; p < 3 && std::getline(parts, part, '/'); ++p)
+        {
+            std::istringstream values(part);
+            std::string value;
+            while (std::getline(values, value, ','))
+            {
+                axes[p]->push_back(std::stoll(value));
+            }
+        }
+        accesses.push_back(access);
+    }
+    return accesses;
+}
+
+} // namespace casacore
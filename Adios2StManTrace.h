@@ -0,0 +1,158 @@
+//    (c) Oak Ridge National Laboratory
+//    1 Bethel Valley Road, Oak Ridge, TN 37830, United States
+//
+//    This library is free software: you can redistribute it and/or
+//    modify it under the terms of the GNU General Public License as published
+//    by the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License along
+//    with this library. If not, see <http://www.gnu.org/licenses/>.
+//
+//    Any bugs, questions, concerns and/or suggestions please email to
+//    wangr1@ornl.gov or jason.ruonan.wang@gmail.com
+
+#ifndef ADIOS2STMANTRACE_H
+#define ADIOS2STMANTRACE_H
+
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace casacore
+{
+
+// Writes storage manager events as a Chrome trace (JSON array of complete
+// events), which Perfetto and chrome://tracing load. Timestamps are wall
+// clock microseconds, so the files of the ranks of a job line up.
+class Adios2StManTracer
+{
+public:
+    // Opens the trace file aPath, or returns the tracer already writing it,
+    // so that the tables of a process share one file per rank.
+    static std::shared_ptr<Adios2StManTracer> open(const std::string &aPath,
+                                                   int aRank);
+    ~Adios2StManTracer();
+
+    // Records event aName from aBegin to aEnd, tagged with column aColumn
+    // and rows [aRowStart, aRowStart + aNrRows) if given. Thread safe.
+    void record(const char *aName, const std::string *aColumn,
+                uint64_t aRowStart, uint64_t aNrRows, double aBegin,
+                double aEnd);
+    static double now();
+
+private:
+    Adios2StManTracer(const std::string &aPath, int aRank);
+
+    std::mutex itsMutex;
+    std::string itsPath;
+    std::FILE *itsFile;
+    int itsRank;
+    std::map<std::thread::id, int> itsThreads;
+
+    static std::mutex itsTracersMutex;
+    static std::map<std::string, std::weak_ptr<Adios2StManTracer>> itsTracers;
+};
+
+// Records the lifetime of the scope as an event. Without a tracer it does
+// not read the clock, so tracing costs a pointer test when disabled.
+class Adios2StManTraceScope
+{
+public:
+    Adios2StManTraceScope(Adios2StManTracer *aTracer, const char *aName,
+                          const std::string *aColumn = 0,
+                          uint64_t aRowStart = 0, uint64_t aNrRows = 0)
+    : itsTracer(aTracer), itsName(aName), itsColumn(aColumn),
+      itsRowStart(aRowStart), itsNrRows(aNrRows),
+      itsBegin(aTracer ? Adios2StManTracer::now() : 0)
+    {
+    }
+    ~Adios2StManTraceScope()
+    {
+        if (itsTracer)
+        {
+            itsTracer->record(itsName, itsColumn, itsRowStart, itsNrRows,
+                              itsBegin, Adios2StManTracer::now());
+        }
+    }
+
+private:
+    Adios2StManTraceScope(const Adios2StManTraceScope &);
+    Adios2StManTraceScope &operator=(const Adios2StManTraceScope &);
+
+    Adios2StManTracer *itsTracer;
+    const char *itsName;
+    const std::string *itsColumn;
+    uint64_t itsRowStart;
+    uint64_t itsNrRows;
+    double itsBegin;
+};
+
+// Compact log of the column accesses made through the storage manager,
+// which adios2replay re-executes to compare storage manager settings.
+// Every access is a line
+//   <get|put> <cell|cells|column> <table> <column> <rows> <slicer>
+// where table is the absolute path of the table, rows are first+count
+// ranges separated by commas, or - for the whole column, and the slicer is
+// start/length/stride with comma separated axes, or - for whole cells.
+// Successive cell accesses of a column with the same op and slicer are
+// merged into one line listing their rows, so a loop over rows logs one
+// line per column rather than one per cell.
+class Adios2StManAccessLog
+{
+public:
+    struct Access
+    {
+        bool put;
+        char kind; // 'c' one cell per call, 'r' rows in one call, 'a' all
+        std::string table;
+        std::string column;
+        std::vector<std::pair<uint64_t, uint64_t>> rows; // first, count
+        std::vector<int64_t> start;                      // empty: whole cells
+        std::vector<int64_t> length;
+        std::vector<int64_t> stride;
+    };
+
+    // Opens the log file aPath, or returns the log already writing it, so
+    // that the tables of a process share one file per rank.
+    static std::shared_ptr<Adios2StManAccessLog> open(const std::string &aPath);
+    ~Adios2StManAccessLog();
+
+    // Records aAccess. Thread safe.
+    void record(const Access &aAccess);
+    // Reads the accesses logged to aPath.
+    static std::vector<Access> load(const std::string &aPath);
+
+private:
+    // most rows merged into one line
+    static const size_t MaxMergedRanges = 4096;
+
+    explicit Adios2StManAccessLog(const std::string &aPath);
+    void write(const Access &aAccess);
+
+    std::mutex itsMutex;
+    std::string itsPath;
+    std::FILE *itsFile;
+    // the last access if it was a cell access, held back to merge the
+    // cells that follow it and written once any other access is recorded,
+    // so that the log keeps the order of the accesses
+    Access itsPending;
+    bool itsHasPending;
+
+    static std::mutex itsLogsMutex;
+    static std::map<std::string, std::weak_ptr<Adios2StManAccessLog>> itsLogs;
+};
+
+} // namespace casacore
+
+#endif
@@ -0,0 +1,668 @@
+//    (c) Oak Ridge National Laboratory
+//    1 Bethel Valley Road, Oak Ridge, TN 37830, United States
+//
+//    This library is free software: you can redistribute it and/or
+//    modify it under the terms of the GNU General Public License as published
+//    by the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License along
+//    with this library. If not, see <http://www.gnu.org/licenses/>.
+//
+//    Any bugs, questions, concerns and/or suggestions please email to
+//    wangr1@ornl.gov or jason.ruonan.wang@gmail.com
+
+// ################################################################################
+// adios2convert copies a casa table into a new table whose columns (or a
+// selection of them) are stored with Adios2StMan. Columns are moved in
+// chunks of rows through getColumnCells/putColumnCells, which Adios2StMan
+// turns into one ADIOS selection per chunk. Columns are handled by a pool
+// of worker threads, each opening its own column objects, so that columns
+// of different data managers are read and written at the same time. As
+// casacore tables are not thread-safe, calls on a table itself are
+// serialized, and so are the accesses to the columns of one data manager,
+// which share its buffers.
+//
+// With MPI, every rank converts its own contiguous share of the rows of the
+// Adios2StMan columns into the shared ADIOS container, and the master rank
+// copies the columns that stay with their original storage managers; the
+// other ranks leave those out of their scratch table files.
+//
+// Array columns without a fixed shape are converted if all their cells
+// share one shape, and otherwise stay where they are, as do String
+// columns, which ADIOS cannot store as arrays. Such columns are listed at
+// the end; if they were selected with -c, or if any column could not be
+// copied, the failed columns are listed and the exit status is non-zero.
+//
+// With -k, the Adios2StMan columns are stored sorted by the given integer
+// key columns, e.g. -k ANTENNA1,ANTENNA2 for a baseline-major layout. The
+// chunks then hold the rows of the output in stored order, so every chunk
+// is still written with one selection, and the ranks share out stored rows.
+//
+// Usage:
+//   adios2convert [-c col1,col2,...] [-k key1,key2,...] [-t threads]
+//                 [-r rowsPerChunk] [-e engineType] [-p key=value]...
+//                 input.table output.table
+
+#include "Adios2StMan.h"
+#include <casacore/casa/Containers/Record.h>
+#include <casacore/tables/Tables/ArrayColumn.h>
+#include <casacore/tables/Tables/ScalarColumn.h>
+#include <casacore/tables/Tables/SetupNewTab.h>
+#include <casacore/tables/Tables/TableColumn.h>
+#include <casacore/tables/Tables/TableDesc.h>
+#include <casacore/casa/namespace.h>
+#ifdef HAVE_MPI
+#include <mpi.h>
+#endif
+
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <unistd.h>
+
+namespace
+{
+
+struct ColumnJob
+{
+    String name;
+    bool toAdios;
+    rownr_t rowStart;
+    rownr_t nrRows;
+};
+
+// One lock per data manager of a table, as the columns of a data manager
+// share its buffers, while different data managers can be accessed at the
+// same time.
+class ManagerLocks
+{
+public:
+    void init(const Record &aDmInfo)
+    {
+        for (uInt i = 0; i < aDmInfo.nfields(); ++i)
+        {
+            itsMutexes.emplace_back();
+            Vector<String> columns(
+                aDmInfo.subRecord(Int(i)).asArrayString("COLUMNS"));
+            for (uInt j = 0; j < columns.nelements(); ++j)
+            {
+                itsColumns[columns[j]] = &itsMutexes.back();
+            }
+        }
+    }
+    std::mutex &operator[](const String &aColumn)
+    {
+        return *itsColumns.at(aColumn);
+    }
+
+private:
+    std::deque<std::mutex> itsMutexes;
+    std::map<String, std::mutex *> itsColumns;
+};
+
+// guard calls on the tables themselves
+std::mutex inMutex;
+std::mutex outMutex;
+// guard the accesses to their columns
+ManagerLocks inLocks;
+ManagerLocks outLocks;
+rownr_t rowsPerChunk = 0;
+// rowOrder[i] is the row stored at row i of the Adios2StMan columns, empty
+// if they are stored in row order
+std::vector<rownr_t> rowOrder;
+const uint64_t defaultChunkBytes = 64 << 20;
+
+rownr_t chunkRows(uint64_t rowBytes)
+{
+    if (rowsPerChunk > 0)
+    {
+        return rowsPerChunk;
+    }
+    return std::max<uint64_t>(1, defaultChunkBytes / std::max<uint64_t>(1, rowBytes));
+}
+
+// Rows of chunk [aRow, aRow + aNrRows) of a job, which are the rows stored
+// there for a column converted to a reordered Adios2StMan.
+RefRows jobRows(const ColumnJob &job, rownr_t aRow, rownr_t aNrRows)
+{
+    if (!job.toAdios || rowOrder.empty())
+    {
+        return RefRows(aRow, aRow + aNrRows - 1);
+    }
+    return RefRows(Vector<rownr_t>(std::vector<rownr_t>(
+        rowOrder.begin() + aRow, rowOrder.begin() + aRow + aNrRows)));
+}
+
+template <class T>
+uint64_t copyScalar(const Table &in, Table &out, const ColumnJob &job)
+{
+    std::unique_ptr<ScalarColumn<T>> inCol, outCol;
+    {
+        std::lock_guard<std::mutex> lock(inMutex);
+        inCol.reset(new ScalarColumn<T>(in, job.name));
+    }
+    {
+        std::lock_guard<std::mutex> lock(outMutex);
+        outCol.reset(new ScalarColumn<T>(out, job.name));
+    }
+    rownr_t step = chunkRows(sizeof(T));
+    Vector<T> data;
+    for (rownr_t row = job.rowStart; row < job.rowStart + job.nrRows; row += step)
+    {
+        rownr_t n = std::min(step, job.rowStart + job.nrRows - row);
+        RefRows rows = jobRows(job, row, n);
+        {
+            std::lock_guard<std::mutex> lock(inLocks[job.name]);
+            inCol->getColumnCells(rows, data, True);
+        }
+        {
+            std::lock_guard<std::mutex> lock(outLocks[job.name]);
+            outCol->putColumnCells(rows, data);
+        }
+    }
+    return uint64_t(job.nrRows) * sizeof(T);
+}
+
+template <class T>
+uint64_t copyArray(const Table &in, Table &out, const ColumnJob &job)
+{
+    std::unique_ptr<ArrayColumn<T>> inCol, outCol;
+    bool fixedShape;
+    {
+        std::lock_guard<std::mutex> lock(inMutex);
+        inCol.reset(new ArrayColumn<T>(in, job.name));
+        fixedShape = job.toAdios ||
+                     (inCol->columnDesc().options() & ColumnDesc::FixedShape);
+    }
+    {
+        std::lock_guard<std::mutex> lock(outMutex);
+        outCol.reset(new ArrayColumn<T>(out, job.name));
+    }
+    uint64_t bytes = 0;
+    if (!fixedShape)
+    {
+        // variable shaped cells can only be copied one row at a time
+        Array<T> cell;
+        for (rownr_t row = job.rowStart; row < job.rowStart + job.nrRows; ++row)
+        {
+            {
+                std::lock_guard<std::mutex> lock(inLocks[job.name]);
+                if (!inCol->isDefined(row))
+                {
+                    continue;
+                }
+                inCol->get(row, cell, True);
+            }
+            {
+                std::lock_guard<std::mutex> lock(outLocks[job.name]);
+                outCol->put(row, cell);
+            }
+            bytes += cell.nelements() * sizeof(T);
+        }
+        return bytes;
+    }
+    uint64_t rowBytes;
+    {
+        std::lock_guard<std::mutex> lock(inLocks[job.name]);
+        rowBytes = inCol->shape(job.rowStart).product() * sizeof(T);
+    }
+    rownr_t step = chunkRows(rowBytes);
+    Array<T> data;
+    for (rownr_t row = job.rowStart; row < job.rowStart + job.nrRows; row += step)
+    {
+        rownr_t n = std::min(step, job.rowStart + job.nrRows - row);
+        RefRows rows = jobRows(job, row, n);
+        {
+            std::lock_guard<std::mutex> lock(inLocks[job.name]);
+            inCol->getColumnCells(rows, data, True);
+        }
+        {
+            std::lock_guard<std::mutex> lock(outLocks[job.name]);
+            outCol->putColumnCells(rows, data);
+        }
+        bytes += data.nelements() * sizeof(T);
+    }
+    return bytes;
+}
+
+uint64_t copyColumn(const Table &in, Table &out, const ColumnJob &job)
+{
+    if (job.nrRows == 0)
+    {
+        return 0;
+    }
+    bool scalar;
+    DataType dataType;
+    {
+        std::lock_guard<std::mutex> lock(inMutex);
+        const ColumnDesc &desc = in.tableDesc().columnDesc(job.name);
+        scalar = desc.isScalar();
+        dataType = desc.dataType();
+    }
+    switch (dataType)
+    {
+    case TpBool:
+        return scalar ? copyScalar<Bool>(in, out, job)
+                      : copyArray<Bool>(in, out, job);
+    case TpUChar:
+        return scalar ? copyScalar<uChar>(in, out, job)
+                      : copyArray<uChar>(in, out, job);
+    case TpShort:
+        return scalar ? copyScalar<Short>(in, out, job)
+                      : copyArray<Short>(in, out, job);
+    case TpUShort:
+        return scalar ? copyScalar<uShort>(in, out, job)
+                      : copyArray<uShort>(in, out, job);
+    case TpInt:
+        return scalar ? copyScalar<Int>(in, out, job)
+                      : copyArray<Int>(in, out, job);
+    case TpUInt:
+        return scalar ? copyScalar<uInt>(in, out, job)
+                      : copyArray<uInt>(in, out, job);
+    case TpFloat:
+        return scalar ? copyScalar<Float>(in, out, job)
+                      : copyArray<Float>(in, out, job);
+    case TpDouble:
+        return scalar ? copyScalar<Double>(in, out, job)
+                      : copyArray<Double>(in, out, job);
+    case TpComplex:
+        return scalar ? copyScalar<Complex>(in, out, job)
+                      : copyArray<Complex>(in, out, job);
+    case TpDComplex:
+        return scalar ? copyScalar<DComplex>(in, out, job)
+                      : copyArray<DComplex>(in, out, job);
+    case TpString:
+        return scalar ? copyScalar<String>(in, out, job)
+                      : copyArray<String>(in, out, job);
+    default:
+        throw(std::runtime_error("unsupported data type"));
+    }
+}
+
+// Shape shared by all cells of an array column without a fixed shape, or
+// an empty shape if they differ in shape, some are undefined, or there are
+// no rows.
+IPosition commonShape(const Table &aTable, const String &aName)
+{
+    TableColumn column(aTable, aName);
+    IPosition shape;
+    for (rownr_t row = 0; row < aTable.nrow(); ++row)
+    {
+        if (!column.isDefined(row))
+        {
+            return IPosition();
+        }
+        IPosition cell = column.shape(row);
+        if (row > 0 && !cell.isEqual(shape))
+        {
+            return IPosition();
+        }
+        shape = cell;
+    }
+    return shape;
+}
+
+std::vector<String> splitList(const std::string &aList)
+{
+    std::vector<String> items;
+    std::stringstream ss(aList);
+    std::string item;
+    while (std::getline(ss, item, ','))
+    {
+        if (!item.empty())
+        {
+            items.push_back(item);
+        }
+    }
+    return items;
+}
+
+// Removes the converted columns from the source table's data manager info,
+// dropping data managers that are left without columns.
+Record keepOriginalManagers(const Record &aDmInfo,
+                            const std::set<String> &aConverted)
+{
+    Record dmInfo;
+    for (uInt i = 0; i < aDmInfo.nfields(); ++i)
+    {
+        Record dm = aDmInfo.subRecord(Int(i));
+        Vector<String> columns(dm.asArrayString("COLUMNS"));
+        std::vector<String> kept;
+        for (uInt j = 0; j < columns.nelements(); ++j)
+        {
+            if (aConverted.count(columns[j]) == 0)
+            {
+                kept.push_back(columns[j]);
+            }
+        }
+        if (kept.empty())
+        {
+            continue;
+        }
+        dm.define("COLUMNS", Vector<String>(kept));
+        dmInfo.defineRecord(aDmInfo.name(Int(i)), dm);
+    }
+    return dmInfo;
+}
+
+void usage()
+{
+    std::cerr << "Usage: adios2convert [-c col1,col2,...] [-k key1,key2,...] "
+                 "[-t threads] [-r rowsPerChunk] [-e engineType] "
+                 "[-p key=value]... input.table output.table"
+              << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    int mpiRank = 0, mpiSize = 1;
+#ifdef HAVE_MPI
+    MPI_Init(&argc, &argv);
+    MPI_Comm_rank(MPI_COMM_WORLD, &mpiRank);
+    MPI_Comm_size(MPI_COMM_WORLD, &mpiSize);
+#endif
+
+    std::set<String> selected;
+    std::string keyList;
+    unsigned int nrThreads = std::thread::hardware_concurrency();
+    std::string engineType;
+    std::map<std::string, std::string> engineParams;
+    int opt;
+    while ((opt = getopt(argc, argv, "c:k:t:r:e:p:")) != -1)
+    {
+        switch (opt)
+        {
+        case 'c':
+        {
+            std::vector<String> columns = splitList(optarg);
+            selected = std::set<String>(columns.begin(), columns.end());
+            break;
+        }
+        case 'k':
+            keyList = optarg;
+            break;
+        case 't':
+            nrThreads = std::stoul(optarg);
+            break;
+        case 'r':
+            rowsPerChunk = std::stoull(optarg);
+            break;
+        case 'e':
+            engineType = optarg;
+            break;
+        case 'p':
+        {
+            std::string param = optarg;
+            size_t eq = param.find('=');
+            if (eq == std::string::npos)
+            {
+                usage();
+                return 1;
+            }
+            engineParams[param.substr(0, eq)] = param.substr(eq + 1);
+            break;
+        }
+        default:
+            usage();
+            return 1;
+        }
+    }
+    if (argc - optind != 2)
+    {
+        usage();
+        return 1;
+    }
+    std::string inName = argv[optind];
+    std::string outName = argv[optind + 1];
+
+    Table in(inName);
+    TableDesc td = in.actualTableDesc();
+    Vector<String> names = td.columnNames();
+    rownr_t nrRows = in.nrow();
+    if (!keyList.empty())
+    {
+        std::vector<std::vector<Int64>> keys;
+        for (auto &key : splitList(keyList))
+        {
+            Vector<Int> values = ScalarColumn<Int>(in, key).getColumn();
+            keys.emplace_back(values.begin(), values.end());
+        }
+        rowOrder = Adios2StMan::sortedRowOrder(keys);
+    }
+
+    // Adios2StMan stores fixed shape numeric columns; strings and arrays
+    // whose cells differ in shape stay where they are
+    std::set<String> converted;
+    std::vector<String> kept, failedColumns;
+    for (uInt i = 0; i < names.nelements(); ++i)
+    {
+        if (!selected.empty() && selected.count(names[i]) == 0)
+        {
+            continue;
+        }
+        const ColumnDesc &desc = td.columnDesc(names[i]);
+        std::string reason;
+        if (desc.dataType() == TpString)
+        {
+            reason = "String columns cannot be stored as ADIOS arrays";
+        }
+        else if (desc.isArray() &&
+                 !(desc.options() & ColumnDesc::FixedShape))
+        {
+            IPosition shape = commonShape(in, names[i]);
+            if (shape.empty())
+            {
+                reason = "its cells do not share one shape";
+            }
+            else
+            {
+                td.rwColumnDesc(names[i]).setShape(shape);
+            }
+        }
+        if (reason.empty())
+        {
+            converted.insert(names[i]);
+            continue;
+        }
+        if (mpiRank == 0)
+        {
+            std::cerr << "adios2convert: keeping column " << names[i]
+                      << " on its storage manager, " << reason << std::endl;
+        }
+        kept.push_back(names[i]);
+        if (!selected.empty())
+        {
+            failedColumns.push_back(names[i]);
+        }
+    }
+
+    // hypercolumns of tiled storage managers can only be kept if some of
+    // their data columns stay with them
+    Vector<String> hypercolumns = td.hypercolumnNames();
+    for (uInt i = 0; i < hypercolumns.nelements(); ++i)
+    {
+        Vector<String> dataNames, coordNames, idNames;
+        td.hypercolumnDesc(hypercolumns[i], dataNames, coordNames, idNames);
+        bool allConverted = true;
+        for (uInt j = 0; j < dataNames.nelements(); ++j)
+        {
+            allConverted = allConverted && converted.count(dataNames[j]) > 0;
+        }
+        if (allConverted || mpiRank > 0)
+        {
+            td.removeHypercolumnDesc(hypercolumns[i]);
+        }
+    }
+    if (mpiRank > 0)
+    {
+        // the other ranks only write the Adios2StMan columns, and their
+        // table files are scratch copies, so the columns staying with
+        // other storage managers are left out of them
+        for (uInt i = 0; i < names.nelements(); ++i)
+        {
+            if (converted.count(names[i]) == 0)
+            {
+                td.removeColumn(names[i]);
+            }
+        }
+    }
+
+    register_adios2stman();
+#ifdef HAVE_MPI
+    Adios2StMan stman(MPI_COMM_WORLD, engineType, engineParams, {});
+#else
+    Adios2StMan stman(engineType, engineParams, {});
+#endif
+    SetupNewTable newtab(outName, td, Table::New);
+    if (mpiRank == 0)
+    {
+        newtab.bindCreate(
+            keepOriginalManagers(in.dataManagerInfo(), converted));
+    }
+    for (auto &name : converted)
+    {
+        newtab.bindColumn(name, stman);
+    }
+#ifdef HAVE_MPI
+    Table out(MPI_COMM_WORLD, newtab, nrRows);
+#else
+    Table out(newtab, nrRows);
+#endif
+    inLocks.init(in.dataManagerInfo());
+    outLocks.init(out.dataManagerInfo());
+    if (!rowOrder.empty() && !converted.empty())
+    {
+        // the data manager of the table is a copy of stman
+        dynamic_cast<Adios2StMan *>(
+            out.findDataManager(stman.dataManagerName()))
+            ->setRowOrder(rowOrder, keyList);
+    }
+
+    // stored rows of the Adios2StMan columns are partitioned over the ranks
+    rownr_t rowStart = nrRows * mpiRank / mpiSize;
+    rownr_t rowEnd = nrRows * (mpiRank + 1) / mpiSize;
+    std::vector<ColumnJob> jobs;
+    for (uInt i = 0; i < names.nelements(); ++i)
+    {
+        bool toAdios = converted.count(names[i]) > 0;
+        if (toAdios)
+        {
+            jobs.push_back({names[i], true, rowStart, rowEnd - rowStart});
+        }
+        else if (mpiRank == 0)
+        {
+            jobs.push_back({names[i], false, 0, nrRows});
+        }
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    std::mutex jobMutex;
+    size_t nextJob = 0;
+    uint64_t bytes = 0;
+    std::vector<std::thread> workers;
+    nrThreads = std::max(1u, std::min<unsigned int>(nrThreads, jobs.size()));
+    for (unsigned int t = 0; t < nrThreads; ++t)
+    {
+        workers.emplace_back([&]() {
+            for (;;)
+            {
+                size_t j;
+                {
+                    std::lock_guard<std::mutex> lock(jobMutex);
+                    if (nextJob == jobs.size())
+                    {
+                        return;
+                    }
+                    j = nextJob++;
+                }
+                uint64_t jobBytes = 0;
+                try
+                {
+                    jobBytes = copyColumn(in, out, jobs[j]);
+                }
+                catch (std::exception &e)
+                {
+                    std::cerr << "adios2convert: column " << jobs[j].name
+                              << ": " << e.what() << std::endl;
+                    std::lock_guard<std::mutex> lock(jobMutex);
+                    failedColumns.push_back(jobs[j].name);
+                }
+                std::lock_guard<std::mutex> lock(jobMutex);
+                bytes += jobBytes;
+            }
+        });
+    }
+    for (auto &w : workers)
+    {
+        w.join();
+    }
+    out = Table();
+    double seconds = std::chrono::duration<double>(
+                         std::chrono::steady_clock::now() - start)
+                         .count();
+
+    unsigned long long totalBytes = bytes;
+    int failed = failedColumns.empty() ? 0 : 1;
+    if (failed)
+    {
+        std::ostringstream list;
+        for (size_t i = 0; i < failedColumns.size(); ++i)
+        {
+            list << (i ? ", " : "") << failedColumns[i];
+        }
+        std::cerr << "adios2convert: rank " << mpiRank
+                  << " failed to convert columns " << list.str()
+                  << std::endl;
+    }
+#ifdef HAVE_MPI
+    MPI_Allreduce(MPI_IN_PLACE, &totalBytes, 1, MPI_UNSIGNED_LONG_LONG,
+                  MPI_SUM, MPI_COMM_WORLD);
+    MPI_Allreduce(MPI_IN_PLACE, &seconds, 1, MPI_DOUBLE, MPI_MAX,
+                  MPI_COMM_WORLD);
+    MPI_Allreduce(MPI_IN_PLACE, &failed, 1, MPI_INT, MPI_MAX, MPI_COMM_WORLD);
+#endif
+    if (mpiRank == 0)
+    {
+        std::cout << "adios2convert: " << converted.size() << " of "
+                  << names.nelements() << " columns to Adios2StMan, "
+                  << nrRows << " rows, " << totalBytes / 1048576.0
+                  << " MB in " << seconds << " s, "
+                  << totalBytes / 1048576.0 / seconds << " MB/s with "
+                  << mpiSize << " rank(s) x " << nrThreads << " thread(s)"
+                  << std::endl;
+        if (!kept.empty())
+        {
+            std::cout << "adios2convert: kept on their storage managers:";
+            for (auto &name : kept)
+            {
+                std::cout << ' ' << name;
+            }
+            std::cout << std::endl;
+        }
+        if (failed)
+        {
+            std::cerr << "adios2convert: some columns could not be converted"
+                      << std::endl;
+        }
+    }
+
+#ifdef HAVE_MPI
+    MPI_Finalize();
+#endif
+    return failed ? 1 : 0;
+}
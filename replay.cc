@@ -0,0 +1,669 @@
+//    (c) Oak Ridge National Laboratory
+//    1 Bethel Valley Road, Oak Ridge, TN 37830, United States
+//
+//    This library is free software: you can redistribute it and/or
+//    modify it under the terms of the GNU General Public License as published
+//    by the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License along
+//    with this library. If not, see <http://www.gnu.org/licenses/>.
+//
+//    Any bugs, questions, concerns and/or suggestions please email to
+//    wangr1@ornl.gov or jason.ruonan.wang@gmail.com
+
+// ################################################################################
+// adios2replay re-executes an access log written by Adios2StMan (spec field
+// ACCESSLOG) under other storage manager settings, to tune them for the
+// access pattern of a pipeline without rerunning it. For every setting in
+// the grid, the columns named in the log are copied from the input table
+// into a scratch table stored with Adios2StMan under that setting, and the
+// logged gets and puts are replayed on the reopened scratch table. Puts put
+// the values of the input table at the same cells, which are read outside
+// the timed part.
+//
+// Each -g option adds an axis to the grid, and every combination of the
+// values of all axes is replayed. Keys are
+//   engine                  engine type, e.g. -g engine=BP4,BP5
+//   engine.<Parameter>      engine parameter, e.g. -g engine.NumAggregators=1,4
+//   transport.<Parameter>   parameter of the file transport
+//   stman.<FIELD>           READTHREADS, MEMORYBUDGET, RESIDENTBYTES,
+//                           HUGEPAGES, COMPRESSION or COMPRESSIONTARGET
+// A session, from opening the scratch table to closing it, is timed
+// -n times, with the scratch table rebuilt before each session if the log
+// has puts. One CSV line per setting reports the bytes moved and the
+// minimum and mean session time, and a last comment line names the
+// fastest setting. Replays run serially, so the log of a single rank is
+// replayed at a time.
+//
+// A log shared by several tables holds the accesses of each under its
+// table path. Only the accesses of one table are replayed: the one named
+// by -t, else the input table if it was logged, else the only table of
+// the log.
+//
+// Usage:
+//   adios2replay [-g key=value,...]... [-n repeats] [-o scratch.table]
+//                [-t logged.table] access.log input.table
+
+#include "Adios2StMan.h"
+#include <casacore/tables/Tables/ArrayColumn.h>
+#include <casacore/tables/Tables/ScalarColumn.h>
+#include <casacore/tables/Tables/SetupNewTab.h>
+#include <casacore/tables/Tables/TableColumn.h>
+#include <casacore/tables/Tables/TableDesc.h>
+#include <casacore/casa/namespace.h>
+#ifdef HAVE_MPI
+#include <mpi.h>
+#endif
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <limits>
+#include <set>
+#include <sstream>
+#include <unistd.h>
+
+namespace
+{
+
+typedef Adios2StManAccessLog::Access Access;
+typedef std::vector<std::pair<std::string, std::string>> Setting;
+
+const uint64_t copyChunkBytes = 64 << 20;
+
+// Time of the storage manager calls of a session. The reads of the values
+// to put are left out.
+struct Session
+{
+    double seconds = 0;
+    uint64_t bytes = 0;
+    std::chrono::steady_clock::time_point start;
+    void begin() { start = std::chrono::steady_clock::now(); }
+    void end()
+    {
+        seconds += std::chrono::duration<double>(
+                       std::chrono::steady_clock::now() - start)
+                       .count();
+    }
+};
+
+std::vector<std::string> splitList(const std::string &aList)
+{
+    std::vector<std::string> items;
+    std::stringstream ss(aList);
+    std::string item;
+    while (std::getline(ss, item, ','))
+    {
+        if (!item.empty())
+        {
+            items.push_back(item);
+        }
+    }
+    return items;
+}
+
+std::string settingName(const Setting &aSetting)
+{
+    std::string name;
+    for (auto &value : aSetting)
+    {
+        name += (name.empty() ? "" : ";") + value.first + "=" + value.second;
+    }
+    return name.empty() ? "default" : name;
+}
+
+// Applies the stman.<FIELD> values of aSetting to a storage manager.
+void configure(Adios2StMan &aStMan, const Setting &aSetting)
+{
+    for (auto &value : aSetting)
+    {
+        if (value.first.compare(0, 6, "stman.") != 0)
+        {
+            continue;
+        }
+        std::string field = value.first.substr(6);
+        if (field == "READTHREADS")
+        {
+            aStMan.setReadThreads(std::stoul(value.second));
+        }
+        else if (field == "MEMORYBUDGET")
+        {
+            aStMan.setMemoryBudget(std::stoull(value.second));
+        }
+        else if (field == "RESIDENTBYTES")
+        {
+            aStMan.setResidentBytes(std::stoull(value.second));
+        }
+        else if (field == "HUGEPAGES")
+        {
+            aStMan.setHugePages(value.second == "1" || value.second == "true");
+        }
+        else if (field == "COMPRESSION")
+        {
+            aStMan.setCompression(value.second);
+        }
+        else if (field == "COMPRESSIONTARGET")
+        {
+            aStMan.setCompressionTarget(std::stod(value.second));
+        }
+        else
+        {
+            throw(std::runtime_error("adios2replay: unknown setting " +
+                                     value.first));
+        }
+    }
+}
+
+RefRows refRows(const Access &aAccess)
+{
+    if (aAccess.rows.size() == 1)
+    {
+        return RefRows(aAccess.rows[0].first,
+                       aAccess.rows[0].first + aAccess.rows[0].second - 1);
+    }
+    std::vector<rownr_t> rows;
+    for (auto &range : aAccess.rows)
+    {
+        for (uint64_t i = 0; i < range.second; ++i)
+        {
+            rows.push_back(range.first + i);
+        }
+    }
+    return RefRows(Vector<rownr_t>(rows));
+}
+
+Slicer slicer(const Access &aAccess)
+{
+    size_t ndim = aAccess.start.size();
+    IPosition start(ndim), length(ndim), stride(ndim);
+    for (size_t i = 0; i < ndim; ++i)
+    {
+        start[i] = aAccess.start[i];
+        length[i] = aAccess.length[i];
+        stride[i] = aAccess.stride[i];
+    }
+    return Slicer(start, length, stride, Slicer::endIsLength);
+}
+
+template <class T>
+void replayScalar(const Table &in, Table &out, const Access &aAccess,
+                  Session &aSession)
+{
+    ScalarColumn<T> inCol(in, aAccess.column);
+    ScalarColumn<T> outCol(out, aAccess.column);
+    if (aAccess.kind == 'c')
+    {
+        T value;
+        for (auto &range : aAccess.rows)
+        {
+            for (rownr_t row = range.first; row < range.first + range.second;
+                 ++row)
+            {
+                if (aAccess.put)
+                {
+                    inCol.get(row, value);
+                }
+                aSession.begin();
+                if (aAccess.put)
+                {
+                    outCol.put(row, value);
+                }
+                else
+                {
+                    outCol.get(row, value);
+                }
+                aSession.end();
+            }
+            aSession.bytes += range.second * sizeof(T);
+        }
+        return;
+    }
+    Vector<T> values;
+    RefRows rows = aAccess.kind == 'r' ? refRows(aAccess) : RefRows(0, 0);
+    if (aAccess.put)
+    {
+        if (aAccess.kind == 'r')
+        {
+            inCol.getColumnCells(rows, values, True);
+        }
+        else
+        {
+            values = inCol.getColumn();
+        }
+    }
+    aSession.begin();
+    if (aAccess.put && aAccess.kind == 'r')
+    {
+        outCol.putColumnCells(rows, values);
+    }
+    else if (aAccess.put)
+    {
+        outCol.putColumn(values);
+    }
+    else if (aAccess.kind == 'r')
+    {
+        outCol.getColumnCells(rows, values, True);
+    }
+    else
+    {
+        outCol.getColumn(values, True);
+    }
+    aSession.end();
+    aSession.bytes += values.nelements() * sizeof(T);
+}
+
+template <class T>
+void replayArray(const Table &in, Table &out, const Access &aAccess,
+                 Session &aSession)
+{
+    ArrayColumn<T> inCol(in, aAccess.column);
+    ArrayColumn<T> outCol(out, aAccess.column);
+    bool sliced = !aAccess.start.empty();
+    Slicer ns = sliced ? slicer(aAccess) : Slicer();
+    Array<T> values;
+    if (aAccess.kind == 'c')
+    {
+        for (auto &range : aAccess.rows)
+        {
+            for (rownr_t row = range.first; row < range.first + range.second;
+                 ++row)
+            {
+                if (aAccess.put)
+                {
+                    inCol.get(row, values, True);
+                }
+                aSession.begin();
+                if (aAccess.put)
+                {
+                    outCol.put(row, values);
+                }
+                else if (sliced)
+                {
+                    outCol.getSlice(row, ns, values, True);
+                }
+                else
+                {
+                    outCol.get(row, values, True);
+                }
+                aSession.end();
+                aSession.bytes += values.nelements() * sizeof(T);
+            }
+        }
+        return;
+    }
+    RefRows rows = aAccess.kind == 'r' ? refRows(aAccess) : RefRows(0, 0);
+    if (aAccess.put)
+    {
+        if (aAccess.kind == 'r')
+        {
+            inCol.getColumnCells(rows, values, True);
+        }
+        else
+        {
+            inCol.getColumn(values, True);
+        }
+    }
+    aSession.begin();
+    if (aAccess.put && aAccess.kind == 'r')
+    {
+        outCol.putColumnCells(rows, values);
+    }
+    else if (aAccess.put)
+    {
+        outCol.putColumn(values);
+    }
+    else if (aAccess.kind == 'r' && sliced)
+    {
+        outCol.getColumnCells(rows, ns, values, True);
+    }
+    else if (aAccess.kind == 'r')
+    {
+        outCol.getColumnCells(rows, values, True);
+    }
+    else if (sliced)
+    {
+        outCol.getColumn(ns, values, True);
+    }
+    else
+    {
+        outCol.getColumn(values, True);
+    }
+    aSession.end();
+    aSession.bytes += values.nelements() * sizeof(T);
+}
+
+template <class T>
+void copyColumn(const Table &in, Table &out, const String &aName)
+{
+    rownr_t nrRows = in.nrow();
+    if (nrRows == 0)
+    {
+        return;
+    }
+    if (in.tableDesc().columnDesc(aName).isScalar())
+    {
+        ScalarColumn<T> inCol(in, aName), outCol(out, aName);
+        rownr_t step = std::max<uint64_t>(1, copyChunkBytes / sizeof(T));
+        Vector<T> values;
+        for (rownr_t row = 0; row < nrRows; row += step)
+        {
+            RefRows rows(row, std::min(row + step, nrRows) - 1);
+            inCol.getColumnCells(rows, values, True);
+            outCol.putColumnCells(rows, values);
+        }
+        return;
+    }
+    ArrayColumn<T> inCol(in, aName), outCol(out, aName);
+    uint64_t rowBytes = inCol.shape(0).product() * sizeof(T);
+    rownr_t step =
+        std::max<uint64_t>(1, copyChunkBytes / std::max<uint64_t>(1, rowBytes));
+    Array<T> values;
+    for (rownr_t row = 0; row < nrRows; row += step)
+    {
+        RefRows rows(row, std::min(row + step, nrRows) - 1);
+        inCol.getColumnCells(rows, values, True);
+        outCol.putColumnCells(rows, values);
+    }
+}
+
+#define ADIOS2REPLAY_DISPATCH(aFunc, aDataType, ...)                         \
+    switch (aDataType)                                                       \
+    {                                                                        \
+    case TpBool: aFunc<Bool>(__VA_ARGS__); break;                            \
+    case TpUChar: aFunc<uChar>(__VA_ARGS__); break;                          \
+    case TpShort: aFunc<Short>(__VA_ARGS__); break;                          \
+    case TpUShort: aFunc<uShort>(__VA_ARGS__); break;                        \
+    case TpInt: aFunc<Int>(__VA_ARGS__); break;                              \
+    case TpUInt: aFunc<uInt>(__VA_ARGS__); break;                            \
+    case TpFloat: aFunc<Float>(__VA_ARGS__); break;                          \
+    case TpDouble: aFunc<Double>(__VA_ARGS__); break;                        \
+    case TpComplex: aFunc<Complex>(__VA_ARGS__); break;                      \
+    case TpDComplex: aFunc<DComplex>(__VA_ARGS__); break;                    \
+    default:                                                                 \
+        throw(std::runtime_error("adios2replay: column of unsupported type")); \
+    }
+
+// Copies aColumns of the input table into a new scratch table stored with
+// Adios2StMan under aSetting.
+void createScratch(const Table &in, const std::set<String> &aColumns,
+                   const Setting &aSetting, const std::string &aScratch)
+{
+    std::string engineType;
+    std::map<std::string, std::string> engineParams;
+    std::map<std::string, std::string> transportParams;
+    for (auto &value : aSetting)
+    {
+        if (value.first == "engine")
+        {
+            engineType = value.second;
+        }
+        else if (value.first.compare(0, 7, "engine.") == 0)
+        {
+            engineParams[value.first.substr(7)] = value.second;
+        }
+        else if (value.first.compare(0, 10, "transport.") == 0)
+        {
+            transportParams[value.first.substr(10)] = value.second;
+        }
+        else if (value.first.compare(0, 6, "stman.") != 0)
+        {
+            throw(std::runtime_error("adios2replay: unknown setting " +
+                                     value.first));
+        }
+    }
+    std::vector<std::map<std::string, std::string>> transports;
+    if (!transportParams.empty())
+    {
+        transports.push_back(transportParams);
+    }
+    // also sets the engine of the storage managers of tables opened later
+    Adios2StMan stman(engineType, engineParams, transports);
+
+    TableDesc inDesc = in.actualTableDesc();
+    TableDesc td;
+    for (auto &name : aColumns)
+    {
+        td.addColumn(inDesc.columnDesc(name));
+        ColumnDesc &desc = td.rwColumnDesc(name);
+        if (desc.isArray() && !(desc.options() & ColumnDesc::FixedShape))
+        {
+            desc.setShape(TableColumn(in, name).shape(0));
+        }
+    }
+    // the table gets a copy of stman made from its spec, so the settings
+    // are in place when its columns are created
+    configure(stman, aSetting);
+    SetupNewTable newtab(aScratch, td, Table::New);
+    newtab.bindAll(stman);
+    Table out(newtab, in.nrow());
+    for (auto &name : aColumns)
+    {
+        ADIOS2REPLAY_DISPATCH(copyColumn, td.columnDesc(name).dataType(), in,
+                              out, name);
+    }
+}
+
+// Replays aAccesses on the scratch table and returns the session.
+Session replay(const Table &in, const std::vector<Access> &aAccesses,
+               bool aHasPuts, const Setting &aSetting,
+               const std::string &aScratch)
+{
+    Session session;
+    session.begin();
+    Table out(aScratch, aHasPuts ? Table::Update : Table::Old);
+    // a table is opened without a spec, so the settings are applied before
+    // its first access
+    Adios2StMan *stman =
+        dynamic_cast<Adios2StMan *>(out.findDataManager("Adios2StMan"));
+    configure(*stman, aSetting);
+    session.end();
+    for (auto &access : aAccesses)
+    {
+        const ColumnDesc &desc = in.tableDesc().columnDesc(access.column);
+        if (desc.isScalar())
+        {
+            ADIOS2REPLAY_DISPATCH(replayScalar, desc.dataType(), in, out,
+                                  access, session);
+        }
+        else
+        {
+            ADIOS2REPLAY_DISPATCH(replayArray, desc.dataType(), in, out,
+                                  access, session);
+        }
+    }
+    session.begin();
+    out = Table();
+    session.end();
+    return session;
+}
+
+void usage()
+{
+    std::cerr << "Usage: adios2replay [-g key=value,...]... [-n repeats] "
+                 "[-o scratch.table] [-t logged.table] access.log "
+                 "input.table"
+              << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+#ifdef HAVE_MPI
+    MPI_Init(&argc, &argv);
+#endif
+
+    std::vector<std::pair<std::string, std::vector<std::string>>> grid;
+    int repeats = 3;
+    std::string scratch = "adios2replay.table";
+    std::string logged;
+    int opt;
+    while ((opt = getopt(argc, argv, "g:n:o:t:")) != -1)
+    {
+        switch (opt)
+        {
+        case 'g':
+        {
+            std::string axis = optarg;
+            size_t eq = axis.find('=');
+            if (eq == std::string::npos)
+            {
+                usage();
+                return 1;
+            }
+            grid.emplace_back(axis.substr(0, eq),
+                              splitList(axis.substr(eq + 1)));
+            break;
+        }
+        case 'n':
+            repeats = std::max(1, std::stoi(optarg));
+            break;
+        case 'o':
+            scratch = optarg;
+            break;
+        case 't':
+            logged = optarg;
+            break;
+        default:
+            usage();
+            return 1;
+        }
+    }
+    if (argc - optind != 2)
+    {
+        usage();
+        return 1;
+    }
+
+    std::vector<Access> logAccesses = Adios2StManAccessLog::load(argv[optind]);
+    Table in(argv[optind + 1]);
+    std::set<std::string> tables;
+    for (auto &access : logAccesses)
+    {
+        tables.insert(access.table);
+    }
+    if (logged.empty())
+    {
+        std::string input = Adios2StMan::absolutePath(in.tableName());
+        if (tables.count(input))
+        {
+            logged = input;
+        }
+        else if (tables.size() == 1)
+        {
+            logged = *tables.begin();
+        }
+        else
+        {
+            std::cerr << "adios2replay: the log has the accesses of "
+                      << tables.size() << " tables, choose one with -t:"
+                      << std::endl;
+            for (auto &table : tables)
+            {
+                std::cerr << "  " << table << std::endl;
+            }
+            return 1;
+        }
+    }
+    else
+    {
+        logged = Adios2StMan::absolutePath(logged);
+    }
+    std::vector<Access> accesses;
+    std::set<String> columns;
+    bool hasPuts = false;
+    for (auto &access : logAccesses)
+    {
+        if (access.table != logged)
+        {
+            continue;
+        }
+        accesses.push_back(access);
+        columns.insert(access.column);
+        hasPuts = hasPuts || access.put;
+    }
+    if (accesses.empty())
+    {
+        std::cerr << "adios2replay: no accesses of " << logged << " in "
+                  << argv[optind] << std::endl;
+        return 1;
+    }
+
+    // every combination of the values of the axes, the first axis slowest
+    std::vector<Setting> settings(1);
+    for (auto &axis : grid)
+    {
+        std::vector<Setting> product;
+        for (auto &setting : settings)
+        {
+            for (auto &value : axis.second)
+            {
+                product.push_back(setting);
+                product.back().emplace_back(axis.first, value);
+            }
+        }
+        settings.swap(product);
+    }
+
+    register_adios2stman();
+    std::cout << "setting,repeats,bytes,min_s,mean_s,mb_per_s" << std::endl;
+    std::string fastest;
+    double fastestSeconds = std::numeric_limits<double>::max();
+    for (auto &setting : settings)
+    {
+        double minSeconds = std::numeric_limits<double>::max();
+        double totalSeconds = 0;
+        uint64_t bytes = 0;
+        try
+        {
+            for (int r = 0; r < repeats; ++r)
+            {
+                if (r == 0 || hasPuts)
+                {
+                    createScratch(in, columns, setting, scratch);
+                }
+                Session session = replay(in, accesses, hasPuts, setting,
+                                         scratch);
+                minSeconds = std::min(minSeconds, session.seconds);
+                totalSeconds += session.seconds;
+                bytes = session.bytes;
+            }
+        }
+        catch (std::exception &e)
+        {
+            std::cerr << "adios2replay: " << settingName(setting) << ": "
+                      << e.what() << std::endl;
+            continue;
+        }
+        std::cout << '"' << settingName(setting) << "\"," << repeats << ','
+                  << bytes << ',' << minSeconds << ','
+                  << totalSeconds / repeats << ','
+                  << bytes / 1048576.0 / minSeconds << std::endl;
+        if (minSeconds < fastestSeconds)
+        {
+            fastestSeconds = minSeconds;
+            fastest = settingName(setting);
+        }
+    }
+    // no scratch table is left if every setting failed before creating it
+    if (Table::isReadable(scratch))
+    {
+        Table::deleteTable(scratch, True);
+    }
+    if (!fastest.empty())
+    {
+        std::cout << "# fastest: " << fastest << " (" << fastestSeconds
+                  << " s)" << std::endl;
+    }
+
+#ifdef HAVE_MPI
+    MPI_Finalize();
+#endif
+    return 0;
+}
@@ -0,0 +1,436 @@
+//    (c) Oak Ridge National Laboratory
+//    1 Bethel Valley Road, Oak Ridge, TN 37830, United States
+//
+//    This library is free software: you can redistribute it and/or
+//    modify it under the terms of the GNU General Public License as published
+//    by the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License along
+//    with this library. If not, see <http://www.gnu.org/licenses/>.
+//
+//    Any bugs, questions, concerns and/or suggestions please email to
+//    wangr1@ornl.gov or jason.ruonan.wang@gmail.com
+
+// ################################################################################
+// bench runs weak and strong scaling sweeps of Adios2StMan. For every
+// combination of scaling mode, number of ranks, rows, cell shape, number of
+// columns and engine, a table of Complex array columns is written by the
+// ranks into one ADIOS container, each rank putting its own contiguous
+// share of the rows, and then read back by the same ranks in full, as a
+// slice of every cell (the first quarter of the last cell axis) and as
+// every 4th row through RefRows.
+//
+// Rows are per rank in weak scaling and in total in strong scaling. Sweeps
+// over ranks run on the first n ranks of MPI_COMM_WORLD while the others
+// wait, so one launch covers every rank count up to its size, and ranks may
+// be oversubscribed on a single machine:
+//   mpirun --oversubscribe -np 8 ./bench -n 1,2,4,8 -o bench.csv
+//
+// Every operation is timed on every rank from a barrier to its end,
+// including opening and closing the table, and reported as one CSV line
+// with the minimum, maximum and mean over the ranks, the imbalance
+// (maximum over mean) and the throughput (total bytes over maximum time).
+//
+// Usage:
+//   bench [-m weak,strong] [-n ranks,...] [-r rows,...] [-s shape,...]
+//         [-c columns,...] [-e engine,...] [-p key=value]... [-k chunkRows]
+//         [-i repeats] [-d directory] [-o file.csv]
+// Shapes are given as e.g. 4x64 (4 correlations by 64 channels); the engine
+// "default" leaves the engine type unset.
+
+#include "../Adios2StMan.h"
+#include <casacore/tables/Tables/ArrColDesc.h>
+#include <casacore/tables/Tables/ArrayColumn.h>
+#include <casacore/tables/Tables/SetupNewTab.h>
+#include <casacore/tables/Tables/TableDesc.h>
+#include <casacore/casa/namespace.h>
+#include <mpi.h>
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <unistd.h>
+
+namespace
+{
+
+struct Config
+{
+    std::string mode;
+    int ranks;
+    rownr_t rowsPerRank;
+    IPosition shape;
+    int columns;
+    std::string engine;
+};
+
+std::map<std::string, std::string> engineParams;
+rownr_t chunkRows = 1024;
+const rownr_t refRowsStride = 4;
+
+std::vector<std::string> splitList(const std::string &aList)
+{
+    std::vector<std::string> items;
+    std::stringstream ss(aList);
+    std::string item;
+    while (std::getline(ss, item, ','))
+    {
+        if (!item.empty())
+        {
+            items.push_back(item);
+        }
+    }
+    return items;
+}
+
+std::vector<uint64_t> splitNumbers(const std::string &aList)
+{
+    std::vector<uint64_t> numbers;
+    for (auto &item : splitList(aList))
+    {
+        numbers.push_back(std::stoull(item));
+    }
+    return numbers;
+}
+
+IPosition parseShape(const std::string &aShape)
+{
+    std::vector<uint64_t> dims;
+    std::stringstream ss(aShape);
+    std::string dim;
+    while (std::getline(ss, dim, 'x'))
+    {
+        dims.push_back(std::stoull(dim));
+    }
+    IPosition shape(dims.size());
+    for (size_t i = 0; i < dims.size(); ++i)
+    {
+        shape[i] = dims[i];
+    }
+    return shape;
+}
+
+std::string shapeName(const IPosition &aShape)
+{
+    std::string name;
+    for (size_t i = 0; i < aShape.size(); ++i)
+    {
+        name += (i > 0 ? "x" : "") + std::to_string(aShape[i]);
+    }
+    return name;
+}
+
+String columnName(int aColumn) { return "DATA" + std::to_string(aColumn); }
+
+// slice of every cell read by the sliced read
+Slicer cellSlicer(const IPosition &aShape)
+{
+    IPosition length(aShape);
+    size_t last = aShape.size() - 1;
+    length[last] = (aShape[last] >= 4) ? aShape[last] / 4 : 1;
+    return Slicer(IPosition(aShape.size(), 0), length);
+}
+
+// Runs aOp on every rank of aComm from a barrier and returns its time.
+template <class F>
+double timeOp(MPI_Comm aComm, F aOp)
+{
+    MPI_Barrier(aComm);
+    double start = MPI_Wtime();
+    aOp();
+    return MPI_Wtime() - start;
+}
+
+void report(MPI_Comm aComm, std::ostream &aCsv, const Config &aConfig,
+            const char *aOp, int aRepeat, double aSeconds, uint64_t aBytes)
+{
+    int rank, size;
+    MPI_Comm_rank(aComm, &rank);
+    MPI_Comm_size(aComm, &size);
+    double minSeconds, maxSeconds, sumSeconds;
+    unsigned long long bytes = aBytes;
+    unsigned long long totalBytes;
+    MPI_Reduce(&aSeconds, &minSeconds, 1, MPI_DOUBLE, MPI_MIN, 0, aComm);
+    MPI_Reduce(&aSeconds, &maxSeconds, 1, MPI_DOUBLE, MPI_MAX, 0, aComm);
+    MPI_Reduce(&aSeconds, &sumSeconds, 1, MPI_DOUBLE, MPI_SUM, 0, aComm);
+    MPI_Reduce(&bytes, &totalBytes, 1, MPI_UNSIGNED_LONG_LONG, MPI_SUM, 0,
+               aComm);
+    if (rank != 0)
+    {
+        return;
+    }
+    double meanSeconds = sumSeconds / size;
+    aCsv << aConfig.mode << "," << aConfig.ranks << ","
+         << aConfig.rowsPerRank << "," << aConfig.rowsPerRank * aConfig.ranks
+         << "," << shapeName(aConfig.shape) << "," << aConfig.columns << ","
+         << aConfig.engine << "," << aOp << "," << aRepeat << ","
+         << totalBytes << "," << minSeconds << "," << maxSeconds << ","
+         << meanSeconds << ","
+         << (meanSeconds > 0 ? maxSeconds / meanSeconds : 1.0) << ","
+         << (maxSeconds > 0 ? totalBytes / 1e6 / maxSeconds : 0.0)
+         << std::endl;
+}
+
+uint64_t writeTable(MPI_Comm aComm, const Config &aConfig,
+                    const std::string &aName, rownr_t aRowStart)
+{
+    std::string engine = (aConfig.engine == "default") ? "" : aConfig.engine;
+    Adios2StMan stman(aComm, engine, engineParams, {});
+    TableDesc td("", "1", TableDesc::Scratch);
+    for (int c = 0; c < aConfig.columns; ++c)
+    {
+        td.addColumn(ArrayColumnDesc<Complex>(columnName(c), aConfig.shape,
+                                              ColumnDesc::FixedShape));
+    }
+    SetupNewTable newtab(aName, td, Table::New);
+    newtab.bindAll(stman);
+    Table tab(aComm, newtab, aConfig.rowsPerRank * aConfig.ranks);
+    uint64_t bytes = 0;
+    for (int c = 0; c < aConfig.columns; ++c)
+    {
+        ArrayColumn<Complex> column(tab, columnName(c));
+        for (rownr_t row = 0; row < aConfig.rowsPerRank; row += chunkRows)
+        {
+            rownr_t n = std::min(chunkRows, aConfig.rowsPerRank - row);
+            Array<Complex> data(aConfig.shape.concatenate(IPosition(1, n)));
+            data = Complex(aRowStart + row, c);
+            column.putColumnRange(
+                Slicer(IPosition(1, aRowStart + row), IPosition(1, n)), data);
+            bytes += data.nelements() * sizeof(Complex);
+        }
+    }
+    return bytes;
+}
+
+// Reads the rows of this rank in full (aOp 'f'), as a slice of every cell
+// ('s') or every refRowsStride-th row ('r').
+uint64_t readTable(const Config &aConfig, const std::string &aName,
+                   rownr_t aRowStart, char aOp)
+{
+    Table tab(aName);
+    Slicer slicer = cellSlicer(aConfig.shape);
+    uint64_t bytes = 0;
+    for (int c = 0; c < aConfig.columns; ++c)
+    {
+        ArrayColumn<Complex> column(tab, columnName(c));
+        Array<Complex> data;
+        for (rownr_t row = 0; row < aConfig.rowsPerRank; row += chunkRows)
+        {
+            rownr_t n = std::min(chunkRows, aConfig.rowsPerRank - row);
+            Slicer rows(IPosition(1, aRowStart + row), IPosition(1, n));
+            if (aOp == 'f')
+            {
+                column.getColumnRange(rows, data, True);
+            }
+            else if (aOp == 's')
+            {
+                column.getColumnRange(rows, slicer, data, True);
+            }
+            else
+            {
+                column.getColumnCells(RefRows(aRowStart + row,
+                                              aRowStart + row + n - 1,
+                                              refRowsStride),
+                                      data, True);
+            }
+            bytes += data.nelements() * sizeof(Complex);
+        }
+    }
+    return bytes;
+}
+
+void run(MPI_Comm aComm, std::ostream &aCsv, const Config &aConfig,
+         int aRepeats, const std::string &aDir)
+{
+    static int tableCount = 0;
+    int rank;
+    MPI_Comm_rank(aComm, &rank);
+    rownr_t rowStart = aConfig.rowsPerRank * rank;
+    for (int r = 0; r < aRepeats; ++r)
+    {
+        std::string name =
+            aDir + "/bench" + std::to_string(tableCount++) + ".table";
+        uint64_t bytes = 0;
+        double seconds = timeOp(aComm, [&]() {
+            bytes = writeTable(aComm, aConfig, name, rowStart);
+        });
+        report(aComm, aCsv, aConfig, "write", r, seconds, bytes);
+        const char *names[] = {"read", "slice", "refrows"};
+        const char ops[] = {'f', 's', 'r'};
+        for (int i = 0; i < 3; ++i)
+        {
+            seconds = timeOp(aComm, [&]() {
+                bytes = readTable(aConfig, name, rowStart, ops[i]);
+            });
+            report(aComm, aCsv, aConfig, names[i], r, seconds, bytes);
+        }
+        MPI_Barrier(aComm);
+        if (rank == 0)
+        {
+            Table::deleteTable(name);
+        }
+    }
+}
+
+void usage()
+{
+    std::cerr << "Usage: bench [-m weak,strong] [-n ranks,...] [-r rows,...] "
+                 "[-s shape,...] [-c columns,...] [-e engine,...] "
+                 "[-p key=value]... [-k chunkRows] [-i repeats] "
+                 "[-d directory] [-o file.csv]"
+              << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    int worldRank, worldSize;
+    MPI_Init(&argc, &argv);
+    MPI_Comm_rank(MPI_COMM_WORLD, &worldRank);
+    MPI_Comm_size(MPI_COMM_WORLD, &worldSize);
+
+    std::vector<std::string> modes = {"weak", "strong"};
+    std::vector<uint64_t> rankCounts;
+    std::vector<uint64_t> rowCounts = {4096};
+    std::vector<std::string> shapes = {"4x64"};
+    std::vector<uint64_t> columnCounts = {1};
+    std::vector<std::string> engines = {"default"};
+    int repeats = 1;
+    std::string dir = ".";
+    std::string csvName;
+    int opt;
+    while ((opt = getopt(argc, argv, "m:n:r:s:c:e:p:k:i:d:o:")) != -1)
+    {
+        switch (opt)
+        {
+        case 'm':
+            modes = splitList(optarg);
+            break;
+        case 'n':
+            rankCounts = splitNumbers(optarg);
+            break;
+        case 'r':
+            rowCounts = splitNumbers(optarg);
+            break;
+        case 's':
+            shapes = splitList(optarg);
+            break;
+        case 'c':
+            columnCounts = splitNumbers(optarg);
+            break;
+        case 'e':
+            engines = splitList(optarg);
+            break;
+        case 'p':
+        {
+            std::string param = optarg;
+            size_t eq = param.find('=');
+            if (eq == std::string::npos)
+            {
+                usage();
+                MPI_Abort(MPI_COMM_WORLD, 1);
+            }
+            engineParams[param.substr(0, eq)] = param.substr(eq + 1);
+            break;
+        }
+        case 'k':
+            chunkRows = std::max<rownr_t>(1, std::stoull(optarg));
+            break;
+        case 'i':
+            repeats = std::stoi(optarg);
+            break;
+        case 'd':
+            dir = optarg;
+            break;
+        case 'o':
+            csvName = optarg;
+            break;
+        default:
+            usage();
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+    }
+    if (rankCounts.empty())
+    {
+        for (int n = 1; n < worldSize; n *= 2)
+        {
+            rankCounts.push_back(n);
+        }
+        rankCounts.push_back(worldSize);
+    }
+
+    std::ofstream csvFile;
+    if (worldRank == 0 && !csvName.empty())
+    {
+        csvFile.open(csvName);
+    }
+    std::ostream &csv = csvName.empty() ? std::cout : csvFile;
+    if (worldRank == 0)
+    {
+        csv << "mode,ranks,rows_per_rank,rows,shape,columns,engine,op,"
+               "repeat,bytes,min_s,max_s,mean_s,imbalance,mb_per_s"
+            << std::endl;
+    }
+
+    // every combination but the number of ranks, with the rows as given
+    std::vector<Config> configs;
+    for (auto &mode : modes)
+    {
+        for (uint64_t rows : rowCounts)
+        {
+            for (auto &shape : shapes)
+            {
+                for (uint64_t columns : columnCounts)
+                {
+                    for (auto &engine : engines)
+                    {
+                        configs.push_back({mode, 0, rows, parseShape(shape),
+                                           int(columns), engine});
+                    }
+                }
+            }
+        }
+    }
+
+    register_adios2stman();
+    for (uint64_t ranks : rankCounts)
+    {
+        if (ranks < 1 || ranks > uint64_t(worldSize))
+        {
+            if (worldRank == 0)
+            {
+                std::cerr << "bench: skipping " << ranks << " ranks of "
+                          << worldSize << std::endl;
+            }
+            continue;
+        }
+        MPI_Comm comm;
+        bool member = uint64_t(worldRank) < ranks;
+        MPI_Comm_split(MPI_COMM_WORLD, member ? 0 : MPI_UNDEFINED, worldRank,
+                       &comm);
+        if (member)
+        {
+            for (Config config : configs)
+            {
+                config.ranks = ranks;
+                if (config.mode == "strong")
+                {
+                    config.rowsPerRank /= ranks;
+                }
+                run(comm, csv, config, repeats, dir);
+            }
+            MPI_Comm_free(&comm);
+        }
+        MPI_Barrier(MPI_COMM_WORLD);
+    }
+
+    MPI_Finalize();
+    return 0;
+}
@@ -0,0 +1,111 @@
+//    (c) Oak Ridge National Laboratory
+//    1 Bethel Valley Road, Oak Ridge, TN 37830, United States
+//
+//    This library is free software: you can redistribute it and/or
+//    modify it under the terms of the GNU General Public License as published
+//    by the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License along
+//    with this library. If not, see <http://www.gnu.org/licenses/>.
+//
+//    Any bugs, questions, concerns and/or suggestions please email to
+//    wangr1@ornl.gov or jason.ruonan.wang@gmail.com
+
+// ################################################################################
+// This code writes a table several times larger than a small write memory
+// budget and checks that the budget forced spills, that the data held
+// never grew far past the budget, and that every cell reads back after
+// reopening.
+
+#include "../Adios2StMan.h"
+#include <casacore/tables/Tables/TableDesc.h>
+#include <casacore/tables/Tables/SetupNewTab.h>
+#include <casacore/tables/Tables/ScaColDesc.h>
+#include <casacore/tables/Tables/ScalarColumn.h>
+#include <casacore/tables/Tables/ArrColDesc.h>
+#include <casacore/tables/Tables/ArrayColumn.h>
+#include <casacore/casa/Arrays/ArrayLogical.h>
+#include <casacore/casa/namespace.h>
+#include <mpi.h>
+
+#include "common.h"
+
+const rownr_t NrRows = 200;
+IPosition array_pos = IPosition(2,32,32);
+// 8 rows of the array column
+const uint64_t Budget = 8 * 32 * 32 * sizeof(Double);
+
+int main(int argc, char **argv){
+
+    MPI_Init(&argc,&argv);
+
+    std::string filename;
+    if (argc < 2){
+        filename = "budget.table";
+    }
+    else{
+        filename = argv[1];
+    }
+
+    Adios2StMan *stman = new Adios2StMan();
+    stman->setMemoryBudget(Budget);
+
+    TableDesc td("", "1", TableDesc::Scratch);
+    td.addColumn (ScalarColumnDesc<Int>("scalar_Int"));
+    td.addColumn (ArrayColumnDesc<Double>("array_Double", array_pos, ColumnDesc::FixedShape));
+
+    SetupNewTable newtab(filename, td, Table::New);
+    newtab.bindAll(*stman);
+    Table *tab = new Table(newtab, NrRows);
+
+    Adios2StMan *write_stman = dynamic_cast<Adios2StMan *>(tab->findDataManager("Adios2StMan"));
+    Check(write_stman && write_stman->getMemoryBudget() == Budget, "budget of the bound manager");
+
+    ScalarColumn<Int> scalar_Int (*tab, "scalar_Int");
+    ArrayColumn<Double> array_Double (*tab, "array_Double");
+    Array<Double> arr_Double(array_pos);
+    for (rownr_t r = 0; r < NrRows; ++r){
+        scalar_Int.put(r, r * 3);
+        arr_Double = r + 0.5;
+        array_Double.put(r, arr_Double);
+    }
+
+    if (write_stman){
+        uint64_t written = NrRows * (sizeof(Int) + array_pos.product() * sizeof(Double));
+        Check(write_stman->getSpillCount() >= written / Budget - 1, "spills forced by the budget");
+        Check(write_stman->getHighWaterMark() <= Budget + array_pos.product() * sizeof(Double),
+              "data held within the budget");
+    }
+
+    delete tab;
+    delete stman;
+
+    Table casa_table(filename);
+    ScalarColumn<Int> read_Int(casa_table, "scalar_Int");
+    ArrayColumn<Double> read_Double(casa_table, "array_Double");
+    Array<Double> cell;
+    for (rownr_t r = 0; r < NrRows; ++r){
+        Check(read_Int.get(r) == Int(r * 3), "scalar_Int row " + std::to_string(r));
+        read_Double.get(r, cell, True);
+        Check(cell.shape() == array_pos && allEQ(cell, r + 0.5), "array_Double row " + std::to_string(r));
+    }
+    // file engines flush within the step instead of starting new ones
+    Adios2StMan *read_stman = dynamic_cast<Adios2StMan *>(casa_table.findDataManager("Adios2StMan"));
+    Check(read_stman && read_stman->getNrSteps() == 1, "spills kept within one step");
+    Vector<Int> col_Int = read_Int.getColumn();
+    for (rownr_t r = 0; r < NrRows; ++r){
+        Check(col_Int[r] == Int(r * 3), "scalar_Int column row " + std::to_string(r));
+    }
+
+    cout << "budget: " << (nrFailures ? "FAILED" : "OK") << endl;
+
+    MPI_Finalize();
+
+    return nrFailures;
+}
@@ -0,0 +1,151 @@
+//    (c) Oak Ridge National Laboratory
+//    1 Bethel Valley Road, Oak Ridge, TN 37830, United States
+//
+//    This library is free software: you can redistribute it and/or
+//    modify it under the terms of the GNU General Public License as published
+//    by the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License along
+//    with this library. If not, see <http://www.gnu.org/licenses/>.
+//
+//    Any bugs, questions, concerns and/or suggestions please email to
+//    wangr1@ornl.gov or jason.ruonan.wang@gmail.com
+
+// ################################################################################
+// This code reads cell slices of contiguous, strided and listed row ranges
+// with getColumnCells and checks them against the same slices read row by
+// row with getSlice, for a table stored in place and one stored in a
+// permuted row order.
+
+#include "../Adios2StMan.h"
+#include <casacore/tables/Tables/TableDesc.h>
+#include <casacore/tables/Tables/SetupNewTab.h>
+#include <casacore/tables/Tables/ArrColDesc.h>
+#include <casacore/tables/Tables/ArrayColumn.h>
+#include <casacore/casa/namespace.h>
+#include <mpi.h>
+
+#include "common.h"
+
+const rownr_t NrRows = 48;
+IPosition array_pos = IPosition(3,4,5,6);
+
+// Checks that the slices of aRows read at once match the slices read row
+// by row.
+void CheckCells(ArrayColumn<Float> &aColumn, const RefRows &aRows,
+                const std::vector<rownr_t> &aRowList, const Slicer &aSlicer,
+                const std::string &what){
+    Array<Float> cells;
+    aColumn.getColumnCells(aRows, aSlicer, cells, True);
+    std::vector<Float> expected;
+    Array<Float> slice;
+    for (rownr_t r : aRowList){
+        aColumn.getSlice(r, aSlicer, slice, True);
+        expected.insert(expected.end(), slice.begin(), slice.end());
+    }
+    std::vector<Float> actual(cells.begin(), cells.end());
+    Check(cells.shape().nelements() == 4 && cells.shape()[3] == Int(aRowList.size()), what + " shape");
+    Check(actual == expected, what);
+}
+
+// Writes the table, storing row aOrder[i] at row i if aOrder is not empty.
+void WriteTable(const std::string &filename, const std::vector<rownr_t> &aOrder){
+    Adios2StMan *stman = new Adios2StMan();
+
+    TableDesc td("", "1", TableDesc::Scratch);
+    td.addColumn (ArrayColumnDesc<Float>("array_Float", array_pos, ColumnDesc::FixedShape));
+
+    SetupNewTable newtab(filename, td, Table::New);
+    newtab.bindAll(*stman);
+    Table *tab = new Table(newtab, NrRows);
+    if (!aOrder.empty()){
+        Adios2StMan *write_stman = dynamic_cast<Adios2StMan *>(tab->findDataManager("Adios2StMan"));
+        write_stman->setRowOrder(aOrder);
+    }
+
+    // every element of every cell distinct
+    ArrayColumn<Float> array_Float (*tab, "array_Float");
+    Array<Float> arr_Float(array_pos);
+    for (rownr_t r = 0; r < NrRows; ++r){
+        Float *data = arr_Float.data();
+        for (size_t i = 0; i < arr_Float.nelements(); ++i){
+            data[i] = r * 1000 + i;
+        }
+        array_Float.put(r, arr_Float);
+    }
+
+    delete tab;
+    delete stman;
+}
+
+void CheckTable(const std::string &filename, const std::string &aName){
+    Table casa_table(filename);
+    ArrayColumn<Float> read_Float(casa_table, "array_Float");
+
+    // contiguous, strided and listed rows, the list holding runs of
+    // several rows and single rows
+    std::vector<rownr_t> contiguous, strided;
+    for (rownr_t r = 5; r <= 34; ++r){
+        contiguous.push_back(r);
+    }
+    for (rownr_t r = 1; r < NrRows; r += 4){
+        strided.push_back(r);
+    }
+    std::vector<rownr_t> listed = {3, 4, 5, 11, 12, 30, 47};
+    Vector<rownr_t> listedRows(listed.size());
+    for (size_t i = 0; i < listed.size(); ++i){
+        listedRows[i] = listed[i];
+    }
+
+    std::vector<Slicer> slicers;
+    slicers.push_back(Slicer(IPosition(3,0,0,0), array_pos, Slicer::endIsLength));
+    slicers.push_back(Slicer(IPosition(3,1,0,2), IPosition(3,2,5,3), Slicer::endIsLength));
+    slicers.push_back(Slicer(IPosition(3,0,1,0), IPosition(3,1,3,6), Slicer::endIsLength));
+    slicers.push_back(Slicer(IPosition(3,3,4,5), IPosition(3,1,1,1), Slicer::endIsLength));
+
+    for (size_t s = 0; s < slicers.size(); ++s){
+        std::string what = aName + " slicer " + std::to_string(s);
+        CheckCells(read_Float, RefRows(5, 34), contiguous, slicers[s], what + " contiguous rows");
+        CheckCells(read_Float, RefRows(1, NrRows - 1, 4), strided, slicers[s], what + " strided rows");
+        CheckCells(read_Float, RefRows(listedRows), listed, slicers[s], what + " listed rows");
+    }
+}
+
+int main(int argc, char **argv){
+
+    MPI_Init(&argc,&argv);
+
+    std::string filename;
+    if (argc < 2){
+        filename = "cellslice.table";
+    }
+    else{
+        filename = argv[1];
+    }
+
+    WriteTable(filename, {});
+    CheckTable(filename, "in place");
+
+    // interleave the two halves backwards, so that neither contiguous nor
+    // strided logical rows are contiguous on disk
+    std::vector<rownr_t> order;
+    for (rownr_t r = 0; r < NrRows / 2; ++r){
+        order.push_back(NrRows - 1 - r);
+        order.push_back(NrRows / 2 - 1 - r);
+    }
+    std::string mapped = filename + ".mapped.table";
+    WriteTable(mapped, order);
+    CheckTable(mapped, "row-mapped");
+
+    cout << "cellslice: " << (nrFailures ? "FAILED" : "OK") << endl;
+
+    MPI_Finalize();
+
+    return nrFailures;
+}
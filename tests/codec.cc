@@ -0,0 +1,143 @@
+//    (c) Oak Ridge National Laboratory
+//    1 Bethel Valley Road, Oak Ridge, TN 37830, United States
+//
+//    This library is free software: you can redistribute it and/or
+//    modify it under the terms of the GNU General Public License as published
+//    by the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License along
+//    with this library. If not, see <http://www.gnu.org/licenses/>.
+//
+//    Any bugs, questions, concerns and/or suggestions please email to
+//    wangr1@ornl.gov or jason.ruonan.wang@gmail.com
+
+// ################################################################################
+// This code writes a compressible and an incompressible column with the
+// compression chosen automatically, and checks that a codec is chosen for
+// the first one if ADIOS has any built in, that none is chosen for the
+// second one, that the choices are kept with the table, and that both
+// columns read back unchanged.
+
+#include "../Adios2StMan.h"
+#include <casacore/tables/Tables/TableDesc.h>
+#include <casacore/tables/Tables/SetupNewTab.h>
+#include <casacore/tables/Tables/ArrColDesc.h>
+#include <casacore/tables/Tables/ArrayColumn.h>
+#include <casacore/casa/namespace.h>
+#include <mpi.h>
+
+#include "common.h"
+
+#if defined(ADIOS2_HAVE_BLOSC) || defined(ADIOS2_HAVE_BLOSC2) || defined(ADIOS2_HAVE_BZIP2)
+const bool HaveCodec = true;
+#else
+const bool HaveCodec = false;
+#endif
+
+const rownr_t NrRows = 128;
+IPosition array_pos = IPosition(2,32,64);
+
+// few distinct values
+Double Compressible(rownr_t r, size_t i){
+    return ((r + i / 256) % 4) * 1.5;
+}
+
+// the high 32 bits of a 64 bit linear congruential generator, which look
+// random in every byte
+Int Incompressible(rownr_t r, size_t i){
+    uint64_t x = (uint64_t(r) << 32) + i + 1;
+    for (int k = 0; k < 3; ++k){
+        x = x * 6364136223846793005ULL + 1442695040888963407ULL;
+    }
+    return Int(x >> 32);
+}
+
+int main(int argc, char **argv){
+
+    MPI_Init(&argc,&argv);
+
+    std::string filename;
+    if (argc < 2){
+        filename = "codec.table";
+    }
+    else{
+        filename = argv[1];
+    }
+
+    Adios2StMan *stman = new Adios2StMan();
+    stman->setCompression("auto");
+    // the choice only depends on the size of the output
+    stman->setCompressionTarget(1e-6);
+
+    TableDesc td("", "1", TableDesc::Scratch);
+    td.addColumn (ArrayColumnDesc<Double>("compressible", array_pos, ColumnDesc::FixedShape));
+    td.addColumn (ArrayColumnDesc<Int>("incompressible", array_pos, ColumnDesc::FixedShape));
+
+    SetupNewTable newtab(filename, td, Table::New);
+    newtab.bindAll(*stman);
+    Table *tab = new Table(newtab, NrRows);
+
+    ArrayColumn<Double> compressible (*tab, "compressible");
+    ArrayColumn<Int> incompressible (*tab, "incompressible");
+    Array<Double> arr_Double(array_pos);
+    Array<Int> arr_Int(array_pos);
+    for (rownr_t r = 0; r < NrRows; ++r){
+        Double *data_Double = arr_Double.data();
+        Int *data_Int = arr_Int.data();
+        for (size_t i = 0; i < arr_Double.nelements(); ++i){
+            data_Double[i] = Compressible(r, i);
+            data_Int[i] = Incompressible(r, i);
+        }
+        compressible.put(r, arr_Double);
+        incompressible.put(r, arr_Int);
+    }
+
+    delete tab;
+    delete stman;
+
+    Table casa_table(filename);
+    Adios2StMan *read_stman = dynamic_cast<Adios2StMan *>(casa_table.findDataManager("Adios2StMan"));
+    Check(read_stman != 0, "Adios2StMan of the table");
+    if (read_stman){
+        String codec = read_stman->getColumnCompression("compressible");
+        cout << "codec chosen for the compressible column: " << codec << endl;
+        if (HaveCodec){
+            Check(codec != "" && codec != "none", "codec of the compressible column");
+        }
+        else{
+            Check(codec == "none", "codec of the compressible column without codecs");
+        }
+        Check(read_stman->getColumnCompression("incompressible") == "none", "codec of the incompressible column");
+    }
+
+    ArrayColumn<Double> read_Double(casa_table, "compressible");
+    ArrayColumn<Int> read_Int(casa_table, "incompressible");
+    Array<Double> cell_Double;
+    Array<Int> cell_Int;
+    for (rownr_t r = 0; r < NrRows; ++r){
+        read_Double.get(r, cell_Double, True);
+        read_Int.get(r, cell_Int, True);
+        std::vector<Double> values_Double(cell_Double.begin(), cell_Double.end());
+        std::vector<Int> values_Int(cell_Int.begin(), cell_Int.end());
+        bool ok_Double = values_Double.size() == size_t(array_pos.product());
+        bool ok_Int = values_Int.size() == size_t(array_pos.product());
+        for (size_t i = 0; ok_Double && ok_Int && i < values_Double.size(); ++i){
+            ok_Double = values_Double[i] == Compressible(r, i);
+            ok_Int = values_Int[i] == Incompressible(r, i);
+        }
+        Check(ok_Double, "compressible row " + std::to_string(r));
+        Check(ok_Int, "incompressible row " + std::to_string(r));
+    }
+
+    cout << "codec: " << (nrFailures ? "FAILED" : "OK") << endl;
+
+    MPI_Finalize();
+
+    return nrFailures;
+}
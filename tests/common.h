@@ -3,5 +3,16 @@ void GenData(Array<T> &arr, IPosition pos, uInt row){
     arr = row + 1;
 }
 
+// Self-checking tests report every mismatch and return the number of
+// mismatches as their exit status.
+int nrFailures = 0;
+
+void Check(bool ok, const std::string &what){
+    if (!ok){
+        cout << "FAILED: " << what << endl;
+        ++nrFailures;
+    }
+}
+
 
 
@@ -0,0 +1,128 @@
+//    (c) Oak Ridge National Laboratory
+//    1 Bethel Valley Road, Oak Ridge, TN 37830, United States
+//
+//    This library is free software: you can redistribute it and/or
+//    modify it under the terms of the GNU General Public License as published
+//    by the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License along
+//    with this library. If not, see <http://www.gnu.org/licenses/>.
+//
+//    Any bugs, questions, concerns and/or suggestions please email to
+//    wangr1@ornl.gov or jason.ruonan.wang@gmail.com
+
+// ################################################################################
+// This code writes a table and a subtable with columns of the same names
+// into one shared ADIOS container, reopens both and checks that each
+// reads back its own cells.
+
+#include "../Adios2StMan.h"
+#include <casacore/tables/Tables/TableDesc.h>
+#include <casacore/tables/Tables/SetupNewTab.h>
+#include <casacore/tables/Tables/ScaColDesc.h>
+#include <casacore/tables/Tables/ScalarColumn.h>
+#include <casacore/tables/Tables/ArrColDesc.h>
+#include <casacore/tables/Tables/ArrayColumn.h>
+#include <casacore/casa/Arrays/ArrayLogical.h>
+#include <casacore/casa/namespace.h>
+#include <mpi.h>
+
+#include "common.h"
+
+const rownr_t NrRows = 50;
+const rownr_t NrSubRows = 7;
+IPosition array_pos = IPosition(2,2,3);
+
+Table *CreateTable(const std::string &aName, const std::string &aContainer,
+                   rownr_t aNrRows){
+    Adios2StMan stman;
+    stman.setContainer(aContainer);
+    TableDesc td("", "1", TableDesc::Scratch);
+    td.addColumn (ScalarColumnDesc<Int>("scalar_Int"));
+    td.addColumn (ArrayColumnDesc<Float>("array_Float", array_pos, ColumnDesc::FixedShape));
+    SetupNewTable newtab(aName, td, Table::New);
+    newtab.bindAll(stman);
+    return new Table(newtab, aNrRows);
+}
+
+void PutTable(Table &aTable, Int aOffset){
+    ScalarColumn<Int> scalar_Int (aTable, "scalar_Int");
+    ArrayColumn<Float> array_Float (aTable, "array_Float");
+    Array<Float> arr_Float(array_pos);
+    for (rownr_t r = 0; r < aTable.nrow(); ++r){
+        scalar_Int.put(r, aOffset + r);
+        arr_Float = aOffset + r + 0.5;
+        array_Float.put(r, arr_Float);
+    }
+}
+
+void CheckTable(const std::string &aName, rownr_t aNrRows, Int aOffset){
+    Table casa_table(aName);
+    Check(casa_table.nrow() == aNrRows, aName + " rows");
+    Adios2StMan *read_stman = dynamic_cast<Adios2StMan *>(casa_table.findDataManager("Adios2StMan"));
+    Check(read_stman && !read_stman->getContainer().empty(), aName + " container");
+    ScalarColumn<Int> read_Int(casa_table, "scalar_Int");
+    ArrayColumn<Float> read_Float(casa_table, "array_Float");
+    Array<Float> cell;
+    for (rownr_t r = 0; r < casa_table.nrow(); ++r){
+        std::string what = aName + " row " + std::to_string(r);
+        Check(read_Int.get(r) == Int(aOffset + r), "scalar_Int " + what);
+        read_Float.get(r, cell, True);
+        Check(cell.shape() == array_pos && allEQ(cell, Float(aOffset + r + 0.5)), "array_Float " + what);
+    }
+}
+
+int main(int argc, char **argv){
+
+    MPI_Init(&argc,&argv);
+
+    std::string filename;
+    if (argc < 2){
+        filename = "container.table";
+    }
+    else{
+        filename = argv[1];
+    }
+    std::string subname = filename + "/ANTENNA";
+    std::string container = filename + "/adios.bp";
+
+    // both tables are open while they are written, the container being
+    // closed by the last of them
+    Table *tab = CreateTable(filename, container, NrRows);
+    Table *subtab = CreateTable(subname, container, NrSubRows);
+    PutTable(*tab, 0);
+    PutTable(*subtab, 1000);
+    delete subtab;
+    delete tab;
+
+    CheckTable(filename, NrRows, 0);
+    CheckTable(subname, NrSubRows, 1000);
+
+    // and once more with both open at the same time
+    {
+        Table casa_table(filename);
+        Table sub_table(subname);
+        ScalarColumn<Int> read_Int(casa_table, "scalar_Int");
+        ScalarColumn<Int> read_sub_Int(sub_table, "scalar_Int");
+        Vector<Int> col_Int = read_Int.getColumn();
+        Vector<Int> col_sub_Int = read_sub_Int.getColumn();
+        for (rownr_t r = 0; r < NrRows; ++r){
+            Check(col_Int[r] == Int(r), "scalar_Int column row " + std::to_string(r));
+        }
+        for (rownr_t r = 0; r < NrSubRows; ++r){
+            Check(col_sub_Int[r] == Int(1000 + r), "subtable scalar_Int column row " + std::to_string(r));
+        }
+    }
+
+    cout << "container: " << (nrFailures ? "FAILED" : "OK") << endl;
+
+    MPI_Finalize();
+
+    return nrFailures;
+}
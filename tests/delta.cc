@@ -0,0 +1,166 @@
+//    (c) Oak Ridge National Laboratory
+//    1 Bethel Valley Road, Oak Ridge, TN 37830, United States
+//
+//    This library is free software: you can redistribute it and/or
+//    modify it under the terms of the GNU General Public License as published
+//    by the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License along
+//    with this library. If not, see <http://www.gnu.org/licenses/>.
+//
+//    Any bugs, questions, concerns and/or suggestions please email to
+//    wangr1@ornl.gov or jason.ruonan.wang@gmail.com
+
+
+// ################################################################################
+// This code writes delta (order 1) and delta-of-delta (order 2) encoded
+// scalar columns over several decoder checkpoints, with steady strides,
+// jumps and negative values, and checks that they read back unchanged as
+// a whole column and cell by cell in a scattered order, so that single
+// rows are decoded from every checkpoint and across their boundaries.
+// scalar_Int is then updated in a few rows, which re-encodes only the
+// checkpoint intervals around them.
+
+#include "../Adios2StMan.h"
+#include <casacore/tables/Tables/TableDesc.h>
+#include <casacore/tables/Tables/SetupNewTab.h>
+#include <casacore/tables/Tables/ScaColDesc.h>
+#include <casacore/tables/Tables/ScalarColumn.h>
+#include <casacore/casa/namespace.h>
+#include <mpi.h>
+
+#include "common.h"
+
+// more than four checkpoints of Adios2StManDeltaBlock::DefaultInterval rows
+const rownr_t NrRows = 4500;
+
+// TIME like: steady integration time with a gap every 1000 rows
+Double TimeValue(rownr_t r){
+    return 4.8e9 + r * 1.5 + (r / 1000) * 600.25;
+}
+
+// quadratic with a jump, so that second differences are mostly constant
+Int IntValue(rownr_t r){
+    return Int(r * r / 4) - 20000 + (r >= 3000 ? 123457 : 0);
+}
+
+Float FloatValue(rownr_t r){
+    return -0.25f * r;
+}
+
+// rows 2100 to 2109 and the last row of scalar_Int after the update
+bool Updated(rownr_t r){
+    return (r >= 2100 && r < 2110) || r == NrRows - 1;
+}
+
+Int UpdatedValue(rownr_t r){
+    return Updated(r) ? -Int(r) : IntValue(r);
+}
+
+int main(int argc, char **argv){
+
+    MPI_Init(&argc,&argv);
+
+    std::string filename;
+    if (argc < 2){
+        filename = "delta.table";
+    }
+    else{
+        filename = argv[1];
+    }
+
+    Adios2StMan *stman = new Adios2StMan();
+    stman->setColumnEncoding("scalar_Double", "delta");
+    stman->setColumnEncoding("scalar_Int", "delta2");
+    stman->setColumnEncoding("scalar_Float", "delta2");
+
+    TableDesc td("", "1", TableDesc::Scratch);
+    td.addColumn (ScalarColumnDesc<Double>("scalar_Double"));
+    td.addColumn (ScalarColumnDesc<Int>("scalar_Int"));
+    td.addColumn (ScalarColumnDesc<Float>("scalar_Float"));
+
+    SetupNewTable newtab(filename, td, Table::New);
+    newtab.bindAll(*stman);
+    Table *tab = new Table(newtab, NrRows);
+
+    ScalarColumn<Double> scalar_Double (*tab, "scalar_Double");
+    ScalarColumn<Int> scalar_Int (*tab, "scalar_Int");
+    ScalarColumn<Float> scalar_Float (*tab, "scalar_Float");
+
+    Vector<Double> vec_Double(NrRows);
+    for (rownr_t r = 0; r < NrRows; ++r){
+        vec_Double[r] = TimeValue(r);
+        scalar_Int.put(r, IntValue(r));
+        scalar_Float.put(r, FloatValue(r));
+    }
+    scalar_Double.putColumn(vec_Double);
+
+    delete tab;
+    delete stman;
+
+    // rows around every checkpoint, then a scattered walk over the table
+    std::vector<rownr_t> rows;
+    for (rownr_t c = 1024; c < NrRows; c += 1024){
+        rows.push_back(c - 1);
+        rows.push_back(c);
+        rows.push_back(c + 1);
+    }
+    rows.push_back(NrRows - 1);
+    rows.push_back(0);
+    for (rownr_t i = 0, r = 17; i < NrRows; ++i, r = (r * 2477 + 911) % NrRows){
+        rows.push_back(r);
+    }
+    {
+        Table casa_table(filename);
+        ScalarColumn<Double> read_Double(casa_table, "scalar_Double");
+        ScalarColumn<Int> read_Int(casa_table, "scalar_Int");
+        ScalarColumn<Float> read_Float(casa_table, "scalar_Float");
+
+        Vector<Double> col_Double = read_Double.getColumn();
+        Vector<Int> col_Int = read_Int.getColumn();
+        Vector<Float> col_Float = read_Float.getColumn();
+        for (rownr_t r = 0; r < NrRows; ++r){
+            Check(col_Double[r] == TimeValue(r), "scalar_Double column row " + std::to_string(r));
+            Check(col_Int[r] == IntValue(r), "scalar_Int column row " + std::to_string(r));
+            Check(col_Float[r] == FloatValue(r), "scalar_Float column row " + std::to_string(r));
+        }
+
+        for (rownr_t r : rows){
+            Check(read_Double.get(r) == TimeValue(r), "scalar_Double row " + std::to_string(r));
+            Check(read_Int.get(r) == IntValue(r), "scalar_Int row " + std::to_string(r));
+            Check(read_Float.get(r) == FloatValue(r), "scalar_Float row " + std::to_string(r));
+        }
+    }
+    {
+        Table update_table(filename, Table::Update);
+        ScalarColumn<Int> update_Int(update_table, "scalar_Int");
+        for (rownr_t r = 0; r < NrRows; ++r){
+            if (Updated(r)){
+                update_Int.put(r, UpdatedValue(r));
+            }
+        }
+        Check(update_Int.get(2105) == UpdatedValue(2105), "scalar_Int row 2105 within the update");
+        Check(update_Int.get(2000) == IntValue(2000), "scalar_Int row 2000 within the update");
+    }
+    Table updated_table(filename);
+    ScalarColumn<Int> updated_Int(updated_table, "scalar_Int");
+    Vector<Int> updated_col = updated_Int.getColumn();
+    for (rownr_t r = 0; r < NrRows; ++r){
+        Check(updated_col[r] == UpdatedValue(r), "updated scalar_Int column row " + std::to_string(r));
+    }
+    for (rownr_t r : rows){
+        Check(updated_Int.get(r) == UpdatedValue(r), "updated scalar_Int row " + std::to_string(r));
+    }
+
+    cout << "delta: " << (nrFailures ? "FAILED" : "OK") << endl;
+
+    MPI_Finalize();
+
+    return nrFailures;
+}
@@ -0,0 +1,120 @@
+//    (c) Oak Ridge National Laboratory
+//    1 Bethel Valley Road, Oak Ridge, TN 37830, United States
+//
+//    This library is free software: you can redistribute it and/or
+//    modify it under the terms of the GNU General Public License as published
+//    by the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License along
+//    with this library. If not, see <http://www.gnu.org/licenses/>.
+//
+//    Any bugs, questions, concerns and/or suggestions please email to
+//    wangr1@ornl.gov or jason.ruonan.wang@gmail.com
+
+
+// ################################################################################
+// This code passes a table from a writer to a reader in the same process
+// through the Inline engine, one step of rows at a time, and checks that
+// the reader sees every step as the writer put it, as cells and as
+// slices. Writer and reader find each other through a named Inline channel:
+// the reader is a scratch table created on the channel after the writer.
+
+#include "../Adios2StMan.h"
+#include <casacore/tables/Tables/TableDesc.h>
+#include <casacore/tables/Tables/SetupNewTab.h>
+#include <casacore/tables/Tables/ScaColDesc.h>
+#include <casacore/tables/Tables/ScalarColumn.h>
+#include <casacore/tables/Tables/ArrColDesc.h>
+#include <casacore/tables/Tables/ArrayColumn.h>
+#include <casacore/casa/Arrays/ArrayLogical.h>
+#include <casacore/casa/namespace.h>
+#include <mpi.h>
+
+#include "common.h"
+
+const rownr_t NrSteps = 5;
+const rownr_t RowsPerStep = 8;
+const rownr_t NrRows = NrSteps * RowsPerStep;
+IPosition array_pos = IPosition(2,4,6);
+
+int main(int argc, char **argv){
+
+    MPI_Init(&argc,&argv);
+
+    std::string filename;
+    if (argc < 2){
+        filename = "inline.table";
+    }
+    else{
+        filename = argv[1];
+    }
+    const String channel = "inline_test";
+
+    Adios2StMan *stman = new Adios2StMan("Inline", {}, {});
+    stman->setInlineChannel(channel);
+
+    TableDesc td("", "1", TableDesc::Scratch);
+    td.addColumn (ScalarColumnDesc<Double>("scalar_Double"));
+    td.addColumn (ArrayColumnDesc<Complex>("array_Complex", array_pos, ColumnDesc::FixedShape));
+
+    SetupNewTable newtab(filename, td, Table::New);
+    newtab.bindAll(*stman);
+    Table *tab = new Table(newtab, NrRows);
+
+    Adios2StMan *writer = dynamic_cast<Adios2StMan *>(tab->findDataManager("Adios2StMan"));
+    Check(writer && writer->isInline(), "Inline writer");
+    Check(writer && writer->getInlineChannel() == channel, "Inline writer channel");
+
+    // the reader is created on the same channel
+    Adios2StMan *reader_stman = new Adios2StMan("Inline", {}, {});
+    reader_stman->setInlineChannel(channel);
+    SetupNewTable reader_newtab(filename + ".reader", td, Table::Scratch);
+    reader_newtab.bindAll(*reader_stman);
+    Table *reader_table = new Table(reader_newtab, NrRows);
+    Adios2StMan *reader = dynamic_cast<Adios2StMan *>(reader_table->findDataManager("Adios2StMan"));
+    Check(reader && reader != writer, "Inline reader");
+
+    ScalarColumn<Double> scalar_Double (*tab, "scalar_Double");
+    ArrayColumn<Complex> array_Complex (*tab, "array_Complex");
+    ScalarColumn<Double> read_Double (*reader_table, "scalar_Double");
+    ArrayColumn<Complex> read_Complex (*reader_table, "array_Complex");
+
+    Slicer slicer(IPosition(2,1,2), IPosition(2,2,3), IPosition(2,2,1), Slicer::endIsLength);
+    Array<Complex> arr_Complex(array_pos);
+    Array<Complex> cell, slice;
+    for (rownr_t s = 0; writer && reader && s < NrSteps; ++s){
+        for (rownr_t r = s * RowsPerStep; r < (s + 1) * RowsPerStep; ++r){
+            scalar_Double.put(r, r * 0.25);
+            arr_Complex = Complex(r, -Float(s));
+            array_Complex.put(r, arr_Complex);
+        }
+        writer->endStep();
+
+        for (rownr_t r = s * RowsPerStep; r < (s + 1) * RowsPerStep; ++r){
+            std::string what = "step " + std::to_string(s) + " row " + std::to_string(r);
+            Check(read_Double.get(r) == r * 0.25, "scalar_Double " + what);
+            read_Complex.get(r, cell, True);
+            Check(cell.shape() == array_pos && allEQ(cell, Complex(r, -Float(s))), "array_Complex " + what);
+            read_Complex.getSlice(r, slicer, slice, True);
+            Check(slice.nelements() == 6 && allEQ(slice, Complex(r, -Float(s))), "array_Complex slice " + what);
+        }
+    }
+    Check(reader && reader->getStepCount() == NrSteps, "steps seen by the reader");
+
+    delete reader_table;
+    delete reader_stman;
+    delete tab;
+    delete stman;
+
+    cout << "inline: " << (nrFailures ? "FAILED" : "OK") << endl;
+
+    MPI_Finalize();
+
+    return nrFailures;
+}
@@ -0,0 +1,123 @@
+//    (c) Oak Ridge National Laboratory
+//    1 Bethel Valley Road, Oak Ridge, TN 37830, United States
+//
+//    This library is free software: you can redistribute it and/or
+//    modify it under the terms of the GNU General Public License as published
+//    by the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License along
+//    with this library. If not, see <http://www.gnu.org/licenses/>.
+//
+//    Any bugs, questions, concerns and/or suggestions please email to
+//    wangr1@ornl.gov or jason.ruonan.wang@gmail.com
+
+// ################################################################################
+// This code opens a table while the ADIOS engine type is set to one that
+// does not exist, so that opening the engine fails, and checks that the
+// number of rows and the shapes and types of the columns are known all the
+// same, and that only reading a cell opens the engine.
+
+#include "../Adios2StMan.h"
+#include <casacore/tables/Tables/TableDesc.h>
+#include <casacore/tables/Tables/SetupNewTab.h>
+#include <casacore/tables/Tables/ScaColDesc.h>
+#include <casacore/tables/Tables/ScalarColumn.h>
+#include <casacore/tables/Tables/ArrColDesc.h>
+#include <casacore/tables/Tables/ArrayColumn.h>
+#include <casacore/casa/namespace.h>
+#include <mpi.h>
+
+#include "common.h"
+
+const rownr_t NrRows = 30;
+IPosition array_pos = IPosition(2,3,4);
+
+int main(int argc, char **argv){
+
+    MPI_Init(&argc,&argv);
+
+    std::string filename;
+    if (argc < 2){
+        filename = "layout.table";
+    }
+    else{
+        filename = argv[1];
+    }
+
+    Adios2StMan *stman = new Adios2StMan();
+
+    TableDesc td("", "1", TableDesc::Scratch);
+    td.addColumn (ScalarColumnDesc<Int>("scalar_Int"));
+    td.addColumn (ArrayColumnDesc<Complex>("array_Complex", array_pos, ColumnDesc::FixedShape));
+
+    SetupNewTable newtab(filename, td, Table::New);
+    newtab.bindAll(*stman);
+    Table *tab = new Table(newtab, NrRows);
+
+    ScalarColumn<Int> scalar_Int (*tab, "scalar_Int");
+    ArrayColumn<Complex> array_Complex (*tab, "array_Complex");
+    Array<Complex> arr_Complex(array_pos);
+    for (rownr_t r = 0; r < NrRows; ++r){
+        scalar_Int.put(r, r);
+        arr_Complex = Complex(r, 1);
+        array_Complex.put(r, arr_Complex);
+    }
+
+    delete tab;
+    delete stman;
+
+    // the engine type is shared by the managers made when tables are
+    // opened, so any engine opened from now on fails
+    Adios2StMan no_engine("NoSuchEngine", {}, {});
+    {
+        Table casa_table(filename);
+        Check(casa_table.nrow() == NrRows, "rows");
+        ScalarColumn<Int> read_Int(casa_table, "scalar_Int");
+        ArrayColumn<Complex> read_Complex(casa_table, "array_Complex");
+        Check(read_Int.columnDesc().dataType() == TpInt, "scalar_Int type");
+        Check(read_Complex.columnDesc().dataType() == TpComplex, "array_Complex type");
+        Check(read_Complex.ndim(0) == 2, "array_Complex dimensions");
+        Check(read_Complex.shape(0) == array_pos, "array_Complex shape of the first row");
+        Check(read_Complex.shape(NrRows - 1) == array_pos, "array_Complex shape of the last row");
+        Check(read_Complex.isDefined(NrRows / 2), "array_Complex cell defined");
+        Adios2StMan *read_stman = dynamic_cast<Adios2StMan *>(casa_table.findDataManager("Adios2StMan"));
+        Check(read_stman && read_stman->getNrSteps() == 1, "steps");
+
+        bool opened = true;
+        try{
+            read_Int.get(0);
+        }
+        catch (std::exception &e){
+            opened = false;
+        }
+        Check(!opened, "reading a cell opens the engine");
+    }
+
+    // and with the default engine the cells read back
+    Adios2StMan default_engine;
+    {
+        Table casa_table(filename);
+        ScalarColumn<Int> read_Int(casa_table, "scalar_Int");
+        ArrayColumn<Complex> read_Complex(casa_table, "array_Complex");
+        Array<Complex> cell;
+        for (rownr_t r = 0; r < NrRows; ++r){
+            Check(read_Int.get(r) == Int(r), "scalar_Int row " + std::to_string(r));
+            read_Complex.get(r, cell, True);
+            std::vector<Complex> values(cell.begin(), cell.end());
+            Check(values == std::vector<Complex>(array_pos.product(), Complex(r, 1)),
+                  "array_Complex row " + std::to_string(r));
+        }
+    }
+
+    cout << "layout: " << (nrFailures ? "FAILED" : "OK") << endl;
+
+    MPI_Finalize();
+
+    return nrFailures;
+}
@@ -0,0 +1,137 @@
+//    (c) Oak Ridge National Laboratory
+//    1 Bethel Valley Road, Oak Ridge, TN 37830, United States
+//
+//    This library is free software: you can redistribute it and/or
+//    modify it under the terms of the GNU General Public License as published
+//    by the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License along
+//    with this library. If not, see <http://www.gnu.org/licenses/>.
+//
+//    Any bugs, questions, concerns and/or suggestions please email to
+//    wangr1@ornl.gov or jason.ruonan.wang@gmail.com
+
+// ################################################################################
+// This code puts and gets cells through the staging buffers of the storage
+// manager, from and into arrays without contiguous storage, for whole
+// cells, slices and listed rows, and checks that once the first round has
+// filled the buffer pool, further rounds of the same accesses allocate no
+// more buffers.
+
+#include "../Adios2StMan.h"
+#include <casacore/tables/Tables/TableDesc.h>
+#include <casacore/tables/Tables/SetupNewTab.h>
+#include <casacore/tables/Tables/ArrColDesc.h>
+#include <casacore/tables/Tables/ArrayColumn.h>
+#include <casacore/casa/Arrays/ArrayLogical.h>
+#include <casacore/casa/namespace.h>
+#include <mpi.h>
+
+#include "common.h"
+
+const rownr_t NrRows = 200;
+const rownr_t RowsPerRound = 20;
+IPosition array_pos = IPosition(2,6,5);
+
+// every element of a cell distinct
+Float Value(rownr_t aRow, size_t aElement){
+    return aRow * 100 + aElement;
+}
+
+uint64_t Allocations(const Table &aTable){
+    Adios2StMan *stman = dynamic_cast<Adios2StMan *>(aTable.findDataManager("Adios2StMan"));
+    return stman->getBufferPool().getAllocationCount();
+}
+
+int main(int argc, char **argv){
+
+    MPI_Init(&argc,&argv);
+
+    std::string filename;
+    if (argc < 2){
+        filename = "pool.table";
+    }
+    else{
+        filename = argv[1];
+    }
+
+    // cells are put from every other row of an array twice as high, so
+    // that they have no contiguous storage and are staged
+    Array<Float> doubled(IPosition(2, 2 * array_pos[0], array_pos[1]));
+    Slicer everyOther(IPosition(2,0,0), array_pos, IPosition(2,2,1), Slicer::endIsLength);
+
+    {
+        Adios2StMan stman;
+        TableDesc td("", "1", TableDesc::Scratch);
+        td.addColumn (ArrayColumnDesc<Float>("array_Float", array_pos, ColumnDesc::FixedShape));
+        SetupNewTable newtab(filename, td, Table::New);
+        newtab.bindAll(stman);
+        Table tab(newtab, NrRows);
+        ArrayColumn<Float> array_Float (tab, "array_Float");
+        uint64_t firstRound = 0;
+        for (rownr_t r = 0; r < NrRows; ++r){
+            Array<Float> cell = doubled(everyOther);
+            Array<Float> values(array_pos);
+            Float *data = values.data();
+            for (size_t i = 0; i < values.nelements(); ++i){
+                data[i] = Value(r, i);
+            }
+            cell = values;
+            array_Float.put(r, cell);
+            if (r + 1 == RowsPerRound){
+                firstRound = Allocations(tab);
+            }
+        }
+        Check(firstRound > 0, "puts staged in pooled buffers");
+        Check(Allocations(tab) == firstRound, "no allocations after the first round of puts");
+    }
+
+    Table casa_table(filename);
+    ArrayColumn<Float> read_Float(casa_table, "array_Float");
+    Slicer slicer(IPosition(2,1,1), IPosition(2,4,3), IPosition(2,2,1), Slicer::endIsLength);
+    uint64_t firstRound = 0;
+    for (rownr_t round = 0; round < NrRows / RowsPerRound; ++round){
+        rownr_t first = round * RowsPerRound;
+        std::string what = "round " + std::to_string(round);
+        // whole cells and slices into arrays without contiguous storage
+        for (rownr_t r = first; r < first + RowsPerRound; ++r){
+            Array<Float> cell = doubled(everyOther);
+            read_Float.get(r, cell);
+            Array<Float> expected(array_pos);
+            Float *data = expected.data();
+            for (size_t i = 0; i < expected.nelements(); ++i){
+                data[i] = Value(r, i);
+            }
+            Check(allEQ(cell, expected), what + " cell " + std::to_string(r));
+            Array<Float> slice = doubled(Slicer(IPosition(2,0,0), IPosition(2,2,3), IPosition(2,2,1), Slicer::endIsLength));
+            read_Float.getSlice(r, slicer, slice);
+            Check(allEQ(slice, expected(slicer)), what + " slice " + std::to_string(r));
+        }
+        // every other row of the round at once
+        Vector<rownr_t> rows(RowsPerRound / 2);
+        for (rownr_t i = 0; i < RowsPerRound / 2; ++i){
+            rows[i] = first + 2 * i;
+        }
+        Array<Float> cells;
+        read_Float.getColumnCells(RefRows(rows), slicer, cells, True);
+        Check(cells.nelements() == RowsPerRound / 2 * 2 * 3, what + " listed rows");
+        if (round == 0){
+            firstRound = Allocations(casa_table);
+        }
+        else{
+            Check(Allocations(casa_table) == firstRound, what + " allocates no buffers");
+        }
+    }
+
+    cout << "pool: " << (nrFailures ? "FAILED" : "OK") << endl;
+
+    MPI_Finalize();
+
+    return nrFailures;
+}
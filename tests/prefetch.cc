@@ -0,0 +1,132 @@
+//    (c) Oak Ridge National Laboratory
+//    1 Bethel Valley Road, Oak Ridge, TN 37830, United States
+//
+//    This library is free software: you can redistribute it and/or
+//    modify it under the terms of the GNU General Public License as published
+//    by the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License along
+//    with this library. If not, see <http://www.gnu.org/licenses/>.
+//
+//    Any bugs, questions, concerns and/or suggestions please email to
+//    wangr1@ornl.gov or jason.ruonan.wang@gmail.com
+
+// ################################################################################
+// This code reads columns with access hints set, sequentially, after
+// jumps forwards and backwards, and over hinted row ranges, and checks
+// that every cell and slice served from the read-ahead buffers holds the
+// values written.
+
+#include "../Adios2StMan.h"
+#include <casacore/tables/Tables/TableDesc.h>
+#include <casacore/tables/Tables/SetupNewTab.h>
+#include <casacore/tables/Tables/ScaColDesc.h>
+#include <casacore/tables/Tables/ScalarColumn.h>
+#include <casacore/tables/Tables/ArrColDesc.h>
+#include <casacore/tables/Tables/ArrayColumn.h>
+#include <casacore/casa/namespace.h>
+#include <mpi.h>
+
+#include "common.h"
+
+const rownr_t NrRows = 1000;
+IPosition array_pos = IPosition(2,3,4);
+
+// Reads rows aFirst to aLast and checks them against the values written.
+void CheckRows(ScalarColumn<Double> &aScalar, ArrayColumn<Float> &aArray,
+               const Slicer &aSlicer, rownr_t aFirst, rownr_t aLast,
+               const std::string &when){
+    Array<Float> slice;
+    for (rownr_t r = aFirst; r <= aLast; ++r){
+        std::string what = when + " row " + std::to_string(r);
+        Check(aScalar.get(r) == r * 0.5, "scalar_Double " + what);
+        aArray.getSlice(r, aSlicer, slice, True);
+        // the slice holds elements 1-2 of the first axis and 1-3 of the
+        // second axis of the cell
+        std::vector<Float> expected = {Float(r * 100 + 4), Float(r * 100 + 5),
+                                       Float(r * 100 + 7), Float(r * 100 + 8),
+                                       Float(r * 100 + 10), Float(r * 100 + 11)};
+        std::vector<Float> actual(slice.begin(), slice.end());
+        Check(actual == expected, "array_Float " + what);
+    }
+}
+
+int main(int argc, char **argv){
+
+    MPI_Init(&argc,&argv);
+
+    std::string filename;
+    if (argc < 2){
+        filename = "prefetch.table";
+    }
+    else{
+        filename = argv[1];
+    }
+
+    Adios2StMan *stman = new Adios2StMan();
+
+    TableDesc td("", "1", TableDesc::Scratch);
+    td.addColumn (ScalarColumnDesc<Double>("scalar_Double"));
+    td.addColumn (ArrayColumnDesc<Float>("array_Float", array_pos, ColumnDesc::FixedShape));
+
+    SetupNewTable newtab(filename, td, Table::New);
+    newtab.bindAll(*stman);
+    Table *tab = new Table(newtab, NrRows);
+
+    ScalarColumn<Double> scalar_Double (*tab, "scalar_Double");
+    ArrayColumn<Float> array_Float (*tab, "array_Float");
+    Array<Float> arr_Float(array_pos);
+    for (rownr_t r = 0; r < NrRows; ++r){
+        scalar_Double.put(r, r * 0.5);
+        Float *data = arr_Float.data();
+        for (size_t i = 0; i < arr_Float.nelements(); ++i){
+            data[i] = r * 100 + i;
+        }
+        array_Float.put(r, arr_Float);
+    }
+
+    delete tab;
+    delete stman;
+
+    Table casa_table(filename);
+    ScalarColumn<Double> read_Double(casa_table, "scalar_Double");
+    ArrayColumn<Float> read_Float(casa_table, "array_Float");
+    Adios2StMan *read_stman = dynamic_cast<Adios2StMan *>(casa_table.findDataManager("Adios2StMan"));
+    Check(read_stman != 0, "Adios2StMan of the table");
+    if (read_stman){
+        Slicer slicer(IPosition(2,1,1), IPosition(2,2,3), Slicer::endIsLength);
+        read_stman->setSequentialHint("scalar_Double", 50);
+        read_stman->setSequentialHint("array_Float", 32, 3, &slicer);
+
+        CheckRows(read_Double, read_Float, slicer, 0, 399, "sequential");
+        // jump ahead past the windows read ahead, then back
+        CheckRows(read_Double, read_Float, slicer, 700, 999, "after jump ahead");
+        CheckRows(read_Double, read_Float, slicer, 50, 149, "after jump back");
+
+        std::vector<std::pair<rownr_t, rownr_t>> ranges = {{900, 50}, {10, 30}, {500, 1}};
+        read_stman->setRowRangesHint("scalar_Double", ranges, 20);
+        read_stman->setRowRangesHint("array_Float", ranges, 20, 2, &slicer);
+        for (auto &range : ranges){
+            CheckRows(read_Double, read_Float, slicer, range.first,
+                      range.first + range.second - 1, "hinted range");
+        }
+        // leave the hinted ranges
+        CheckRows(read_Double, read_Float, slicer, 300, 320, "outside the hinted ranges");
+
+        read_stman->clearAccessHint("scalar_Double");
+        read_stman->clearAccessHint("array_Float");
+        CheckRows(read_Double, read_Float, slicer, 0, 9, "without hints");
+    }
+
+    cout << "prefetch: " << (nrFailures ? "FAILED" : "OK") << endl;
+
+    MPI_Finalize();
+
+    return nrFailures;
+}
@@ -0,0 +1,129 @@
+//    (c) Oak Ridge National Laboratory
+//    1 Bethel Valley Road, Oak Ridge, TN 37830, United States
+//
+//    This library is free software: you can redistribute it and/or
+//    modify it under the terms of the GNU General Public License as published
+//    by the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License along
+//    with this library. If not, see <http://www.gnu.org/licenses/>.
+//
+//    Any bugs, questions, concerns and/or suggestions please email to
+//    wangr1@ornl.gov or jason.ruonan.wang@gmail.com
+
+// ################################################################################
+// This code reads a column of more than 8 MiB, large enough to be split
+// across the read threads, once serially and once with READTHREADS set,
+// and checks the parallel reads against the serial ones cell by cell, for
+// the whole column, a range of rows and a slice of every cell.
+
+#include "../Adios2StMan.h"
+#include <casacore/tables/Tables/TableDesc.h>
+#include <casacore/tables/Tables/SetupNewTab.h>
+#include <casacore/tables/Tables/ArrColDesc.h>
+#include <casacore/tables/Tables/ArrayColumn.h>
+#include <casacore/casa/namespace.h>
+#include <mpi.h>
+
+#include "common.h"
+
+// 1100 rows of 64 x 32 doubles, 17.2 MiB
+const rownr_t NrRows = 1100;
+IPosition array_pos = IPosition(2,64,32);
+
+struct Reads{
+    Array<Double> column;
+    Array<Double> cells;
+    Array<Double> slices;
+};
+
+Reads ReadTable(const std::string &filename, uInt aNrThreads){
+    Reads reads;
+    Table casa_table(filename);
+    Adios2StMan *read_stman = dynamic_cast<Adios2StMan *>(casa_table.findDataManager("Adios2StMan"));
+    Check(read_stman != 0, "Adios2StMan of the table");
+    if (read_stman){
+        read_stman->setReadThreads(aNrThreads);
+    }
+    ArrayColumn<Double> read_Double(casa_table, "array_Double");
+    read_Double.getColumn(reads.column, True);
+    read_Double.getColumnCells(RefRows(17, NrRows - 5), reads.cells, True);
+    Slicer slicer(IPosition(2,3,0), IPosition(2,40,32), Slicer::endIsLength);
+    read_Double.getColumn(slicer, reads.slices, True);
+    return reads;
+}
+
+void CheckReads(const Array<Double> &parallel, const Array<Double> &serial,
+                const std::string &what){
+    if (!(parallel.shape() == serial.shape())){
+        Check(false, what + " shape");
+        return;
+    }
+    size_t cellSize = parallel.nelements() / parallel.shape()[parallel.ndim() - 1];
+    std::vector<Double> a(parallel.begin(), parallel.end());
+    std::vector<Double> b(serial.begin(), serial.end());
+    for (size_t i = 0; i < a.size(); i += cellSize){
+        Check(std::equal(a.begin() + i, a.begin() + i + cellSize, b.begin() + i),
+              what + " cell " + std::to_string(i / cellSize));
+    }
+}
+
+int main(int argc, char **argv){
+
+    MPI_Init(&argc,&argv);
+
+    std::string filename;
+    if (argc < 2){
+        filename = "readthreads.table";
+    }
+    else{
+        filename = argv[1];
+    }
+
+    Adios2StMan *stman = new Adios2StMan();
+
+    TableDesc td("", "1", TableDesc::Scratch);
+    td.addColumn (ArrayColumnDesc<Double>("array_Double", array_pos, ColumnDesc::FixedShape));
+
+    SetupNewTable newtab(filename, td, Table::New);
+    newtab.bindAll(*stman);
+    Table *tab = new Table(newtab, NrRows);
+
+    ArrayColumn<Double> array_Double (*tab, "array_Double");
+    Array<Double> arr_Double(array_pos);
+    for (rownr_t r = 0; r < NrRows; ++r){
+        Double *data = arr_Double.data();
+        for (size_t i = 0; i < arr_Double.nelements(); ++i){
+            data[i] = r * 1e5 + i;
+        }
+        array_Double.put(r, arr_Double);
+    }
+
+    delete tab;
+    delete stman;
+
+    Reads serial = ReadTable(filename, 0);
+    Reads parallel = ReadTable(filename, 4);
+
+    // the serial reads themselves hold what was written
+    std::vector<Double> column(serial.column.begin(), serial.column.end());
+    size_t element = (NrRows / 2) * array_pos.product() + 5 + 7 * 64;
+    Check(column.size() == NrRows * array_pos.product() &&
+          column[element] == (NrRows / 2) * 1e5 + 5 + 7 * 64, "serial read");
+
+    CheckReads(parallel.column, serial.column, "column");
+    CheckReads(parallel.cells, serial.cells, "rows 17 to end - 5");
+    CheckReads(parallel.slices, serial.slices, "slices");
+
+    cout << "readthreads: " << (nrFailures ? "FAILED" : "OK") << endl;
+
+    MPI_Finalize();
+
+    return nrFailures;
+}
@@ -0,0 +1,134 @@
+//    (c) Oak Ridge National Laboratory
+//    1 Bethel Valley Road, Oak Ridge, TN 37830, United States
+//
+//    This library is free software: you can redistribute it and/or
+//    modify it under the terms of the GNU General Public License as published
+//    by the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License along
+//    with this library. If not, see <http://www.gnu.org/licenses/>.
+//
+//    Any bugs, questions, concerns and/or suggestions please email to
+//    wangr1@ornl.gov or jason.ruonan.wang@gmail.com
+
+// ################################################################################
+// This code makes the scalar columns of a reopened table resident, by name
+// and by size, and checks the cells, whole columns and RefRows read from
+// memory before an update, within the update session and after
+// reopening.
+
+#include "../Adios2StMan.h"
+#include <casacore/tables/Tables/TableDesc.h>
+#include <casacore/tables/Tables/SetupNewTab.h>
+#include <casacore/tables/Tables/ScaColDesc.h>
+#include <casacore/tables/Tables/ScalarColumn.h>
+#include <casacore/casa/namespace.h>
+#include <mpi.h>
+
+#include "common.h"
+
+const rownr_t NrRows = 1000;
+
+// value of row r, rows 100 to 199 having been updated if aUpdated
+Int Expected(rownr_t r, bool aUpdated){
+    return (aUpdated && r >= 100 && r < 200) ? -Int(r) : Int(r * 7);
+}
+
+void CheckColumns(Table &aTable, bool aUpdated, const std::string &when){
+    ScalarColumn<Int> read_Int(aTable, "scalar_Int");
+    ScalarColumn<Double> read_Double(aTable, "scalar_Double");
+    for (rownr_t r = 0; r < NrRows; ++r){
+        std::string what = when + " row " + std::to_string(r);
+        Check(read_Int.get(r) == Expected(r, aUpdated), "scalar_Int " + what);
+        Check(read_Double.get(r) == Expected(r, aUpdated) * 0.5, "scalar_Double " + what);
+    }
+    Vector<Int> col_Int = read_Int.getColumn();
+    Vector<Double> col_Double = read_Double.getColumn();
+    for (rownr_t r = 0; r < NrRows; ++r){
+        std::string what = when + " column row " + std::to_string(r);
+        Check(col_Int[r] == Expected(r, aUpdated), "scalar_Int " + what);
+        Check(col_Double[r] == Expected(r, aUpdated) * 0.5, "scalar_Double " + what);
+    }
+    Vector<Int> cells_Int;
+    read_Int.getColumnCells(RefRows(90, 210, 3), cells_Int);
+    for (rownr_t i = 0; i < cells_Int.nelements(); ++i){
+        Check(cells_Int[i] == Expected(90 + 3 * i, aUpdated),
+              "scalar_Int " + when + " cells row " + std::to_string(90 + 3 * i));
+    }
+}
+
+// Makes scalar_Int resident by name and scalar_Double, 8000 bytes, by size.
+void MakeResident(Table &aTable){
+    Adios2StMan *stman = dynamic_cast<Adios2StMan *>(aTable.findDataManager("Adios2StMan"));
+    Check(stman != 0, "Adios2StMan of the table");
+    if (stman){
+        stman->setColumnResident("scalar_Int");
+        stman->setResidentBytes(NrRows * sizeof(Double));
+    }
+}
+
+int main(int argc, char **argv){
+
+    MPI_Init(&argc,&argv);
+
+    std::string filename;
+    if (argc < 2){
+        filename = "resident.table";
+    }
+    else{
+        filename = argv[1];
+    }
+
+    Adios2StMan *stman = new Adios2StMan();
+
+    TableDesc td("", "1", TableDesc::Scratch);
+    td.addColumn (ScalarColumnDesc<Int>("scalar_Int"));
+    td.addColumn (ScalarColumnDesc<Double>("scalar_Double"));
+
+    SetupNewTable newtab(filename, td, Table::New);
+    newtab.bindAll(*stman);
+    Table *tab = new Table(newtab, NrRows);
+
+    ScalarColumn<Int> scalar_Int (*tab, "scalar_Int");
+    ScalarColumn<Double> scalar_Double (*tab, "scalar_Double");
+    for (rownr_t r = 0; r < NrRows; ++r){
+        scalar_Int.put(r, Expected(r, false));
+        scalar_Double.put(r, Expected(r, false) * 0.5);
+    }
+
+    delete tab;
+    delete stman;
+
+    {
+        Table casa_table(filename, Table::Update);
+        MakeResident(casa_table);
+        CheckColumns(casa_table, false, "before the update");
+
+        // puts update the copies held in memory
+        ScalarColumn<Int> update_Int(casa_table, "scalar_Int");
+        ScalarColumn<Double> update_Double(casa_table, "scalar_Double");
+        for (rownr_t r = 100; r < 200; ++r){
+            update_Int.put(r, Expected(r, true));
+            update_Double.put(r, Expected(r, true) * 0.5);
+        }
+        CheckColumns(casa_table, true, "in the update session");
+    }
+
+    {
+        Table casa_table(filename);
+        MakeResident(casa_table);
+        CheckColumns(casa_table, true, "after the update");
+    }
+
+    cout << "resident: " << (nrFailures ? "FAILED" : "OK") << endl;
+
+    MPI_Finalize();
+
+    return nrFailures;
+}
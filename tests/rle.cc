@@ -0,0 +1,156 @@
+//    (c) Oak Ridge National Laboratory
+//    1 Bethel Valley Road, Oak Ridge, TN 37830, United States
+//
+//    This library is free software: you can redistribute it and/or
+//    modify it under the terms of the GNU General Public License as published
+//    by the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License along
+//    with this library. If not, see <http://www.gnu.org/licenses/>.
+//
+//    Any bugs, questions, concerns and/or suggestions please email to
+//    wangr1@ornl.gov or jason.ruonan.wang@gmail.com
+
+// ################################################################################
+// This code writes run-length encoded scalar columns, with runs of one row
+// up to runs spanning most of the table, and checks that they read back
+// unchanged cell by cell, as a whole column and through RefRows, and that
+// the encoding is kept with the table.
+
+#include "../Adios2StMan.h"
+#include <casacore/tables/Tables/TableDesc.h>
+#include <casacore/tables/Tables/SetupNewTab.h>
+#include <casacore/tables/Tables/ScaColDesc.h>
+#include <casacore/tables/Tables/ScalarColumn.h>
+#include <casacore/casa/namespace.h>
+#include <mpi.h>
+
+#include "common.h"
+
+const rownr_t NrRows = 10000;
+
+// value of row r, constant over runs of growing length
+Int RunValue(rownr_t r){
+    rownr_t run = 0;
+    for (rownr_t start = 0, length = 1; start + length <= r; start += length, length *= 2){
+        ++run;
+    }
+    return r < NrRows - 1 ? Int(run) : -1;
+}
+
+// scalar_Sparse is only put in rows [1000, 2000) and [5000, 5500)
+Int SparseValue(rownr_t r){
+    return (r >= 1000 && r < 2000) || (r >= 5000 && r < 5500) ? Int(r / 100) : 0;
+}
+
+int main(int argc, char **argv){
+
+    MPI_Init(&argc,&argv);
+
+    std::string filename;
+    if (argc < 2){
+        filename = "rle.table";
+    }
+    else{
+        filename = argv[1];
+    }
+
+    Adios2StMan *stman = new Adios2StMan();
+    stman->setColumnEncoding("scalar_Int", "rle");
+    stman->setColumnEncoding("scalar_Double", "rle");
+    stman->setColumnEncoding("scalar_Bool", "rle");
+    stman->setColumnEncoding("scalar_Sparse", "rle");
+
+    TableDesc td("", "1", TableDesc::Scratch);
+    td.addColumn (ScalarColumnDesc<Int>("scalar_Int"));
+    td.addColumn (ScalarColumnDesc<Double>("scalar_Double"));
+    td.addColumn (ScalarColumnDesc<Bool>("scalar_Bool"));
+    td.addColumn (ScalarColumnDesc<Int>("scalar_Sparse"));
+
+    SetupNewTable newtab(filename, td, Table::New);
+    newtab.bindAll(*stman);
+    Table *tab = new Table(newtab, NrRows);
+
+    ScalarColumn<Int> scalar_Int (*tab, "scalar_Int");
+    ScalarColumn<Double> scalar_Double (*tab, "scalar_Double");
+    ScalarColumn<Bool> scalar_Bool (*tab, "scalar_Bool");
+    ScalarColumn<Int> scalar_Sparse (*tab, "scalar_Sparse");
+
+    // scalar_Int cell by cell, scalar_Double as a whole and scalar_Bool
+    // in two halves
+    Vector<Double> vec_Double(NrRows);
+    Vector<Bool> vec_Bool(NrRows);
+    Vector<Bool> half_Bool(NrRows / 2);
+    for (rownr_t r = 0; r < NrRows; ++r){
+        scalar_Int.put(r, RunValue(r));
+        vec_Double[r] = RunValue(r) * 0.5;
+        vec_Bool[r] = RunValue(r) % 2;
+    }
+    scalar_Double.putColumn(vec_Double);
+    for (rownr_t half = 0; half < 2; ++half){
+        for (rownr_t i = 0; i < NrRows / 2; ++i){
+            half_Bool[i] = vec_Bool[half * NrRows / 2 + i];
+        }
+        scalar_Bool.putColumnCells(RefRows(half * NrRows / 2, (half + 1) * NrRows / 2 - 1), half_Bool);
+    }
+
+    for (rownr_t r = 0; r < NrRows; ++r){
+        if (SparseValue(r) != 0){
+            scalar_Sparse.put(r, SparseValue(r));
+        }
+    }
+
+    delete tab;
+    delete stman;
+
+    Table casa_table(filename);
+    ScalarColumn<Int> read_Int(casa_table, "scalar_Int");
+    ScalarColumn<Double> read_Double(casa_table, "scalar_Double");
+    ScalarColumn<Bool> read_Bool(casa_table, "scalar_Bool");
+    ScalarColumn<Int> read_Sparse(casa_table, "scalar_Sparse");
+
+    Adios2StMan *read_stman = dynamic_cast<Adios2StMan *>(casa_table.findDataManager("Adios2StMan"));
+    Check(read_stman && read_stman->getColumnEncoding("scalar_Int") == "rle", "encoding of scalar_Int");
+
+    for (rownr_t r = 0; r < NrRows; ++r){
+        Check(read_Int.get(r) == RunValue(r), "scalar_Int row " + std::to_string(r));
+        Check(read_Double.get(r) == RunValue(r) * 0.5, "scalar_Double row " + std::to_string(r));
+        Check(read_Bool.get(r) == Bool(RunValue(r) % 2), "scalar_Bool row " + std::to_string(r));
+        Check(read_Sparse.get(r) == SparseValue(r), "scalar_Sparse row " + std::to_string(r));
+    }
+
+    Vector<Int> col_Int = read_Int.getColumn();
+    Vector<Double> col_Double = read_Double.getColumn();
+    Vector<Bool> col_Bool = read_Bool.getColumn();
+    for (rownr_t r = 0; r < NrRows; ++r){
+        Check(col_Int[r] == RunValue(r), "scalar_Int column row " + std::to_string(r));
+        Check(col_Double[r] == vec_Double[r], "scalar_Double column row " + std::to_string(r));
+        Check(col_Bool[r] == vec_Bool[r], "scalar_Bool column row " + std::to_string(r));
+    }
+
+    // rows that were never put read as 0, also within a column read
+    Vector<Int> col_Sparse = read_Sparse.getColumn();
+    for (rownr_t r = 0; r < NrRows; ++r){
+        Check(col_Sparse[r] == SparseValue(r), "scalar_Sparse column row " + std::to_string(r));
+    }
+
+    // every 7th row, crossing run boundaries
+    RefRows rows(3, NrRows - 1, 7);
+    Vector<Int> cells_Int;
+    read_Int.getColumnCells(rows, cells_Int);
+    for (rownr_t i = 0; i < cells_Int.nelements(); ++i){
+        Check(cells_Int[i] == RunValue(3 + 7 * i), "scalar_Int cells row " + std::to_string(3 + 7 * i));
+    }
+
+    cout << "rle: " << (nrFailures ? "FAILED" : "OK") << endl;
+
+    MPI_Finalize();
+
+    return nrFailures;
+}
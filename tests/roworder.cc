@@ -0,0 +1,181 @@
+//    (c) Oak Ridge National Laboratory
+//    1 Bethel Valley Road, Oak Ridge, TN 37830, United States
+//
+//    This library is free software: you can redistribute it and/or
+//    modify it under the terms of the GNU General Public License as published
+//    by the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License along
+//    with this library. If not, see <http://www.gnu.org/licenses/>.
+//
+//    Any bugs, questions, concerns and/or suggestions please email to
+//    wangr1@ornl.gov or jason.ruonan.wang@gmail.com
+
+
+// ################################################################################
+// This code writes a table of time-major rows stored baseline-major through
+// a row order, putting cells one by one and in ranges, and checks that the
+// rows read back by their logical numbers cell by cell, as a whole column
+// and through RefRows, and that the order is kept with the table.
+
+#include "../Adios2StMan.h"
+#include <casacore/tables/Tables/TableDesc.h>
+#include <casacore/tables/Tables/SetupNewTab.h>
+#include <casacore/tables/Tables/ScaColDesc.h>
+#include <casacore/tables/Tables/ScalarColumn.h>
+#include <casacore/tables/Tables/ArrColDesc.h>
+#include <casacore/tables/Tables/ArrayColumn.h>
+#include <casacore/casa/Arrays/ArrayLogical.h>
+#include <casacore/casa/namespace.h>
+#include <mpi.h>
+
+#include "common.h"
+
+const Int NrAntennas = 6;
+const Int NrBaselines = NrAntennas * (NrAntennas - 1) / 2;
+const Int NrTimes = 50;
+const rownr_t NrRows = NrTimes * NrBaselines;
+IPosition array_pos = IPosition(2,2,8);
+
+// cells of n rows, the rows first + i * stride, filled with their row
+Array<Float> RowCells(rownr_t first, rownr_t n, rownr_t stride = 1){
+    Array<Float> cells(array_pos.concatenate(IPosition(1, n)));
+    Float *data = cells.data();
+    for (size_t i = 0; i < cells.nelements(); ++i){
+        data[i] = first + i / array_pos.product() * stride;
+    }
+    return cells;
+}
+
+int main(int argc, char **argv){
+
+    MPI_Init(&argc,&argv);
+
+    std::string filename;
+    if (argc < 2){
+        filename = "roworder.table";
+    }
+    else{
+        filename = argv[1];
+    }
+
+    // time-major rows, baselines in order within a time step
+    std::vector<std::vector<Int64>> keys(2);
+    for (Int t = 0; t < NrTimes; ++t){
+        for (Int a1 = 0; a1 < NrAntennas; ++a1){
+            for (Int a2 = a1 + 1; a2 < NrAntennas; ++a2){
+                keys[0].push_back(a1);
+                keys[1].push_back(a2);
+            }
+        }
+    }
+    std::vector<rownr_t> order = Adios2StMan::sortedRowOrder(keys);
+    Check(order.size() == NrRows, "size of the row order");
+    for (rownr_t i = 1; i < order.size(); ++i){
+        Check(keys[0][order[i - 1]] < keys[0][order[i]] ||
+              (keys[0][order[i - 1]] == keys[0][order[i]] &&
+               (keys[1][order[i - 1]] < keys[1][order[i]] ||
+                (keys[1][order[i - 1]] == keys[1][order[i]] && order[i - 1] < order[i]))),
+              "sorted row order at " + std::to_string(i));
+    }
+
+    Adios2StMan *stman = new Adios2StMan();
+
+    TableDesc td("", "1", TableDesc::Scratch);
+    td.addColumn (ScalarColumnDesc<Int>("ANTENNA1"));
+    td.addColumn (ScalarColumnDesc<Int>("ANTENNA2"));
+    td.addColumn (ScalarColumnDesc<Double>("scalar_Double"));
+    td.addColumn (ArrayColumnDesc<Float>("array_Float", array_pos, ColumnDesc::FixedShape));
+
+    SetupNewTable newtab(filename, td, Table::New);
+    newtab.bindAll(*stman);
+    Table *tab = new Table(newtab, NrRows);
+
+    Adios2StMan *write_stman = dynamic_cast<Adios2StMan *>(tab->findDataManager("Adios2StMan"));
+    write_stman->setRowOrder(order, "ANTENNA1,ANTENNA2");
+    Check(write_stman->getRowMap() != 0, "row map of the new table");
+
+    ScalarColumn<Int> antenna1 (*tab, "ANTENNA1");
+    ScalarColumn<Int> antenna2 (*tab, "ANTENNA2");
+    ScalarColumn<Double> scalar_Double (*tab, "scalar_Double");
+    ArrayColumn<Float> array_Float (*tab, "array_Float");
+
+    // the antennas as whole columns, the rest cell by cell for the first
+    // half and in ranges of one time step for the second
+    Vector<Int> vec_Antenna1(NrRows), vec_Antenna2(NrRows);
+    for (rownr_t r = 0; r < NrRows; ++r){
+        vec_Antenna1[r] = keys[0][r];
+        vec_Antenna2[r] = keys[1][r];
+    }
+    antenna1.putColumn(vec_Antenna1);
+    antenna2.putColumn(vec_Antenna2);
+    Array<Float> arr_Float(array_pos);
+    for (rownr_t r = 0; r < NrRows / 2; ++r){
+        scalar_Double.put(r, r * 0.5);
+        arr_Float = r;
+        array_Float.put(r, arr_Float);
+    }
+    for (rownr_t r = NrRows / 2; r < NrRows; r += NrBaselines){
+        rownr_t n = std::min<rownr_t>(NrBaselines, NrRows - r);
+        Vector<Double> step_Double(n);
+        for (rownr_t i = 0; i < n; ++i){
+            step_Double[i] = (r + i) * 0.5;
+        }
+        scalar_Double.putColumnCells(RefRows(r, r + n - 1), step_Double);
+        array_Float.putColumnCells(RefRows(r, r + n - 1), RowCells(r, n));
+    }
+
+    delete tab;
+    delete stman;
+
+    Table casa_table(filename);
+    ScalarColumn<Int> read_Antenna1(casa_table, "ANTENNA1");
+    ScalarColumn<Double> read_Double(casa_table, "scalar_Double");
+    ArrayColumn<Float> read_Float(casa_table, "array_Float");
+
+    Adios2StMan *read_stman = dynamic_cast<Adios2StMan *>(casa_table.findDataManager("Adios2StMan"));
+    Check(read_stman && read_stman->getRowOrderKeys() == "ANTENNA1,ANTENNA2", "row order keys");
+    const Adios2StManRowMap *rowMap = read_stman ? read_stman->getRowMap() : 0;
+    Check(rowMap != 0, "row map of the reopened table");
+    for (rownr_t i = 0; rowMap && i < NrRows; ++i){
+        Check(rowMap->map(order[i]) == i, "stored row of row " + std::to_string(order[i]));
+    }
+
+    Array<Float> cell;
+    for (rownr_t r = 0; r < NrRows; ++r){
+        std::string what = "row " + std::to_string(r);
+        Check(read_Antenna1.get(r) == keys[0][r], "ANTENNA1 " + what);
+        Check(read_Double.get(r) == r * 0.5, "scalar_Double " + what);
+        read_Float.get(r, cell, True);
+        Check(allEQ(cell, Float(r)), "array_Float " + what);
+    }
+
+    Vector<Double> col_Double = read_Double.getColumn();
+    for (rownr_t r = 0; r < NrRows; ++r){
+        Check(col_Double[r] == r * 0.5, "scalar_Double column row " + std::to_string(r));
+    }
+    Check(allEQ(read_Float.getColumn(), RowCells(0, NrRows)), "array_Float column");
+
+    // every 4th row, which is scattered over the stored rows
+    RefRows rows(1, NrRows - 1, 4);
+    Vector<Double> cells_Double;
+    Array<Float> cells_Float;
+    read_Double.getColumnCells(rows, cells_Double);
+    read_Float.getColumnCells(rows, cells_Float);
+    for (rownr_t i = 0; i < cells_Double.nelements(); ++i){
+        Check(cells_Double[i] == (1 + 4 * i) * 0.5, "scalar_Double cells row " + std::to_string(1 + 4 * i));
+    }
+    Check(allEQ(cells_Float, RowCells(1, cells_Double.nelements(), 4)), "array_Float cells");
+
+    cout << "roworder: " << (nrFailures ? "FAILED" : "OK") << endl;
+
+    MPI_Finalize();
+
+    return nrFailures;
+}
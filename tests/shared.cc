@@ -0,0 +1,116 @@
+//    (c) Oak Ridge National Laboratory
+//    1 Bethel Valley Road, Oak Ridge, TN 37830, United States
+//
+//    This library is free software: you can redistribute it and/or
+//    modify it under the terms of the GNU General Public License as published
+//    by the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License along
+//    with this library. If not, see <http://www.gnu.org/licenses/>.
+//
+//    Any bugs, questions, concerns and/or suggestions please email to
+//    wangr1@ornl.gov or jason.ruonan.wang@gmail.com
+
+// ################################################################################
+// This code keeps several tables open at once, each with a storage manager
+// of its own, and checks that they share one ADIOS instance, that each
+// reads back its own cells and that their IOs and the instance are released
+// once all of them are closed.
+
+#include "../Adios2StMan.h"
+#include <casacore/tables/Tables/TableDesc.h>
+#include <casacore/tables/Tables/SetupNewTab.h>
+#include <casacore/tables/Tables/ScaColDesc.h>
+#include <casacore/tables/Tables/ScalarColumn.h>
+#include <casacore/casa/namespace.h>
+#include <mpi.h>
+
+#include "common.h"
+
+const rownr_t NrRows = 40;
+const int NrTables = 3;
+
+Table *CreateTable(const std::string &aName){
+    Adios2StMan stman;
+    TableDesc td("", "1", TableDesc::Scratch);
+    td.addColumn (ScalarColumnDesc<Int>("scalar_Int"));
+    SetupNewTable newtab(aName, td, Table::New);
+    newtab.bindAll(stman);
+    return new Table(newtab, NrRows);
+}
+
+void CheckReleased(const std::string &what){
+    Check(Adios2StMan::getAdiosInstanceCount() == 0, what + " ADIOS instances released");
+    Check(Adios2StMan::getIOCount() == 0, what + " IOs removed");
+}
+
+int main(int argc, char **argv){
+
+    MPI_Init(&argc,&argv);
+
+    std::string filename;
+    if (argc < 2){
+        filename = "shared.table";
+    }
+    else{
+        filename = argv[1];
+    }
+    std::vector<std::string> names;
+    for (int t = 0; t < NrTables; ++t){
+        names.push_back(filename + "." + std::to_string(t) + ".table");
+    }
+
+    CheckReleased("before writing");
+
+    std::vector<Table *> tables;
+    for (int t = 0; t < NrTables; ++t){
+        tables.push_back(CreateTable(names[t]));
+    }
+    Check(Adios2StMan::getAdiosInstanceCount() == 1, "one ADIOS instance while writing");
+    Check(Adios2StMan::getIOCount() >= size_t(NrTables), "an IO per table while writing");
+    for (int t = 0; t < NrTables; ++t){
+        ScalarColumn<Int> scalar_Int (*tables[t], "scalar_Int");
+        for (rownr_t r = 0; r < NrRows; ++r){
+            scalar_Int.put(r, t * 1000 + r);
+        }
+    }
+    for (Table *tab : tables){
+        delete tab;
+    }
+    CheckReleased("after writing");
+
+    {
+        std::vector<Table> read_tables;
+        for (int t = 0; t < NrTables; ++t){
+            read_tables.push_back(Table(names[t]));
+        }
+        for (int t = 0; t < NrTables; ++t){
+            ScalarColumn<Int> read_Int(read_tables[t], "scalar_Int");
+            for (rownr_t r = 0; r < NrRows; ++r){
+                Check(read_Int.get(r) == Int(t * 1000 + r), names[t] + " row " + std::to_string(r));
+            }
+        }
+        Check(Adios2StMan::getAdiosInstanceCount() == 1, "one ADIOS instance while reading");
+    }
+    CheckReleased("after reading");
+
+    // opening and closing a table over and over must not leave IOs behind
+    for (int i = 0; i < 20; ++i){
+        Table casa_table(names[i % NrTables]);
+        ScalarColumn<Int> read_Int(casa_table, "scalar_Int");
+        read_Int.getColumn();
+    }
+    CheckReleased("after reopening");
+
+    cout << "shared: " << (nrFailures ? "FAILED" : "OK") << endl;
+
+    MPI_Finalize();
+
+    return nrFailures;
+}
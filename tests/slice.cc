@@ -0,0 +1,128 @@
+//    (c) Oak Ridge National Laboratory
+//    1 Bethel Valley Road, Oak Ridge, TN 37830, United States
+//
+//    This library is free software: you can redistribute it and/or
+//    modify it under the terms of the GNU General Public License as published
+//    by the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License along
+//    with this library. If not, see <http://www.gnu.org/licenses/>.
+//
+//    Any bugs, questions, concerns and/or suggestions please email to
+//    wangr1@ornl.gov or jason.ruonan.wang@gmail.com
+
+// ################################################################################
+// This code reads strided slices of array cells, of a whole column and of
+// the cells of RefRows, and checks them against the same Slicer applied to
+// the full cells read back, for strides along each axis, along all of
+// them, and strides reaching past the end of a cell.
+
+#include "../Adios2StMan.h"
+#include <casacore/tables/Tables/TableDesc.h>
+#include <casacore/tables/Tables/SetupNewTab.h>
+#include <casacore/tables/Tables/ArrColDesc.h>
+#include <casacore/tables/Tables/ArrayColumn.h>
+#include <casacore/casa/namespace.h>
+#include <mpi.h>
+
+#include "common.h"
+
+const rownr_t NrRows = 20;
+IPosition array_pos = IPosition(3,4,10,6);
+
+// Checks that aSlices holds aSlicer of the full cells of aRows, one after
+// the other.
+void CheckSlices(const Array<Float> &aSlices, const std::vector<Array<Float>> &aCells,
+                 const std::vector<rownr_t> &aRows, const Slicer &aSlicer,
+                 const std::string &what){
+    std::vector<Float> expected;
+    for (rownr_t r : aRows){
+        Array<Float> cell = aCells[r];
+        Array<Float> slice = cell(aSlicer);
+        expected.insert(expected.end(), slice.begin(), slice.end());
+    }
+    std::vector<Float> actual(aSlices.begin(), aSlices.end());
+    Check(actual == expected, what);
+}
+
+int main(int argc, char **argv){
+
+    MPI_Init(&argc,&argv);
+
+    std::string filename;
+    if (argc < 2){
+        filename = "slice.table";
+    }
+    else{
+        filename = argv[1];
+    }
+
+    Adios2StMan *stman = new Adios2StMan();
+
+    TableDesc td("", "1", TableDesc::Scratch);
+    td.addColumn (ArrayColumnDesc<Float>("array_Float", array_pos, ColumnDesc::FixedShape));
+
+    SetupNewTable newtab(filename, td, Table::New);
+    newtab.bindAll(*stman);
+    Table *tab = new Table(newtab, NrRows);
+
+    // every element of every cell distinct
+    ArrayColumn<Float> array_Float (*tab, "array_Float");
+    Array<Float> arr_Float(array_pos);
+    for (rownr_t r = 0; r < NrRows; ++r){
+        Float *data = arr_Float.data();
+        for (size_t i = 0; i < arr_Float.nelements(); ++i){
+            data[i] = r * 1000 + i;
+        }
+        array_Float.put(r, arr_Float);
+    }
+
+    delete tab;
+    delete stman;
+
+    Table casa_table(filename);
+    ArrayColumn<Float> read_Float(casa_table, "array_Float");
+
+    std::vector<Array<Float>> cells(NrRows);
+    std::vector<rownr_t> allRows, someRows;
+    for (rownr_t r = 0; r < NrRows; ++r){
+        read_Float.get(r, cells[r], True);
+        allRows.push_back(r);
+    }
+    for (rownr_t r = 2; r < NrRows; r += 3){
+        someRows.push_back(r);
+    }
+
+    std::vector<Slicer> slicers;
+    slicers.push_back(Slicer(IPosition(3,0,0,0), IPosition(3,2,10,6), IPosition(3,2,1,1), Slicer::endIsLength));
+    slicers.push_back(Slicer(IPosition(3,1,1,0), IPosition(3,3,3,6), IPosition(3,1,3,1), Slicer::endIsLength));
+    slicers.push_back(Slicer(IPosition(3,0,2,1), IPosition(3,4,8,3), IPosition(3,1,1,2), Slicer::endIsLength));
+    slicers.push_back(Slicer(IPosition(3,1,0,1), IPosition(3,2,4,2), IPosition(3,2,3,4), Slicer::endIsLength));
+    slicers.push_back(Slicer(IPosition(3,3,9,5), IPosition(3,1,1,1), IPosition(3,5,7,3), Slicer::endIsLength));
+
+    for (size_t s = 0; s < slicers.size(); ++s){
+        std::string what = "slicer " + std::to_string(s);
+        Array<Float> slice;
+        for (rownr_t r = 0; r < NrRows; ++r){
+            read_Float.getSlice(r, slicers[s], slice, True);
+            CheckSlices(slice, cells, std::vector<rownr_t>(1, r), slicers[s],
+                        what + " row " + std::to_string(r));
+        }
+        read_Float.getColumn(slicers[s], slice, True);
+        CheckSlices(slice, cells, allRows, slicers[s], what + " column");
+        read_Float.getColumnCells(RefRows(2, NrRows - 1, 3), slicers[s], slice, True);
+        CheckSlices(slice, cells, someRows, slicers[s], what + " cells");
+    }
+
+    cout << "slice: " << (nrFailures ? "FAILED" : "OK") << endl;
+
+    MPI_Finalize();
+
+    return nrFailures;
+}
@@ -0,0 +1,362 @@
+//    (c) Oak Ridge National Laboratory
+//    1 Bethel Valley Road, Oak Ridge, TN 37830, United States
+//
+//    This library is free software: you can redistribute it and/or
+//    modify it under the terms of the GNU General Public License as published
+//    by the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License along
+//    with this library. If not, see <http://www.gnu.org/licenses/>.
+//
+//    Any bugs, questions, concerns and/or suggestions please email to
+//    wangr1@ornl.gov or jason.ruonan.wang@gmail.com
+
+// ################################################################################
+// This code traces the writing and reading of a table, parses the trace
+// files written, and checks that they are valid JSON arrays of events,
+// that every event carries its begin time and duration, that the events
+// of a thread nest properly, and that the puts and gets of the columns are
+// there.
+
+#include "../Adios2StMan.h"
+#include <casacore/tables/Tables/TableDesc.h>
+#include <casacore/tables/Tables/SetupNewTab.h>
+#include <casacore/tables/Tables/ScaColDesc.h>
+#include <casacore/tables/Tables/ScalarColumn.h>
+#include <casacore/tables/Tables/ArrColDesc.h>
+#include <casacore/tables/Tables/ArrayColumn.h>
+#include <casacore/casa/namespace.h>
+#include <mpi.h>
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <sstream>
+
+#include "common.h"
+
+const rownr_t NrRows = 40;
+IPosition array_pos = IPosition(2,4,5);
+
+// A minimal JSON reader, enough to validate the trace files and to pick the
+// fields of their events.
+struct Json{
+    char type = 'n';   // 'n'-null, 'b'-bool, 'd'-number, 's'-string, 'a'-array, 'o'-object
+    double number = 0;
+    std::string text;
+    std::vector<Json> items;
+    std::map<std::string, Json> fields;
+    const Json *field(const std::string &name) const{
+        auto it = fields.find(name);
+        return it == fields.end() ? 0 : &it->second;
+    }
+};
+
+class JsonParser{
+public:
+    JsonParser(const std::string &text) : itsText(text), itsPos(0){}
+    bool parse(Json &value){
+        return parseValue(value) && (skip(), itsPos == itsText.size());
+    }
+private:
+    void skip(){
+        while (itsPos < itsText.size() && isspace((unsigned char)itsText[itsPos])){
+            ++itsPos;
+        }
+    }
+    bool literal(const char *word){
+        size_t n = strlen(word);
+        if (itsText.compare(itsPos, n, word) != 0){
+            return false;
+        }
+        itsPos += n;
+        return true;
+    }
+    bool parseString(std::string &out){
+        if (itsText[itsPos] != '"'){
+            return false;
+        }
+        for (++itsPos; itsPos < itsText.size(); ++itsPos){
+            char c = itsText[itsPos];
+            if (c == '"'){
+                ++itsPos;
+                return true;
+            }
+            if ((unsigned char)c < 0x20){
+                return false;
+            }
+            if (c == '\\'){
+                if (++itsPos >= itsText.size()){
+                    return false;
+                }
+                c = itsText[itsPos];
+                if (c == 'u'){
+                    if (itsPos + 4 >= itsText.size()){
+                        return false;
+                    }
+                    for (int i = 1; i <= 4; ++i){
+                        if (!isxdigit((unsigned char)itsText[itsPos + i])){
+                            return false;
+                        }
+                    }
+                    itsPos += 4;
+                    c = '?';
+                }
+                else if (strchr("bfnrt", c)){
+                    c = "\b\f\n\r\t"[strchr("bfnrt", c) - "bfnrt"];
+                }
+                else if (!strchr("\"\\/", c)){
+                    return false;
+                }
+            }
+            out += c;
+        }
+        return false;
+    }
+    bool parseValue(Json &value){
+        skip();
+        if (itsPos >= itsText.size()){
+            return false;
+        }
+        char c = itsText[itsPos];
+        if (c == '{'){
+            value.type = 'o';
+            ++itsPos;
+            skip();
+            if (itsText[itsPos] == '}'){
+                ++itsPos;
+                return true;
+            }
+            while (true){
+                std::string name;
+                skip();
+                if (!parseString(name)){
+                    return false;
+                }
+                skip();
+                if (itsText[itsPos++] != ':' || !parseValue(value.fields[name])){
+                    return false;
+                }
+                skip();
+                c = itsText[itsPos++];
+                if (c == '}'){
+                    return true;
+                }
+                if (c != ','){
+                    return false;
+                }
+            }
+        }
+        if (c == '['){
+            value.type = 'a';
+            ++itsPos;
+            skip();
+            if (itsText[itsPos] == ']'){
+                ++itsPos;
+                return true;
+            }
+            while (true){
+                value.items.push_back(Json());
+                if (!parseValue(value.items.back())){
+                    return false;
+                }
+                skip();
+                c = itsText[itsPos++];
+                if (c == ']'){
+                    return true;
+                }
+                if (c != ','){
+                    return false;
+                }
+            }
+        }
+        if (c == '"'){
+            value.type = 's';
+            return parseString(value.text);
+        }
+        if (literal("true") || literal("false")){
+            value.type = 'b';
+            return true;
+        }
+        if (literal("null")){
+            return true;
+        }
+        const char *begin = itsText.c_str() + itsPos;
+        char *end;
+        value.number = strtod(begin, &end);
+        if (end == begin){
+            return false;
+        }
+        value.type = 'd';
+        itsPos += end - begin;
+        return true;
+    }
+    const std::string &itsText;
+    size_t itsPos;
+};
+
+struct Event{
+    std::string name;
+    std::string column;
+    double begin;
+    double end;
+};
+
+// Parses trace file aPath and checks its events, returning the complete
+// events.
+std::vector<Event> CheckTrace(const std::string &aPath){
+    std::vector<Event> events;
+    std::ifstream file(aPath.c_str());
+    Check(file.good(), aPath + " written");
+    std::stringstream text;
+    text << file.rdbuf();
+    Json trace;
+    if (!JsonParser(text.str()).parse(trace) || trace.type != 'a'){
+        Check(false, aPath + " is a JSON array");
+        return events;
+    }
+    std::map<double, std::vector<Event>> threads;
+    for (size_t i = 0; i < trace.items.size(); ++i){
+        const Json &item = trace.items[i];
+        std::string what = aPath + " event " + std::to_string(i);
+        const Json *name = item.field("name");
+        const Json *ph = item.field("ph");
+        const Json *pid = item.field("pid");
+        Check(item.type == 'o' && name && name->type == 's' && ph && ph->type == 's' &&
+              pid && pid->type == 'd', what + " has a name, phase and process");
+        if (!ph || ph->text != "X"){
+            continue;
+        }
+        const Json *tid = item.field("tid");
+        const Json *ts = item.field("ts");
+        const Json *dur = item.field("dur");
+        if (!(tid && tid->type == 'd' && ts && ts->type == 'd' && dur && dur->type == 'd' && dur->number >= 0)){
+            Check(false, what + " has a thread, begin and duration");
+            continue;
+        }
+        Event event;
+        event.name = name->text;
+        const Json *args = item.field("args");
+        const Json *column = args ? args->field("column") : 0;
+        if (column){
+            event.column = column->text;
+        }
+        event.begin = ts->number;
+        event.end = ts->number + dur->number;
+        events.push_back(event);
+        threads[tid->number].push_back(event);
+    }
+    // events of one thread are scopes, so any two are nested or disjoint;
+    // times are written to the nanosecond
+    const double slack = 0.002;
+    for (auto &thread : threads){
+        std::vector<Event> &list = thread.second;
+        std::sort(list.begin(), list.end(), [](const Event &a, const Event &b){
+            return a.begin < b.begin || (a.begin == b.begin && a.end > b.end);
+        });
+        std::vector<double> open;
+        bool nested = true;
+        for (auto &event : list){
+            while (!open.empty() && open.back() <= event.begin + slack){
+                open.pop_back();
+            }
+            if (!open.empty() && event.end > open.back() + slack){
+                nested = false;
+            }
+            open.push_back(event.end);
+        }
+        Check(nested, aPath + " events of thread " + std::to_string(int(thread.first)) + " nest");
+    }
+    return events;
+}
+
+bool HasEvent(const std::vector<Event> &aEvents, const std::string &aName,
+              const std::string &aColumn){
+    for (auto &event : aEvents){
+        if (event.name == aName && event.column == aColumn){
+            return true;
+        }
+    }
+    return false;
+}
+
+int main(int argc, char **argv){
+
+    MPI_Init(&argc,&argv);
+
+    std::string filename;
+    if (argc < 2){
+        filename = "trace.table";
+    }
+    else{
+        filename = argv[1];
+    }
+    std::string writeTrace = filename + ".write";
+    std::string readTrace = filename + ".read";
+
+    Adios2StMan *stman = new Adios2StMan();
+    stman->setTrace(writeTrace);
+
+    // a column name that has to be escaped in JSON
+    TableDesc td("", "1", TableDesc::Scratch);
+    td.addColumn (ScalarColumnDesc<Int>("scalar \"Int\""));
+    td.addColumn (ArrayColumnDesc<Float>("array_Float", array_pos, ColumnDesc::FixedShape));
+
+    SetupNewTable newtab(filename, td, Table::New);
+    newtab.bindAll(*stman);
+    Table *tab = new Table(newtab, NrRows);
+
+    ScalarColumn<Int> scalar_Int (*tab, "scalar \"Int\"");
+    ArrayColumn<Float> array_Float (*tab, "array_Float");
+    Array<Float> arr_Float(array_pos);
+    for (rownr_t r = 0; r < NrRows; ++r){
+        scalar_Int.put(r, r);
+        arr_Float = r;
+        array_Float.put(r, arr_Float);
+    }
+
+    delete tab;
+    delete stman;
+
+    {
+        Table casa_table(filename);
+        Adios2StMan *read_stman = dynamic_cast<Adios2StMan *>(casa_table.findDataManager("Adios2StMan"));
+        Check(read_stman != 0, "Adios2StMan of the table");
+        if (read_stman){
+            read_stman->setTrace(readTrace);
+        }
+        ScalarColumn<Int> read_Int(casa_table, "scalar \"Int\"");
+        ArrayColumn<Float> read_Float(casa_table, "array_Float");
+        Array<Float> cell;
+        for (rownr_t r = 0; r < NrRows; ++r){
+            Check(read_Int.get(r) == Int(r), "scalar_Int row " + std::to_string(r));
+            read_Float.get(r, cell, True);
+        }
+        read_Float.getColumn();
+    }
+
+    std::vector<Event> written = CheckTrace(writeTrace + ".0.json");
+    Check(HasEvent(written, "Create", ""), "Create traced");
+    Check(HasEvent(written, "Put", "scalar \"Int\""), "puts of scalar \"Int\" traced");
+    Check(HasEvent(written, "Put", "array_Float"), "puts of array_Float traced");
+    Check(HasEvent(written, "Flush", ""), "Flush traced");
+
+    std::vector<Event> read = CheckTrace(readTrace + ".0.json");
+    Check(HasEvent(read, "Get", "scalar \"Int\""), "gets of scalar \"Int\" traced");
+    Check(HasEvent(read, "Get", "array_Float"), "gets of array_Float traced");
+    Check(HasEvent(read, "Close", ""), "Close traced");
+
+    cout << "trace: " << (nrFailures ? "FAILED" : "OK") << endl;
+
+    MPI_Finalize();
+
+    return nrFailures;
+}
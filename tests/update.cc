@@ -0,0 +1,152 @@
+//    (c) Oak Ridge National Laboratory
+//    1 Bethel Valley Road, Oak Ridge, TN 37830, United States
+//
+//    This library is free software: you can redistribute it and/or
+//    modify it under the terms of the GNU General Public License as published
+//    by the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License along
+//    with this library. If not, see <http://www.gnu.org/licenses/>.
+//
+//    Any bugs, questions, concerns and/or suggestions please email to
+//    wangr1@ornl.gov or jason.ruonan.wang@gmail.com
+
+
+// ################################################################################
+// This code updates a table in several sessions, each stored in a new step
+// of its container, and checks that every cell reads back from the newest
+// step holding it: within an update session right after the put, and
+// after reopening, for plain and encoded scalar and for array columns.
+
+#include "../Adios2StMan.h"
+#include <casacore/tables/Tables/TableDesc.h>
+#include <casacore/tables/Tables/SetupNewTab.h>
+#include <casacore/tables/Tables/ScaColDesc.h>
+#include <casacore/tables/Tables/ScalarColumn.h>
+#include <casacore/tables/Tables/ArrColDesc.h>
+#include <casacore/tables/Tables/ArrayColumn.h>
+#include <casacore/casa/Arrays/ArrayLogical.h>
+#include <casacore/casa/namespace.h>
+#include <mpi.h>
+
+#include "common.h"
+
+const rownr_t NrRows = 100;
+IPosition array_pos = IPosition(2,3,4);
+
+// value of row r as last put in session s, 0 being the table creation:
+// session 1 updates rows 10 to 39, then rows 30 to 49 after reading,
+// session 2 updates row 35
+Int Expected(rownr_t r, int s){
+    if (s >= 2 && r == 35){
+        return 3000 + r;
+    }
+    if (s >= 1 && r >= 30 && r < 50){
+        return 2000 + r;
+    }
+    if (s >= 1 && r >= 10 && r < 40){
+        return 1000 + r;
+    }
+    return r;
+}
+
+void CheckTable(Table &tab, int s, const std::string &when){
+    ScalarColumn<Int> scalar_Int(tab, "scalar_Int");
+    ScalarColumn<Int> rle_Int(tab, "rle_Int");
+    ArrayColumn<Int> array_Int(tab, "array_Int");
+    Vector<Int> col_Int = scalar_Int.getColumn();
+    Array<Int> arr_Int;
+    for (rownr_t r = 0; r < NrRows; ++r){
+        std::string what = when + " row " + std::to_string(r);
+        Check(scalar_Int.get(r) == Expected(r, s), "scalar_Int " + what);
+        Check(col_Int[r] == Expected(r, s), "scalar_Int column " + what);
+        Check(rle_Int.get(r) == Expected(r, s) / 10, "rle_Int " + what);
+        array_Int.get(r, arr_Int, True);
+        Check(arr_Int.shape() == array_pos && allEQ(arr_Int, Expected(r, s)), "array_Int " + what);
+    }
+}
+
+void PutRows(Table &tab, rownr_t first, rownr_t last, Int offset){
+    ScalarColumn<Int> scalar_Int(tab, "scalar_Int");
+    ScalarColumn<Int> rle_Int(tab, "rle_Int");
+    ArrayColumn<Int> array_Int(tab, "array_Int");
+    Array<Int> arr_Int(array_pos);
+    for (rownr_t r = first; r <= last; ++r){
+        scalar_Int.put(r, offset + r);
+        rle_Int.put(r, (offset + r) / 10);
+        arr_Int = offset + r;
+        array_Int.put(r, arr_Int);
+    }
+}
+
+int main(int argc, char **argv){
+
+    MPI_Init(&argc,&argv);
+
+    std::string filename;
+    if (argc < 2){
+        filename = "update.table";
+    }
+    else{
+        filename = argv[1];
+    }
+
+    Adios2StMan *stman = new Adios2StMan();
+    stman->setColumnEncoding("rle_Int", "rle");
+
+    TableDesc td("", "1", TableDesc::Scratch);
+    td.addColumn (ScalarColumnDesc<Int>("scalar_Int"));
+    td.addColumn (ScalarColumnDesc<Int>("rle_Int"));
+    td.addColumn (ArrayColumnDesc<Int>("array_Int", array_pos, ColumnDesc::FixedShape));
+
+    SetupNewTable newtab(filename, td, Table::New);
+    newtab.bindAll(*stman);
+    Table *tab = new Table(newtab, NrRows);
+    PutRows(*tab, 0, NrRows - 1, 0);
+    delete tab;
+    delete stman;
+
+    {
+        Table casa_table(filename);
+        CheckTable(casa_table, 0, "created");
+    }
+
+    {
+        Table casa_table(filename, Table::Update);
+        PutRows(casa_table, 10, 39, 1000);
+        // read back before the session ends, then put over rows just read
+        ScalarColumn<Int> scalar_Int(casa_table, "scalar_Int");
+        Check(scalar_Int.get(15) == Expected(15, 1), "scalar_Int read in session 1");
+        PutRows(casa_table, 30, 49, 2000);
+        CheckTable(casa_table, 1, "in session 1");
+    }
+
+    {
+        Table casa_table(filename);
+        CheckTable(casa_table, 1, "after session 1");
+    }
+
+    {
+        Table casa_table(filename, Table::Update);
+        PutRows(casa_table, 35, 35, 3000);
+    }
+
+    {
+        Table casa_table(filename);
+        CheckTable(casa_table, 2, "after session 2");
+        Adios2StMan *read_stman = dynamic_cast<Adios2StMan *>(casa_table.findDataManager("Adios2StMan"));
+        Check(read_stman && read_stman->getNrSteps() == 4, "steps after session 2");
+    }
+
+    cout << "update: " << (nrFailures ? "FAILED" : "OK") << endl;
+
+    MPI_Finalize();
+
+    return nrFailures;
+}